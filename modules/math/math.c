@@ -19,8 +19,8 @@
  * math library.
  */
 #define LP_MATH_FUNC1(cfunc)                        \
-    static lp_obj* math_##cfunc(LP) {                \
-        double x = LP_NUM(0);                        \
+    static lp_obj* math_##cfunc(LP, LP_ARGS) {     \
+        double x = LP_ARG_NUM(0);                    \
         double r = 0.0;                             \
                                                     \
         errno = 0;                                  \
@@ -41,9 +41,9 @@
  * math library.
  */
 #define LP_MATH_FUNC2(cfunc)                        \
-    static lp_obj* math_##cfunc(LP) {                \
-        double x = LP_NUM(0);                        \
-        double y = LP_NUM(1);                        \
+    static lp_obj* math_##cfunc(LP, LP_ARGS) {     \
+        double x = LP_ARG_NUM(0);                    \
+        double y = LP_ARG_NUM(1);                    \
         double r = 0.0;                             \
                                                     \
         errno = 0;                                  \
@@ -179,8 +179,8 @@ LP_MATH_FUNC2(fmod)
  * which is laid between 1/2 <= abs(r) < 1.
  * if x = 0, the (r, y) = (0, 0).
  */
-static lp_obj* math_frexp(LP) {
-    double x = LP_NUM(0);
+static lp_obj* math_frexp(LP, LP_ARGS) {
+    double x = LP_ARG_NUM(0);
     int    y = 0;   
     double r = 0.0;
     lp_obj* rList = lp_list(lp);
@@ -224,15 +224,15 @@ LP_MATH_FUNC2(ldexp)
  * the denominator and numerator. based on fomula:
  * log(x, base) = log10(x) / log10(base).
  */
-static lp_obj* math_log(LP) {
-    double x = LP_NUM(0);
-    lp_obj* b = LP_DEFAULT(1, lp->lp_None);
+static lp_obj* math_log(LP, LP_ARGS) {
+    double x = LP_ARG_NUM(0);
+    lp_obj* b = LP_ARG_DEFAULT(1, lp->lp_None);
     double y = 0.0;
     double den = 0.0;   /* denominator */
     double num = 0.0;   /* numinator */
     double r = 0.0;     /* result */
 
-    if (b->type == LP_NONE)
+    if (lp_typeof(b) == LP_NONE)
         y = M_E;
     else if (lp_is_number(b))
         y = lp_type_number(lp, b);
@@ -272,8 +272,8 @@ LP_MATH_FUNC1(log10)
  * x and y is the fractional part of x, both holds
  * the same sign as x.
  */
-static lp_obj* math_modf(LP) {
-    double x = LP_NUM(0);
+static lp_obj* math_modf(LP, LP_ARGS) {
+    double x = LP_ARG_NUM(0);
     double y = 0.0; 
     double r = 0.0;
     lp_obj* rList = lp_list(lp);
@@ -298,9 +298,9 @@ static lp_obj* math_modf(LP) {
  * of builtin function pow(); whilst, math_pow() is an
  * alternative in math module.
  */
-static lp_obj* math_pow(LP) {
-    double x = LP_NUM(0);
-    double y = LP_NUM(1);
+static lp_obj* math_pow(LP, LP_ARGS) {
+    double x = LP_ARG_NUM(0);
+    double y = LP_ARG_NUM(1);
     double r = 0.0;
 
     errno = 0;
@@ -387,31 +387,31 @@ void math_init(LP)
      */
     lp_setk(lp, math_mod, lp_string(lp, "pi"), math_pi);
     lp_setk(lp, math_mod, lp_string(lp, "e"), math_e);
-    lp_setkv(lp, math_mod, lp_string(lp, "acos"), lp_fnc(lp, math_acos));
-    lp_setkv(lp, math_mod, lp_string(lp, "asin"), lp_fnc(lp, math_asin));
-    lp_setkv(lp, math_mod, lp_string(lp, "atan"), lp_fnc(lp, math_atan));
-    lp_setkv(lp, math_mod, lp_string(lp, "atan2"), lp_fnc(lp, math_atan2));
-    lp_setkv(lp, math_mod, lp_string(lp, "ceil"), lp_fnc(lp, math_ceil));
-    lp_setkv(lp, math_mod, lp_string(lp, "cos"), lp_fnc(lp, math_cos));
-    lp_setkv(lp, math_mod, lp_string(lp, "cosh"), lp_fnc(lp, math_cosh));
-    lp_setkv(lp, math_mod, lp_string(lp, "degrees"), lp_fnc(lp, math_degrees));
-    lp_setkv(lp, math_mod, lp_string(lp, "exp"), lp_fnc(lp, math_exp));
-    lp_setkv(lp, math_mod, lp_string(lp, "fabs"), lp_fnc(lp, math_fabs));
-    lp_setkv(lp, math_mod, lp_string(lp, "floor"), lp_fnc(lp, math_floor));
-    lp_setkv(lp, math_mod, lp_string(lp, "fmod"), lp_fnc(lp, math_fmod));
-    lp_setkv(lp, math_mod, lp_string(lp, "frexp"), lp_fnc(lp, math_frexp));
-    lp_setkv(lp, math_mod, lp_string(lp, "hypot"), lp_fnc(lp, math_hypot));
-    lp_setkv(lp, math_mod, lp_string(lp, "ldexp"), lp_fnc(lp, math_ldexp));
-    lp_setkv(lp, math_mod, lp_string(lp, "log"), lp_fnc(lp, math_log));
-    lp_setkv(lp, math_mod, lp_string(lp, "log10"), lp_fnc(lp, math_log10));
-    lp_setkv(lp, math_mod, lp_string(lp, "modf"), lp_fnc(lp, math_modf));
-    lp_setkv(lp, math_mod, lp_string(lp, "pow"), lp_fnc(lp, math_pow));
-    lp_setkv(lp, math_mod, lp_string(lp, "radians"), lp_fnc(lp, math_radians));
-    lp_setkv(lp, math_mod, lp_string(lp, "sin"), lp_fnc(lp, math_sin));
-    lp_setkv(lp, math_mod, lp_string(lp, "sinh"), lp_fnc(lp, math_sinh));
-    lp_setkv(lp, math_mod, lp_string(lp, "sqrt"), lp_fnc(lp, math_sqrt));
-    lp_setkv(lp, math_mod, lp_string(lp, "tan"), lp_fnc(lp, math_tan));
-    lp_setkv(lp, math_mod, lp_string(lp, "tanh"), lp_fnc(lp, math_tanh));
+    lp_setkv(lp, math_mod, lp_string(lp, "acos"), lp_vfnc(lp, math_acos));
+    lp_setkv(lp, math_mod, lp_string(lp, "asin"), lp_vfnc(lp, math_asin));
+    lp_setkv(lp, math_mod, lp_string(lp, "atan"), lp_vfnc(lp, math_atan));
+    lp_setkv(lp, math_mod, lp_string(lp, "atan2"), lp_vfnc(lp, math_atan2));
+    lp_setkv(lp, math_mod, lp_string(lp, "ceil"), lp_vfnc(lp, math_ceil));
+    lp_setkv(lp, math_mod, lp_string(lp, "cos"), lp_vfnc(lp, math_cos));
+    lp_setkv(lp, math_mod, lp_string(lp, "cosh"), lp_vfnc(lp, math_cosh));
+    lp_setkv(lp, math_mod, lp_string(lp, "degrees"), lp_vfnc(lp, math_degrees));
+    lp_setkv(lp, math_mod, lp_string(lp, "exp"), lp_vfnc(lp, math_exp));
+    lp_setkv(lp, math_mod, lp_string(lp, "fabs"), lp_vfnc(lp, math_fabs));
+    lp_setkv(lp, math_mod, lp_string(lp, "floor"), lp_vfnc(lp, math_floor));
+    lp_setkv(lp, math_mod, lp_string(lp, "fmod"), lp_vfnc(lp, math_fmod));
+    lp_setkv(lp, math_mod, lp_string(lp, "frexp"), lp_vfnc(lp, math_frexp));
+    lp_setkv(lp, math_mod, lp_string(lp, "hypot"), lp_vfnc(lp, math_hypot));
+    lp_setkv(lp, math_mod, lp_string(lp, "ldexp"), lp_vfnc(lp, math_ldexp));
+    lp_setkv(lp, math_mod, lp_string(lp, "log"), lp_vfnc(lp, math_log));
+    lp_setkv(lp, math_mod, lp_string(lp, "log10"), lp_vfnc(lp, math_log10));
+    lp_setkv(lp, math_mod, lp_string(lp, "modf"), lp_vfnc(lp, math_modf));
+    lp_setkv(lp, math_mod, lp_string(lp, "pow"), lp_vfnc(lp, math_pow));
+    lp_setkv(lp, math_mod, lp_string(lp, "radians"), lp_vfnc(lp, math_radians));
+    lp_setkv(lp, math_mod, lp_string(lp, "sin"), lp_vfnc(lp, math_sin));
+    lp_setkv(lp, math_mod, lp_string(lp, "sinh"), lp_vfnc(lp, math_sinh));
+    lp_setkv(lp, math_mod, lp_string(lp, "sqrt"), lp_vfnc(lp, math_sqrt));
+    lp_setkv(lp, math_mod, lp_string(lp, "tan"), lp_vfnc(lp, math_tan));
+    lp_setkv(lp, math_mod, lp_string(lp, "tanh"), lp_vfnc(lp, math_tanh));
 
     /*
      * bind special attributes to math module
@@ -208,19 +208,20 @@ static lp_obj* random_seed(LP)
 {
     lp_obj* arg = LP_OBJ(0);
 
-    if (arg->type == LP_NONE) {
+    if (lp_typeof(arg) == LP_NONE) {
         time_t now;
 
         (void)time(&now);
         init_genrand(&_gRandom, (unsigned long)now);
         _gRandom.has_seed = 1;
-    } else if (arg->type == LP_INT) {
-        init_genrand(&_gRandom, (unsigned long)arg->integer);
+    } else if (lp_typeof(arg) == LP_INT) {
+        init_genrand(&_gRandom, (unsigned long)lp_integer(arg));
         _gRandom.has_seed = 1;
-    } else if (arg->type == LP_STRING) {
+    } else if (lp_typeof(arg) == LP_STRING) {
         unsigned long seed;
         
-        seed = (unsigned long)lp_hash(lp, arg);
+        /* not lp_hash, whose seed changes between runs */
+        seed = (unsigned long)_lua_hash(arg->string.val, arg->string.len);
         init_genrand(&_gRandom, seed);
         _gRandom.has_seed = 1;
     } else {
@@ -261,10 +262,10 @@ static lp_obj* random_setstate(LP)
 
     for (i = 0; i < N; i++) {
         state_elem = lp_getk(lp, state_list, lp_number_from_int(lp, i));
-        _gRandom.state[i] = (unsigned long)state_elem->integer;
+        _gRandom.state[i] = (unsigned long)lp_integer(state_elem) & 0xffffffffUL;
     }
     state_elem = lp_getk(lp, state_list, lp_number_from_int(lp, i));
-    _gRandom.index = (int)state_elem->integer;
+    _gRandom.index = (int)lp_integer(state_elem);
 
     RETURN_LP_NONE;
 }
@@ -628,7 +629,7 @@ lp_obj* random_uniform(LP)
         lp_raise(0,lp_printf(lp, "%s: a(%f) must be less than b(%f)", a, b));
 
     rvo = random_random(lp);
-    r = a + (b - a) * rvo->doublen;
+    r = a + (b - a) * lp_doublen(rvo);
 	LP_OBJ_DEC(rvo);
     
     return (lp_number_from_double(lp, r));
@@ -657,10 +658,10 @@ lp_obj* random_normalvariate(LP)
     NV_MAGICCONST = 4.0 * exp(-0.5) / sqrt(2.0);
     while (1) {
         rvo = random_random(lp);
-        u1  = rvo->doublen;
+        u1  = lp_doublen(rvo);
 		LP_OBJ_DEC(rvo);
         rvo = random_random(lp);
-        u2  = 1.0 - rvo->doublen;
+        u2  = 1.0 - lp_doublen(rvo);
 		LP_OBJ_DEC(rvo);
         z   = NV_MAGICCONST * (u1 - 0.5) / u2;
         zz  = z * z / 4.0;
@@ -694,7 +695,7 @@ lp_obj* random_lognormvariate(LP)
      */
     lp_params_v_x(lp, 2, lp_number_from_double(lp, mu), lp_number_from_double(lp, sigma));
     normvar = lp_ez_call(lp, "random", "normalvariate");
-    r = exp(normvar->doublen);
+    r = exp(lp_doublen(normvar));
 	LP_OBJ_DEC(normvar);
 
     return (lp_number_from_double(lp, r));
@@ -714,7 +715,7 @@ lp_obj* random_expovariate(LP)
 
     do {
         rvo = random_random(lp);
-        u = rvo->doublen;
+        u = lp_doublen(rvo);
 		LP_OBJ_DEC(rvo);
     } while (u <= 0.0000001);
 
@@ -754,7 +755,7 @@ lp_obj* random_vonmisesvariate(LP)
 
     if (kappa <= 1e-6) {
         rvo = random_random(lp);
-        theta = TWOPI * rvo->doublen;
+        theta = TWOPI * lp_doublen(rvo);
 		LP_OBJ_DEC(rvo);
         return (lp_number_from_double(lp, theta));
     }
@@ -765,7 +766,7 @@ lp_obj* random_vonmisesvariate(LP)
 
     while (1) {
         rvo = random_random(lp);
-        u1 = rvo->doublen;
+        u1 = lp_doublen(rvo);
 		LP_OBJ_DEC(rvo);
 
         z = cos(M_PI * u1);
@@ -773,7 +774,7 @@ lp_obj* random_vonmisesvariate(LP)
         c = kappa * (r - f);
 
         rvo = random_random(lp);
-        u2 = rvo->doublen;
+        u2 = lp_doublen(rvo);
 		LP_OBJ_DEC(rvo);
 
         if ((u2 < (c * (2.0 - c))) ||
@@ -782,7 +783,7 @@ lp_obj* random_vonmisesvariate(LP)
     }
 
     rvo = random_random(lp);
-    u3 = rvo->doublen;
+    u3 = lp_doublen(rvo);
 	LP_OBJ_DEC(rvo);
     if (u3 > 0.5)
         theta = fmod(mu, TWOPI) + acos(f);
@@ -834,12 +835,12 @@ lp_obj* random_gammavariate(LP)
 
         while (1) {
             rvo = random_random(lp);
-            u1 = rvo->doublen;
+            u1 = lp_doublen(rvo);
 			LP_OBJ_DEC(rvo);
             if (! ((1e-7 < u1) && (u1 < 0.9999999)))
                 continue;
             rvo = random_random(lp);
-            u2 = 1.0 - rvo->doublen;
+            u2 = 1.0 - lp_doublen(rvo);
 			LP_OBJ_DEC(rvo);
             v = log(u1 / (1.0 - u1)) / ainv;
             x = alpha * exp(v);
@@ -862,7 +863,7 @@ lp_obj* random_gammavariate(LP)
 
         do {
             rvo = random_random(lp);
-            u = rvo->doublen;
+            u = lp_doublen(rvo);
 			LP_OBJ_DEC(rvo);
         } while (u <= 1e-7);
 
@@ -880,7 +881,7 @@ lp_obj* random_gammavariate(LP)
 
         while (1) {
             rvo = random_random(lp);
-            u = rvo->doublen;
+            u = lp_doublen(rvo);
 			LP_OBJ_DEC(rvo);
             b = (M_E + alpha) / M_E;
             p = b * u;
@@ -890,7 +891,7 @@ lp_obj* random_gammavariate(LP)
             else
                 x = - log((b - p) / alpha);
             rvo = random_random(lp);
-            u1 = rvo->doublen;
+            u1 = lp_doublen(rvo);
 			LP_OBJ_DEC(rvo);
             if (p > 1.0) {
                 /*FIXME: if u1 <= x ** (alpha - 1.0):*/
@@ -939,14 +940,14 @@ lp_obj* random_betavariate(LP)
 
     lp_params_v_x(lp, 2, lp_number_from_double(lp, alpha), lp_number_from_double(lp, 1.0));
     y = lp_ez_call(lp, "random", "gammavariate");
-    if (y->doublen == 0) {
+    if (lp_doublen(y) == 0) {
         return (y);
     } else {
         lp_params_v_x(lp, 2, lp_number_from_double(lp, beta), lp_number_from_double(lp, 1.0));
-        t = y->doublen;
+        t = lp_doublen(y);
 		LP_OBJ_DEC(y);
         y = lp_ez_call(lp, "random", "gammavariate");
-        r = t / (t + y->doublen);
+        r = t / (t + lp_doublen(y));
 		LP_OBJ_DEC(y);
         return (lp_number_from_double(lp, r));
     }
@@ -964,7 +965,7 @@ lp_obj* random_paretovariate(LP)
     lp_obj* rvo;
     
     rvo = random_random(lp);
-    u = 1.0 - rvo->doublen;
+    u = 1.0 - lp_doublen(rvo);
     r = 1.0 / pow(u, 1.0/alpha);
 	LP_OBJ_DEC(rvo);
     
@@ -987,7 +988,7 @@ lp_obj* random_weibullvariate(LP)
     lp_obj* rvo;
     
     rvo = random_random(lp);
-    u = 1.0 - rvo->doublen;
+    u = 1.0 - lp_doublen(rvo);
     r = alpha * pow(-log(u), 1.0/beta);
 	LP_OBJ_DEC(rvo);
 
@@ -1006,22 +1007,22 @@ lp_obj* random_randrange(LP)
     lp_obj* stop = LP_OBJ(1);
     int step = LP_INTEGER_DEFAULT(2, 1);
     lp_obj* rvo = random_random(lp);
-    int istart = start->integer;
+    int istart = (int)lp_type_number(lp, start);
     int istep = step;
     int istop;
     int iwidth;
     double res;
     
-    if (stop->type == LP_NONE) {
+    if (lp_typeof(stop) == LP_NONE) {
         /*
                         * if only one argument, then start just means stop
                         */
         istop = istart;
-        res = (rvo->doublen * istop);
+        res = (lp_doublen(rvo) * istop);
 		LP_OBJ_DEC(rvo);
         return (lp_number_from_double(lp, res));
-    } else if (stop->type == LP_INT) {
-        istop = stop->integer;
+    } else if (lp_typeof(stop) == LP_INT) {
+        istop = lp_integer(stop);
         iwidth = istop - istart;
         if (iwidth < 0)
             lp_raise(0,lp_printf(lp, "%s", "stop must be > start"));
@@ -1029,12 +1030,12 @@ lp_obj* random_randrange(LP)
             lp_raise(0,lp_printf(lp, "%s", "step must be integer larger than 0"));
             
         if (istep == 1) {
-            res = (int)(istart + (int)(rvo->doublen * iwidth));
+            res = (int)(istart + (int)(lp_doublen(rvo) * iwidth));
 			LP_OBJ_DEC(rvo);
             return (lp_number_from_int(lp, res));
         } else {
             int n = (iwidth + istep - 1) / istep;
-            res = (int)(istart + istep * (int)(n * rvo->doublen));
+            res = (int)(istart + istep * (int)(n * lp_doublen(rvo)));
 			LP_OBJ_DEC(rvo);
             return (lp_number_from_int(lp, res));
         }
@@ -1072,7 +1073,7 @@ lp_obj* random_choice(LP)
         lp_raise(0,lp_printf(lp, "%s", "seq mustn't be empty"));
     
     rvo = random_random(lp);
-    i = (int)(len * rvo->doublen);
+    i = (int)(len * lp_doublen(rvo));
 	LP_OBJ_DEC(rvo);
     r = lp_getk(lp, seq, lp_number_from_int(lp, i));
     
@@ -1101,7 +1102,7 @@ lp_obj* random_shuffle(LP)
                        */
         lp_params_v_x(lp, 2, lp_number_from_int(lp, 0), lp_number_from_int(lp, len / 2));
         rvo = lp_ez_call(lp, "random", "randint");
-        j = (int)rvo->doublen;
+        j = (int)lp_type_number(lp, rvo);
 		LP_OBJ_DEC(rvo);
         elmi = lp_getk(lp, seq, lp_number_from_int(lp, i));
         elmj = lp_getk(lp, seq, lp_number_from_int(lp, j));
@@ -1117,7 +1118,7 @@ lp_obj* random_shuffle(LP)
                        */
         lp_params_v_x(lp, 2, lp_number_from_int(lp, len / 2), lp_number_from_int(lp, len - 1));
         rvo = lp_ez_call(lp, "random", "randint");
-        j = (int)rvo->doublen;
+        j = (int)lp_type_number(lp, rvo);
 		LP_OBJ_DEC(rvo);
         elmi = lp_getk(lp, seq, lp_number_from_int(lp, i));
         elmj = lp_getk(lp, seq, lp_number_from_int(lp, j));
@@ -350,9 +350,9 @@ static lp_obj* match_obj_group(LP)
 	} else {
 		i = 0;
 		LP_LOOP(1, grpidx)
-		if (grpidx->integer < 0 || grpidx->integer > RE_NREGS)
+		if (lp_integer(grpidx) < 0 || lp_integer(grpidx) > RE_NREGS)
 			lp_raise(0, lp_string(lp, "group() grpidx out of range"));
-		indices[i++] = grpidx->integer;
+		indices[i++] = lp_integer(grpidx);
 		LP_END
 	}
 
@@ -519,7 +519,7 @@ static lp_obj* regex_compile(LP)
 	 */
 	reobj = lp_object(lp);
 
-	re = (regexobject *)malloc(sizeof(regexobject));
+	re = (regexobject *)lp_malloc(lp, sizeof(regexobject));
 	if (!re) {
 		error = "malloc lower level regex object failed";
 		goto finally;
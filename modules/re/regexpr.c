@@ -821,7 +821,7 @@ static int re_optimize_star_jump(regexp_t bufp, unsigned char *code)
 	p2 = code;
 	/* p1 points inside loop, p2 points to after loop */
 	if (!re_do_compile_fastmap(bufp->buffer, bufp->used,
-				   (int)(p2 - bufp->buffer),
+				   (int)(p2 - (unsigned char *)bufp->buffer),
 				   &can_be_null, map))
 		goto make_normal_jump;
 	
@@ -5,83 +5,85 @@
  * Builtin tinypy functions.
  */
 
-lp_obj* lpf_print(LP) {
-    int n = 0;
-    lp_obj* e;
-    LP_LOOP(0, e)
-        if (n) { printf(" "); }
-        lp_echo(lp,e);
-        n += 1;
-    LP_END;
+lp_obj* lpf_print(LP, LP_ARGS) {
+    int i;
+    for (i=0; i<argc; i++) {
+        if (i) { printf(" "); }
+        lp_echo(lp,argv[i]);
+    }
     printf("\n");
 	RETURN_LP_OBJ(lp->lp_None);
 }
 
-lp_obj* lpf_bind(LP) {
-    lp_obj* r = LP_TYPE(0,LP_FNC);
-    lp_obj* self = LP_OBJ(1);
-    return lp_fnc_new(lp,
+lp_obj* lpf_bind(LP, LP_ARGS) {
+    lp_obj* r = LP_ARG_TYPE(0,LP_FNC);
+    lp_obj* self = LP_ARG(1);
+    lp_obj* m = lp_fnc_new(lp,
         r->fnc.ftype|2,r->fnc.cfnc,r->fnc.info->code,
         self,r->fnc.info->globals);
+    m->fnc.info->consts = r->fnc.info->consts;
+    LP_OBJ_INC(m->fnc.info->consts);
+    return m;
 }
 
-lp_obj* lpf_min(LP) {
-    lp_obj* r = LP_OBJ(0);
-    lp_obj* e;
-    LP_LOOP(1, e)
-        if (lp_cmp(lp,r,e) > 0) { r = e; }
-    LP_END;
+lp_obj* lpf_min(LP, LP_ARGS) {
+    lp_obj* r = LP_ARG(0);
+    int i;
+    for (i=1; i<argc; i++) {
+        if (lp_cmp(lp,r,argv[i]) > 0) { r = argv[i]; }
+    }
 	RETURN_LP_OBJ(r);
 }
 
-lp_obj* lpf_max(LP) {
-    lp_obj* r = LP_OBJ(0);
-    lp_obj* e;
-    LP_LOOP(1, e)
-        if (lp_cmp(lp,r,e) < 0) { r = e; }
-    LP_END;
+lp_obj* lpf_max(LP, LP_ARGS) {
+    lp_obj* r = LP_ARG(0);
+    int i;
+    for (i=1; i<argc; i++) {
+        if (lp_cmp(lp,r,argv[i]) < 0) { r = argv[i]; }
+    }
 	RETURN_LP_OBJ(r);
 }
 
-lp_obj* lpf_copy(LP) {
-    lp_obj* r = LP_OBJ(0);
-    int type = r->type;
+lp_obj* lpf_copy(LP, LP_ARGS) {
+    lp_obj* r = LP_ARG(0);
+    int type = lp_typeof(r);
     if (type == LP_LIST) {
         return lp_list_copy(lp,r);
     } else if (type == LP_DICT) {
         return lp_dict_copy(lp,r);
+    } else if (type == LP_RANGE) {
+        lp_obj* l = lp_list(lp);
+        int i;
+        for (i = 0; i < r->range.len; i++) {
+            _lp_list_appendx(lp,l->list,lp_number_from_llong(lp, r->range.start + (long long)i*r->range.step));
+            if (lp->ex) { LP_OBJ_DEC(l); return 0; }
+        }
+        return l;
     }
     lp_raise(0,lp_string(lp, "(lp_copy) TypeError: ?"));
 }
 
 
-lp_obj* lpf_len(LP) {
-    lp_obj* e = LP_OBJ(0);
+lp_obj* lpf_len(LP, LP_ARGS) {
+    lp_obj* e = LP_ARG(0);
     return lp_len(lp,e);
 }
 
-lp_obj* lpf_assert(LP) {
-    int a = LP_NUM(0);
+lp_obj* lpf_assert(LP, LP_ARGS) {
+    int a = LP_ARG_NUM(0);
     if (a) { RETURN_LP_OBJ(lp->lp_None); }
     lp_raise(0,lp_string(lp, "(lp_assert) AssertionError"));
 }
 
-lp_obj* lpf_range(LP) {
-    int a,b,c,i;
-    lp_obj* r = lp_list(lp);
-    switch (lp->params->list->len) {
-        case 1: a = 0; b = LP_INTEGER(0); c = 1; break;
+lp_obj* lpf_range(LP, LP_ARGS) {
+    int a,b,c;
+    switch (argc) {
+        case 1: a = 0; b = LP_ARG_INTEGER(0); c = 1; break;
         case 2:
-        case 3: a = LP_INTEGER(0); b = LP_INTEGER(1); c = LP_INTEGER_DEFAULT(2, 1); break;
-        default: return r;
+        case 3: a = LP_ARG_INTEGER(0); b = LP_ARG_INTEGER(1); c = LP_ARG_INTEGER_DEFAULT(2, 1); break;
+        default: return lp_range(lp, 0, 0, 1);
     }
-    if (c != 0) {
-        for (i=a; (c>0) ? i<b : i>b; i+=c) {
-			lp_obj* t= lp_number_from_int(lp, i);
-            _lp_list_appendx(lp,r->list,t);
-        }
-    }
-    return r;
+    return lp_range(lp, a, b, c);
 }
 
 /* Function: lp_system
@@ -89,37 +91,38 @@ lp_obj* lpf_range(LP) {
  * The system builtin. A grave security flaw. If your version of tinypy
  * enables this, you better remove it before deploying your app :P
  */
-lp_obj* lpf_system(LP) {
-    char s[LP_CSTR_LEN]; lp_cstr(lp,LP_STR(0),s,LP_CSTR_LEN);
+lp_obj* lpf_system(LP, LP_ARGS) {
+    char s[LP_CSTR_LEN]; lp_cstr(lp,LP_ARG_STR(0),s,LP_CSTR_LEN);
     int r = system(s);
     return lp_number_from_int(lp, r);
 }
 
-lp_obj* lpf_istype(LP) {
-    lp_obj* v = LP_OBJ(0);
-    lp_obj* t = LP_STR(1);
-    if (lp_cmp(lp, t, lp_string(lp, "string")) == 0) { return lp_number_from_int(lp, v->type == LP_STRING); }
-    if (lp_cmp(lp, t, lp_string(lp, "list")) == 0) { return lp_number_from_int(lp, v->type == LP_LIST); }
-    if (lp_cmp(lp, t, lp_string(lp, "dict")) == 0) { return lp_number_from_int(lp, v->type == LP_DICT); }
-	if (lp_cmp(lp, t, lp_string(lp, "int")) == 0) { return lp_number_from_int(lp, v->type == LP_INT); }
-    if (lp_cmp(lp, t, lp_string(lp, "float")) == 0) { return lp_number_from_int(lp, v->type == LP_DOUBLE); }
-	if (lp_cmp(lp, t, lp_string(lp, "number")) == 0) { return lp_number_from_int(lp, v->type == LP_INT || v->type == LP_DOUBLE); }
-    if (lp_cmp(lp, t, lp_string(lp, "fnc")) == 0) { return lp_number_from_int(lp, v->type == LP_FNC && (v->fnc.ftype&2) == 0); }
-    if (lp_cmp(lp, t, lp_string(lp, "method")) == 0) { return lp_number_from_int(lp, v->type == LP_FNC && (v->fnc.ftype&2) != 0); }
+lp_obj* lpf_istype(LP, LP_ARGS) {
+    lp_obj* v = LP_ARG(0);
+    lp_obj* t = LP_ARG_STR(1);
+    if (lp_cmp(lp, t, lp_string(lp, "string")) == 0) { return lp_number_from_int(lp, lp_typeof(v) == LP_STRING); }
+    if (lp_cmp(lp, t, lp_string(lp, "list")) == 0) { return lp_number_from_int(lp, lp_typeof(v) == LP_LIST); }
+    if (lp_cmp(lp, t, lp_string(lp, "dict")) == 0) { return lp_number_from_int(lp, lp_typeof(v) == LP_DICT); }
+    if (lp_cmp(lp, t, lp_string(lp, "range")) == 0) { return lp_number_from_int(lp, lp_typeof(v) == LP_RANGE); }
+	if (lp_cmp(lp, t, lp_string(lp, "int")) == 0) { return lp_number_from_int(lp, lp_typeof(v) == LP_INT); }
+    if (lp_cmp(lp, t, lp_string(lp, "float")) == 0) { return lp_number_from_int(lp, lp_typeof(v) == LP_DOUBLE); }
+	if (lp_cmp(lp, t, lp_string(lp, "number")) == 0) { return lp_number_from_int(lp, lp_typeof(v) == LP_INT || lp_typeof(v) == LP_DOUBLE); }
+    if (lp_cmp(lp, t, lp_string(lp, "fnc")) == 0) { return lp_number_from_int(lp, lp_typeof(v) == LP_FNC && (v->fnc.ftype&2) == 0); }
+    if (lp_cmp(lp, t, lp_string(lp, "method")) == 0) { return lp_number_from_int(lp, lp_typeof(v) == LP_FNC && (v->fnc.ftype&2) != 0); }
     lp_raise(0, lp_string(lp, "(is_type) TypeError: ?"));
 }
 
 
-lp_obj* lpf_float(LP) {
-    lp_obj* v = LP_OBJ(0);
-    int ord = LP_INTEGER_DEFAULT(1,0);
-    int type = v->type;
+lp_obj* lpf_float(LP, LP_ARGS) {
+    lp_obj* v = LP_ARG(0);
+    int ord = LP_ARG_INTEGER_DEFAULT(1,0);
+    int type = lp_typeof(v);
 	if (type == LP_DOUBLE)
 	{
 		RETURN_LP_OBJ(v);
 	}
     if (type == LP_INT) {
-		return lp_number_from_double(lp, v->integer);
+		return lp_number_from_double(lp, lp_integer(v));
 	}
     if (type == LP_STRING && v->string.len < 32) {
         char s[32]; memset(s,0,v->string.len+1);
@@ -131,9 +134,9 @@ lp_obj* lpf_float(LP) {
 }
 
 
-lp_obj* lpf_save(LP) {
-    char fname[256]; lp_cstr(lp,LP_STR(0),fname,256);
-    lp_obj* v = LP_OBJ(1);
+lp_obj* lpf_save(LP, LP_ARGS) {
+    char fname[256]; lp_cstr(lp,LP_ARG_STR(0),fname,256);
+    lp_obj* v = LP_ARG(1);
     FILE *f;
     f = fopen(fname,"wb");
     if (!f) { lp_raise(0,lp_string(lp, "(lp_save) IOError: ?")); }
@@ -142,12 +145,12 @@ lp_obj* lpf_save(LP) {
 	RETURN_LP_OBJ(lp->lp_None);
 }
 
-lp_obj* lpf_load(LP) {
+lp_obj* lpf_load(LP, LP_ARGS) {
     FILE *f;
     long l;
     lp_obj* r;
     char *s;
-    char fname[256]; lp_cstr(lp,LP_STR(0),fname,256);
+    char fname[256]; lp_cstr(lp,LP_ARG_STR(0),fname,256);
     struct stat stbuf;
     stat(fname, &stbuf);
     l = stbuf.st_size;
@@ -156,6 +159,7 @@ lp_obj* lpf_load(LP) {
         lp_raise(0,lp_string(lp, "(lp_load) IOError: ?"));
     }
     r = lp_string_t(lp,l);
+    if (!r) { fclose(f); return 0; }
     s = r->string.info->s;
     fread(s,1,l,f);
 /*    if (rr !=l) { printf("hmmn: %d %d\n",rr,(int)l); }*/
@@ -164,22 +168,26 @@ lp_obj* lpf_load(LP) {
 }
 
 
-lp_obj* lpf_fpack(LP) {
-    double v = LP_NUM(0);
+lp_obj* lpf_fpack(LP, LP_ARGS) {
+    double v = LP_ARG_NUM(0);
     lp_obj* r = lp_string_t(lp,sizeof(double));
     *(double*)r->string.val = v;
     return r;
 }
 
-lp_obj* lpf_abs(LP) {
-	lp_obj* t = lpf_float(lp);
-	double n = t->doublen;
+lp_obj* lpf_abs(LP, LP_ARGS) {
+	lp_obj* t = lpf_float(lp, argc, argv);
+	double n;
+	if (!t) { return 0; }
+	n = lp_doublen(t);
 	LP_OBJ_DEC(t);
     return lp_number_from_double(lp, fabs(n));
 }
-lp_obj* lpf_int(LP) {
-	lp_obj* t = lpf_float(lp);
-	double n = t->doublen;
+lp_obj* lpf_int(LP, LP_ARGS) {
+	lp_obj* t = lpf_float(lp, argc, argv);
+	double n;
+	if (!t) { return 0; }
+	n = lp_doublen(t);
 	LP_OBJ_DEC(t);
     return lp_number_from_int(lp, (int)n);
 }
@@ -188,20 +196,22 @@ double _roundf(double v) {
     av = (av-iv < 0.5?iv:iv+1);
     return (v<0?-av:av);
 }
-lp_obj* lpf_round(LP) {
-	lp_obj* t = lpf_float(lp);
-	double n = t->doublen;
+lp_obj* lpf_round(LP, LP_ARGS) {
+	lp_obj* t = lpf_float(lp, argc, argv);
+	double n;
+	if (!t) { return 0; }
+	n = lp_doublen(t);
 	LP_OBJ_DEC(t);
     return lp_number_from_double(lp, _roundf(n));
 }
 
-lp_obj* lpf_exists(LP) {
-    char fname[LP_CSTR_LEN]; lp_cstr(lp,LP_STR(0),fname,LP_CSTR_LEN);
+lp_obj* lpf_exists(LP, LP_ARGS) {
+    char fname[LP_CSTR_LEN]; lp_cstr(lp,LP_ARG_STR(0),fname,LP_CSTR_LEN);
     struct stat stbuf;
     return lp_number_from_int(lp, !stat(fname,&stbuf));
 }
-lp_obj* lpf_mtime(LP) {
-    char fname[LP_CSTR_LEN]; lp_cstr(lp,LP_STR(0),fname,LP_CSTR_LEN);
+lp_obj* lpf_mtime(LP, LP_ARGS) {
+    char fname[LP_CSTR_LEN]; lp_cstr(lp,LP_ARG_STR(0),fname,LP_CSTR_LEN);
     struct stat stbuf;
     if (!stat(fname,&stbuf)) { return lp_number_from_double(lp, stbuf.st_mtime); }
     lp_raise(0,lp_string(lp, "(lp_mtime) IOError: ?"));
@@ -215,12 +225,14 @@ int lp_lookup_(LP,lp_obj* self, lp_obj* k, lp_obj **meta, int depth) {
         return 1;
     }
     depth--; if (!depth) { lp_raise(0,lp_string(lp, "(lp_lookup) RuntimeError: maximum lookup depth exceeded")); }
-    if (self->dict.dtype && self->dict.val->meta && self->dict.val->meta->type == LP_DICT && lp_lookup_(lp,self->dict.val->meta,k,meta,depth)) {
-        if (self->dict.dtype == 2 && (*meta)->type == LP_FNC) {
+    if (self->dict.dtype && self->dict.val->meta && lp_typeof(self->dict.val->meta) == LP_DICT && lp_lookup_(lp,self->dict.val->meta,k,meta,depth)) {
+        if (self->dict.dtype == 2 && lp_typeof(*meta) == LP_FNC) {
 			lp_obj* t = *meta;
             *meta = lp_fnc_new(lp,t->fnc.ftype|2,
                 t->fnc.cfnc,t->fnc.info->code,
                 self,t->fnc.info->globals);
+			(*meta)->fnc.info->consts = t->fnc.info->consts;
+			LP_OBJ_INC(t->fnc.info->consts);
 			LP_OBJ_DEC(t);
         }
         return 1;
@@ -239,6 +251,14 @@ int lp_lookupx(LP, lp_obj* self, const char* k, lp_obj **meta) {
 	return r;
 }
 
+/* meta is now the meta of some dict. Changes to it and its own metas move
+ * lp->meta_version from now on, so the attribute caches of the VM see them */
+static void _lp_meta_watch(LP, lp_obj* meta) {
+    if (lp_typeof(meta) != LP_DICT || meta->dict.val->is_meta) { return; }
+    meta->dict.val->is_meta = 1;
+    lp->meta_version++;
+}
+
 /* Function: lp_setmeta
  * Set a "dict's meta".
  *
@@ -261,16 +281,18 @@ int lp_lookupx(LP, lp_obj* self, const char* k, lp_obj **meta) {
  * Returns:
  * None
  */
-lp_obj* lpf_setmeta(LP) {
-    lp_obj* self = LP_TYPE(0, LP_DICT);
-    lp_obj* meta = LP_TYPE(1, LP_DICT);
+lp_obj* lpf_setmeta(LP, LP_ARGS) {
+    lp_obj* self = LP_ARG_TYPE(0, LP_DICT);
+    lp_obj* meta = LP_ARG_TYPE(1, LP_DICT);
     self->dict.val->meta = meta;
 	LP_OBJ_INC(meta);
+    _lp_meta_watch(lp, meta);
+    if (self->dict.val->is_meta) { lp->meta_version++; }
     RETURN_LP_OBJ(lp->lp_None);
 }
 
-lp_obj* lpf_getmeta(LP) {
-    lp_obj* self = LP_TYPE(0, LP_DICT);
+lp_obj* lpf_getmeta(LP, LP_ARGS) {
+    lp_obj* self = LP_ARG_TYPE(0, LP_DICT);
 	RETURN_LP_OBJ(self->dict.val->meta);
 }
 
@@ -284,6 +306,7 @@ lp_obj* lpf_getmeta(LP) {
 lp_obj* lp_object(LP) {
     lp_obj* self = lp_dict(lp);
     self->dict.dtype = 2;
+    self->dict.val->shape = lp->shape_root;
     return self;
 }
 
@@ -292,6 +315,7 @@ lp_obj* lpf_object_new(LP) {
     lp_obj* self = lp_object(lp);
 	lp_obj* r;
     self->dict.val->meta = klass;
+    _lp_meta_watch(lp, klass);
     LP_META_BEGIN(self, "__init__");
         r = lp_call(lp,meta);
 		LP_OBJ_DEC(meta);
@@ -306,6 +330,7 @@ lp_obj* lpf_object_call(LP) {
     if (lp->params->list->len) {
         self = LP_TYPE(0, LP_DICT);
         self->dict.dtype = 2;
+        if (self->dict.val->is_meta) { lp->meta_version++; }
     } else {
         self = lp_object(lp);
     }
@@ -320,10 +345,12 @@ lp_obj* lpf_object_call(LP) {
  * functions, as it allows you to directly access the attributes stored in the
  * dict.
  */
-lp_obj* lpf_getraw(LP) {
-    lp_obj* self = LP_TYPE(0, LP_DICT);
+lp_obj* lpf_getraw(LP, LP_ARGS) {
+    lp_obj* self = LP_ARG_TYPE(0, LP_DICT);
 	if (!self) return 0;
     self->dict.dtype = 0;
+    /* a meta without a type ends the lookup through it */
+    if (self->dict.val->is_meta) { lp->meta_version++; }
 	LP_OBJ_INC(self);
     return self;
 }
@@ -342,6 +369,7 @@ lp_obj* lp_class(LP) {
 	lp_obj* k = lp_string(lp, "object");
     lp_obj* f = lp_get(lp,lp->builtins,k);
 	klass->dict.val->meta = f;
+	_lp_meta_watch(lp, f);
 	LP_OBJ_DEC(k);
     return klass;
 }
@@ -349,7 +377,7 @@ lp_obj* lp_class(LP) {
 /* Function: lp_builtins_bool
  * Coerces any value to a boolean.
  */
-lp_obj* lpf_builtins_bool(LP) {
-    lp_obj* v = LP_OBJ(0);
+lp_obj* lpf_builtins_bool(LP, LP_ARGS) {
+    lp_obj* v = LP_ARG(0);
     return (lp_number_from_int(lp, lp_bool(lp, v)));
 }
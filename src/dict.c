@@ -12,106 +12,280 @@ int _lua_hash(void const *v,int l) {
     }
     return h;
 }
+/* multiply-shift: the high bits of the product depend on every bit of n,
+ * and the index takes its slot from the low ones, so they are folded down */
+static int _lp_int_hash(int n) {
+    unsigned int h = (unsigned int)n * 0x9E3779B1u;
+    return (int)(h ^ (h >> 16));
+}
 void _lp_dict_free(LP, _lp_dict *self) {
     lp_item_release(lp, self->alloc, self->item_pool, self->item_index);
     lp_dict_release(lp, self);
 }
 
-/* void _lp_dict_reset(_lp_dict *self) {
-       memset(self->items,0,self->alloc*sizeof(lp_item));
-       self->len = 0;
-       self->used = 0;
-       self->cur = 0;
-   }*/
+/* The hash of strings is wyhash: 8 bytes are read at a time, and each
+ * 16 bytes are mixed by a 64x64->128 bit multiply whose halves are xored.
+ * Past 48 bytes three of those run side by side, which the CPU overlaps.
+ * Every byte counts, and the seed is random per VM, so keys that collide
+ * can neither be had by chance nor be worked out in advance. */
+#define WY_S0 0xa0761d6478bd642full
+#define WY_S1 0xe7037ed1a0b428dbull
+#define WY_S2 0x8ebc6af09c88c6e3ull
+#define WY_S3 0x589965cc75374cc3ull
+
+static void _wy_mum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (uint64_t)r;
+    *b = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t)*a, lb = (uint32_t)*b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl, lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+static uint64_t _wy_mix(uint64_t a, uint64_t b) { _wy_mum(&a, &b); return a ^ b; }
+static uint64_t _wy_r8(const unsigned char *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static uint64_t _wy_r4(const unsigned char *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+
+uint64_t _lp_wyhash(const void *key, int len, uint64_t seed) {
+    const unsigned char *p = (const unsigned char *)key;
+    uint64_t a, b;
+    int i = len;
+    seed ^= _wy_mix(seed ^ WY_S0, WY_S1);
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (_wy_r4(p) << 32) | _wy_r4(p + ((len >> 3) << 2));
+            b = (_wy_r4(p + len - 4) << 32) | _wy_r4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        if (i > 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = _wy_mix(_wy_r8(p) ^ WY_S1, _wy_r8(p + 8) ^ seed);
+                see1 = _wy_mix(_wy_r8(p + 16) ^ WY_S2, _wy_r8(p + 24) ^ see1);
+                see2 = _wy_mix(_wy_r8(p + 32) ^ WY_S3, _wy_r8(p + 40) ^ see2);
+                p += 48; i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = _wy_mix(_wy_r8(p) ^ WY_S1, _wy_r8(p + 8) ^ seed);
+            p += 16; i -= 16;
+        }
+        a = _wy_r8(p + i - 16);
+        b = _wy_r8(p + i - 8);
+    }
+    a ^= WY_S1;
+    b ^= seed;
+    _wy_mum(&a, &b);
+    return _wy_mix(a ^ WY_S0 ^ (uint64_t)len, b ^ WY_S1);
+}
 
+/* Function: lp_hash
+ * The hash of a value for dictionaries.
+ *
+ * Strings hash with lp->hash_seed, so their hashes differ between VMs and
+ * between runs. Set LP_HASHSEED in the environment to a number to fix it.
+ */
 int lp_hash(LP,lp_obj* v) {
-    switch (v->type) {
+    switch (lp_typeof(v)) {
         case LP_NONE: return 0;
-		case LP_INT: {
-			double d = v->integer;
-			return _lua_hash(&d, sizeof(double));
-		}
+		case LP_INT: return _lp_int_hash(lp_integer(v));
 		case LP_DOUBLE: {
-			double d = v->doublen;
+			double d = lp_doublen(v);
 			return _lua_hash(&d, sizeof(double));
 		}
-        case LP_STRING: return _lua_hash(v->string.val,v->string.len);
+        case LP_STRING:
+            if (!v->string.hash) {
+                uint64_t h = _lp_wyhash(v->string.val,v->string.len,lp->hash_seed);
+                int t = (int)(h ^ (h >> 32));
+                v->string.hash = t ? t : 1;
+            }
+            return v->string.hash;
         case LP_DICT: return _lua_hash(&v->dict.val,sizeof(void*));
         case LP_LIST: {
             int r = v->list->len; int n; for(n=0; n<v->list->len; n++) {
-            lp_obj* vv = v->list->items[n]; r += vv->type != LP_LIST?lp_hash(lp,v->list->items[n]) : _lua_hash(&vv->list,sizeof(void*)); } return r;
+            lp_obj* vv = v->list->items[n]; r += lp_typeof(vv) != LP_LIST?lp_hash(lp,v->list->items[n]) : _lua_hash(&vv->list,sizeof(void*)); } return r;
         }
         case LP_FNC: return _lua_hash(&v->fnc.info,sizeof(void*));
         case LP_DATA: return _lua_hash(&v->data.val,sizeof(void*));
+        case LP_RANGE: {
+            /* equal ranges may have been built with different stops */
+            int h[3];
+            h[0] = v->range.len;
+            h[1] = v->range.len ? v->range.start : 0;
+            h[2] = v->range.len > 1 ? v->range.step : 0;
+            return _lua_hash(h, sizeof(h));
+        }
     }
     lp_raise(0,lp_string(lp, "(lp_hash) TypeError: value unhashable"));
 }
 
-void _lp_dict_hash_set(LP,_lp_dict *self, int hash, lp_obj* k, lp_obj* v) {
-    lp_item item;
-    int i,idx = hash&self->mask;
-    for (i=idx; i<idx+self->alloc; i++) {
-        int n = i&self->mask;
-        if (self->items[n].used > 0) { continue; }
-        if (self->items[n].used == 0) { self->used += 1; }
-        item.used = 1;
-        item.hash = hash;
-        item.key = k;
-		LP_OBJ_INC(k);
-        item.val = v;
-		LP_OBJ_INC(v);
-        self->items[n] = item;
-        self->len += 1;
-        return;
+/* The entries are kept in insertion order in items, a dense array of alloc
+ * of them of which the first used have been taken; deleting an entry marks
+ * it with used -1 and leaves a hole until the next resize. Behind the
+ * entries is the index, mask+1 ints (a power of two) that the hashes are
+ * probed in: 0 is an empty slot, -1 a slot whose entry was deleted and n
+ * stands for items[n-1]. alloc is half the index, which keeps probe runs short
+ * and always ends them at an empty slot.
+ *
+ * Like the array part of a Lua table, the entries 0 to asize-1 are known to
+ * have the keys 0 to asize-1, which is what a dict filled with counting keys
+ * ends up with. Those keys are found by their value without hashing; they
+ * are in the index too, for when the run breaks. */
+#define DICT_INDEX(self) ((int*)((self)->items + (self)->alloc))
+#define DICT_ARRAY(self,k) (lp_is_fixnum(k) && \
+    (unsigned int)lp_fixnum_val(k) < (unsigned int)(self)->asize ? lp_fixnum_val(k) : -1)
+
+/* the number of lp_items the entries and the index take together */
+static int _lp_dict_slots(int alloc, int mask) {
+    return alloc + (int)(((mask+1)*sizeof(int) + sizeof(lp_item) - 1) / sizeof(lp_item));
+}
+
+/* a new shape under parent for its key k, linked into the list of all */
+static lp_shape* _lp_shape_new(LP, lp_shape *parent, lp_obj* k) {
+    lp_shape *s = (lp_shape*)lp_malloc(lp, sizeof(lp_shape));
+    memset(s, 0, sizeof(lp_shape));
+    if (parent) {
+        s->parent = parent;
+        s->sibling = parent->child;
+        parent->child = s;
+        s->len = parent->len + 1;
     }
-    lp_raise(,lp_string(lp, "(_lp_dict_hash_set) RuntimeError: ?"));
+    s->key = k;
+    s->all = lp->shapes;
+    lp->shapes = s;
+    lp->shape_count++;
+    return s;
 }
 
-void _lp_dict_lp_realloc(LP,_lp_dict *self,int len) {
-    lp_item *items = self->items;
-	void* item_pool = self->item_pool;
-	int item_index = self->item_index;
-    int i,alloc = self->alloc;
-    len = _lp_max(8,len);
+/* makes lp->shape_root */
+void _lp_shape_init(LP) {
+    lp->shape_root = _lp_shape_new(lp, 0, 0);
+}
 
-    self->items = lp_item_malloc(lp, len, &self->item_pool, &self->item_index);
-    self->alloc = len; self->mask = len-1;
-    self->len = 0; self->used = 0;
+/* frees every shape */
+void _lp_shape_deinit(LP) {
+    while (lp->shapes) {
+        lp_shape *s = lp->shapes;
+        lp->shapes = s->all;
+        lp_free(lp, s, sizeof(lp_shape));
+    }
+    lp->shape_root = 0;
+    lp->shape_count = 0;
+}
 
-    for (i=0; i<alloc; i++) {
-        if (items[i].used != 1) { continue; }
-        _lp_dict_hash_set(lp,self,items[i].hash,items[i].key,items[i].val);
+/* the shape of an object of shape s that gets the new key k, or 0 when k is
+ * no interned string or there are too many keys or shapes for another */
+lp_shape* _lp_shape_add(LP, lp_shape *s, lp_obj* k) {
+    lp_shape *c;
+    _lp_dict *strings;
+    int n;
+    for (c = s->child; c; c = c->sibling) {
+        if (c->key == k) { return c; }
     }
-	
-	if (items)
-	{
-		lp_item_release(lp, alloc, item_pool, item_index);
-	}
+    if (lp_typeof(k) != LP_STRING || s->len >= LP_SHAPE_KEYS || lp->shape_count >= LP_SHAPES) { return 0; }
+    strings = lp->strings->dict.val;
+    n = _lp_dict_hash_find(lp, strings, lp_hash(lp,k), k);
+    if (n < 0 || strings->items[n].key != k) { return 0; }
+    return _lp_shape_new(lp, s, k);
 }
 
-int _lp_dict_hash_find(LP,_lp_dict *self, int hash, lp_obj* k) {
-    int i,idx = hash&self->mask;
-    for (i=idx; i<idx+self->alloc; i++) {
-        int n = i&self->mask;
-        if (self->items[n].used == 0) { break; }
-        if (self->items[n].used < 0) { continue; }
-        if (self->items[n].hash != hash) { continue; }
-        if (lp_cmp(lp,self->items[n].key,k) != 0) { continue; }
-        return n;
+/* appends an entry for k, which must not be in self yet, there must be room */
+void _lp_dict_hash_set(LP,_lp_dict *self, int hash, lp_obj* k, lp_obj* v) {
+    int *index = DICT_INDEX(self);
+    int i = hash&self->mask;
+    lp_item *item = &self->items[self->used];
+    if (self->shape) { self->shape = _lp_shape_add(lp, self->shape, k); }
+    if (self->asize == self->used && k == lp_fixnum(self->used)) { self->asize++; }
+    while (index[i] > 0) { i = (i+1)&self->mask; }
+    index[i] = ++self->used;
+    item->used = 1;
+    item->hash = hash;
+    item->key = k;
+    LP_OBJ_INC(k);
+    item->val = v;
+    LP_OBJ_INC(v);
+    self->len += 1;
+}
+
+/* moves the entries to storage with room for len of them, which drops the
+ * holes; returns 0 and leaves self as it is if there is no memory for it */
+int _lp_dict_lp_realloc(LP,_lp_dict *self,int len) {
+    lp_item *items = self->items, *r;
+    void* item_pool = self->item_pool;
+    int item_index = self->item_index;
+    int i,j,*index,alloc = self->alloc,used = self->used,size = 8;
+    while (size/2 < len) { size *= 2; }
+
+    r = lp_item_malloc(lp, _lp_dict_slots(size/2,size-1), &self->item_pool, &self->item_index);
+    if (!r) { return 0; }
+    self->items = r;
+    self->alloc = size/2; self->mask = size-1;
+    index = DICT_INDEX(self);
+    self->asize = 0;
+    for (i=0,j=0; i<used; i++) {
+        int n;
+        if (items[i].used <= 0) { continue; }
+        n = items[i].hash&self->mask;
+        while (index[n]) { n = (n+1)&self->mask; }
+        self->items[j] = items[i];
+        if (self->asize == j && items[i].key == lp_fixnum(j)) { self->asize++; }
+        index[n] = ++j;
+    }
+    self->used = j;
+
+    if (items)
+    {
+        lp_item_release(lp, alloc, item_pool, item_index);
+    }
+    return 1;
+}
+
+/* the index slot of k, or -1 */
+static int _lp_dict_slot(LP,_lp_dict *self, int hash, lp_obj* k) {
+    int *index = DICT_INDEX(self);
+    int i = hash&self->mask;
+    if (!self->alloc) { return -1; }
+    while (1) {
+        int n = index[i];
+        if (n == 0) { return -1; }
+        if (n > 0) {
+            lp_item *item = &self->items[n-1];
+            if (item->key == k) { return i; }
+            /* equal small ints are the same immediate */
+            if (item->hash == hash && !lp_is_fixnum(k) && lp_cmp(lp,item->key,k) == 0) { return i; }
+        }
+        i = (i+1)&self->mask;
     }
-    return -1;
+}
+
+/* the entry of k, or -1 */
+int _lp_dict_hash_find(LP,_lp_dict *self, int hash, lp_obj* k) {
+    int i = _lp_dict_slot(lp,self,hash,k);
+    return i < 0 ? -1 : DICT_INDEX(self)[i] - 1;
 }
 int _lp_dict_find(LP,_lp_dict *self,lp_obj* k) {
-    return _lp_dict_hash_find(lp,self,lp_hash(lp,k),k);
+    int n = DICT_ARRAY(self,k);
+    return n >= 0 ? n : _lp_dict_hash_find(lp,self,lp_hash(lp,k),k);
 }
 
 void _lp_dict_set(LP,_lp_dict *self,lp_obj* k, lp_obj* v) {
-    int hash = lp_hash(lp,k); int n = _lp_dict_hash_find(lp,self,hash,k);
+    int hash = 0, n = DICT_ARRAY(self,k);
+    if (n < 0) { hash = lp_hash(lp,k); n = _lp_dict_hash_find(lp,self,hash,k); }
+    LP_DICT_CHANGED(lp,self);
     if (n == -1) {
-        if (self->len >= (self->alloc/2)) {
-            _lp_dict_lp_realloc(lp,self,self->alloc*2);
-        } else if (self->used >= (self->alloc*3/4)) {
-            _lp_dict_lp_realloc(lp,self,self->alloc);
+        if (self->used >= self->alloc && !_lp_dict_lp_realloc(lp,self,self->len*2)) {
+            return;
         }
         _lp_dict_hash_set(lp,self,hash,k,v);
     } else {
@@ -136,33 +310,66 @@ lp_obj* _lp_dict_get(LP,_lp_dict *self,lp_obj* k, const char *error) {
 }
 
 void _lp_dict_del(LP,_lp_dict *self,lp_obj* k, const char *error) {
-    int n = _lp_dict_find(lp,self,k);
-    if (n < 0) {
+    int i = _lp_dict_slot(lp,self,lp_hash(lp,k),k), n;
+    if (i < 0) {
         lp_raise(,lp_add(lp,lp_string(lp, "(_lp_dict_del) KeyError: "),lp_str(lp,k)));
     }
+    n = DICT_INDEX(self)[i] - 1;
+    DICT_INDEX(self)[i] = -1;
+    LP_DICT_CHANGED(lp,self);
+    self->shape = 0;
+    if (n < self->asize) { self->asize = n; }
     self->items[n].used = -1;
-	if (!self->items[n].used)
-	{
-		LP_OBJ_DEC(self->items[n].key);
-		LP_OBJ_DEC(self->items[n].val);
-	}
     self->len -= 1;
+	LP_OBJ_DEC(self->items[n].key);
+	LP_OBJ_DEC(self->items[n].val);
+}
+
+/* drops every entry, the storage is kept for new ones */
+void _lp_dict_clear(LP,_lp_dict *self) {
+    int i, used = self->used;
+    LP_DICT_CHANGED(lp,self);
+    self->shape = 0;
+    self->asize = 0;
+    self->len = 0;
+    self->used = 0;
+    if (!self->alloc) { return; }
+    memset(DICT_INDEX(self), 0, (self->mask+1)*sizeof(int));
+    for (i=0; i<used; i++) {
+        lp_item *item = &self->items[i];
+        if (item->used <= 0) { continue; }
+        item->used = -1;
+        LP_OBJ_DEC(item->key);
+        LP_OBJ_DEC(item->val);
+    }
 }
 
 lp_obj* lp_dict_copy(LP,lp_obj* rr) {
-    lp_obj* obj = lp_obj_new(lp, LP_DICT);
     _lp_dict *o = rr->dict.val;
-    _lp_dict *r = lp_dict_new(lp);
+    int slots = _lp_dict_slots(o->alloc,o->mask);
+    void *item_pool = 0;
+    int item_index = 0;
+    lp_item *items = o->alloc ? lp_item_malloc(lp, slots, &item_pool, &item_index) : 0;
+    lp_obj* obj;
+    _lp_dict *r;
+    if (o->alloc && !items) { return 0; }
+    obj = lp_obj_new(lp, LP_DICT);
+    r = lp_dict_new(lp);
 	r->alloc = o->alloc;
-	r->cur = o->cur;
 	r->len = o->len;
+	r->used = o->used;
 	r->mask = o->mask;
 	r->meta = o->meta;
+	r->shape = o->shape;
+	r->asize = o->asize;
 	LP_OBJ_INC(o->meta);
-    r->items = lp_item_malloc(lp, o->alloc, &r->item_pool, &r->item_index);
-    memcpy(r->items,o->items,sizeof(lp_item)*o->alloc);
-	for (int i = 0; i < o->len; i++)
+    r->items = items;
+    r->item_pool = item_pool;
+    r->item_index = item_index;
+    if (o->alloc) { memcpy(r->items,o->items,sizeof(lp_item)*slots); }
+	for (int i = 0; i < o->used; i++)
 	{
+		if (r->items[i].used <= 0) continue;
 		LP_OBJ_INC(r->items[i].key);
 		LP_OBJ_INC(r->items[i].val);
 	}
@@ -171,29 +378,127 @@ lp_obj* lp_dict_copy(LP,lp_obj* rr) {
     return obj;
 }
 
-int _lp_dict_next(LP,_lp_dict *self) {
-    if (!self->len) {
-        lp_raise(0,lp_string(lp, "(_lp_dict_next) RuntimeError"));
+/* the number of index slots that looking up each key visits, all together.
+ * That is len(d) when no key collides with another; the tests check it */
+int _lp_dict_probes(_lp_dict *self) {
+    int i, j, n = 0;
+    for (i=0; i<self->used; i++) {
+        if (self->items[i].used <= 0) { continue; }
+        j = self->items[i].hash&self->mask;
+        for (n++; DICT_INDEX(self)[j] != i+1; n++) { j = (j+1)&self->mask; }
     }
-    while (1) {
-        self->cur = ((self->cur + 1) & self->mask);
-        if (self->items[self->cur].used > 0) {
-            return self->cur;
+    return n;
+}
+
+/* the first entry from i on, in insertion order, or -1. Iterating keeps i
+ * itself, so any number of loops can walk a dict at once */
+int _lp_dict_next(_lp_dict *self, int i) {
+    for (; i < self->used; i++) {
+        if (self->items[i].used > 0) { return i; }
+    }
+    return -1;
+}
+
+/* the k-th entry, which takes a walk when entries were deleted */
+int _lp_dict_nth(_lp_dict *self, int k) {
+    int i = -1;
+    if (self->used == self->len) { return k < self->len ? k : -1; }
+    do { i = _lp_dict_next(self,i+1); } while (i >= 0 && k--);
+    return i;
+}
+
+/* sets the entries of src in self, the hashes are taken from src */
+void _lp_dict_merge(LP,_lp_dict *self,_lp_dict *src) {
+    int i;
+    if (self->used + src->len > self->alloc && !_lp_dict_lp_realloc(lp,self,self->len+src->len)) {
+        return;
+    }
+    LP_DICT_CHANGED(lp,self);
+    for (i=0; i<src->used; i++) {
+        lp_item *t = &src->items[i];
+        int n;
+        if (t->used <= 0) { continue; }
+        n = _lp_dict_hash_find(lp,self,t->hash,t->key);
+        if (n < 0) {
+            if (self->used >= self->alloc && !_lp_dict_lp_realloc(lp,self,self->len*2)) { return; }
+            _lp_dict_hash_set(lp,self,t->hash,t->key,t->val);
+        } else {
+            lp_obj *v = self->items[n].val;
+            self->items[n].val = t->val;
+            LP_OBJ_INC(t->val);
+            LP_OBJ_DEC(v);
         }
     }
 }
 
+/* Function: merge
+ * Sets all the entries of the second dict in the first one. */
 lp_obj* lpf_merge(LP) {
-    lp_obj* self = LP_OBJ(0);
-    lp_obj* v = LP_OBJ(1);
-    int i; for (i=0; i<v->dict.val->len; i++) {
-        int n = _lp_dict_next(lp,v->dict.val);
-        _lp_dict_set(lp,self->dict.val,
-            v->dict.val->items[n].key,v->dict.val->items[n].val);
-    }
+    lp_obj* self = LP_TYPE(0,LP_DICT);
+    lp_obj* v = LP_TYPE(1,LP_DICT);
+    if (!self || !v) { return 0; }
+    _lp_dict_merge(lp,self->dict.val,v->dict.val);
     RETURN_LP_OBJ(lp->lp_None);
 }
 
+/* Views: keys(d), values(d) and items(d) are data objects holding d that a
+ * for loop walks in place, see LP_IITER_DICT. items gives [key, value]
+ * lists. */
+static void _lp_dict_view_free(LP, lp_obj self) {
+    LP_OBJ_DEC((lp_obj*)self.data.val);
+}
+
+/* the LP_VIEW_ kind of v, or 0 if it is not a view */
+int _lp_dict_view(lp_obj* v) {
+    if (lp_typeof(v) != LP_DATA || v->data.free_fun != _lp_dict_view_free) { return 0; }
+    return v->data.magic;
+}
+
+static lp_obj* _lp_dict_view_new(LP, int kind, lp_obj* d) {
+    lp_obj* r;
+    if (!d) { return 0; }
+    r = lp_data(lp, kind, d);
+    LP_OBJ_INC(d);
+    r->data.free_fun = _lp_dict_view_free;
+    return r;
+}
+
+/* the item of entry t for a view of kind, a new reference. An items list
+ * that only *reuse holds is filled again instead of making a new one */
+lp_obj* _lp_dict_view_item(LP, int kind, lp_item *t, lp_obj* reuse) {
+    lp_obj *pair[2];
+    if (kind == LP_VIEW_KEYS) { RETURN_LP_OBJ(t->key); }
+    if (kind == LP_VIEW_VALUES) { RETURN_LP_OBJ(t->val); }
+    if (reuse && lp_typeof(reuse) == LP_LIST && reuse->ref == 1 && reuse->list->len == 2) {
+        lp_obj *k = reuse->list->items[0], *v = reuse->list->items[1];
+        reuse->list->items[0] = t->key; LP_OBJ_INC(t->key);
+        reuse->list->items[1] = t->val; LP_OBJ_INC(t->val);
+        LP_OBJ_DEC(k);
+        LP_OBJ_DEC(v);
+        RETURN_LP_OBJ(reuse);
+    }
+    pair[0] = t->key; pair[1] = t->val;
+    return lp_list_n(lp, 2, pair);
+}
+
+/* Function: keys
+ * A view of the keys of a dict, in the order they were inserted. */
+lp_obj* lpf_keys(LP, LP_ARGS) {
+    return _lp_dict_view_new(lp, LP_VIEW_KEYS, LP_ARG_TYPE(0,LP_DICT));
+}
+
+/* Function: values
+ * A view of the values of a dict. */
+lp_obj* lpf_values(LP, LP_ARGS) {
+    return _lp_dict_view_new(lp, LP_VIEW_VALUES, LP_ARG_TYPE(0,LP_DICT));
+}
+
+/* Function: items
+ * A view of the entries of a dict as [key, value] lists. */
+lp_obj* lpf_items(LP, LP_ARGS) {
+    return _lp_dict_view_new(lp, LP_VIEW_ITEMS, LP_ARG_TYPE(0,LP_DICT));
+}
+
 /* Function: lp_dict
  *
  * Creates a new dictionary object.
@@ -211,6 +516,7 @@ lp_obj* lp_dict(LP) {
 	r->dict.val->len = 0;
 	r->dict.val->alloc = 0;
 	r->dict.val->mask = 0;
+	r->dict.val->used = 0;
 	r->dict.val->meta = 0;
     r->dict.dtype = 1;
     return r;
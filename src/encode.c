@@ -5,6 +5,10 @@
 #include "tokenize.h"
 #include <stdlib.h>
 
+#ifndef max
+#define max(a,b) ((a)>(b)?(a):(b))
+#endif
+
 typedef unsigned char REG_TYPE;
 const REG_TYPE INVALID_REG = 255;
 
@@ -113,20 +117,19 @@ void get_code_16(struct Item* item, char i, char a, short b)
 
 void selpos(struct CompileState *c, int row)
 {
-	int len;
-	const char* text;
+	struct Item* item;
 	if (row == c->D.scope->lineno) return;
-	text = c->D.lines[row-1];
 	c->D.scope->lineno = row;
-	len = strlen(text) + 4 - strlen(text)%4;
-	code_16(c, OP_POS, len/4, row);
-	write(c, text, len);
+	item = new_code_item(c, I_POS);
+	item->i = row;
+	insert(c, item);
 }
 
 void alloc(struct CompileState *c, int t, REG_TYPE* st, REG_TYPE* end)
 {
 	int m = c->D.scope->mreg + t;
 	if (m > 256) m = 256;
+	*st = *end = c->D.scope->mreg;
 	for(int i = 0; i < m; i++)
 	{
 		if (!c->D.scope->r2n[i])
@@ -226,12 +229,30 @@ void free_tmps(struct CompileState *c, REG_TYPE st, REG_TYPE end)
 	for (REG_TYPE k = st; k < end; k ++) free_tmp(c, k);
 }
 
+int const_index(struct CompileState *c, char kind, const char* v)
+{
+	struct StrListItem* p = c->D.consts.head;
+	int n = 0, len = strlen(v);
+	char* k;
+	while (p)
+	{
+		if (p->s[0] == kind && !strcmp(p->s + 1, v))
+			return n;
+		p = p->next;
+		n ++;
+	}
+	if (n > 0xffff) u_error(c, "too many constants", c->D.code, 0, 0);
+	k = new_string(c, len + 2);
+	k[0] = kind;
+	memcpy(k + 1, v, len + 1);
+	append_strList_item(c, &c->D.consts, k);
+	return n;
+}
+
 REG_TYPE _do_string(struct CompileState *c, const char* v, int r)
 {
 	r = get_tmp(c, r);
-	int len = strlen(v) + (4-strlen(v)%4);
-	code_16(c, OP_STRING, r, strlen(v));
-	write(c, v, len);
+	code_16(c, OP_CONST, r, const_index(c, CONST_STRING, v));
 	return r;
 }
 
@@ -246,23 +267,7 @@ REG_TYPE do_string(struct CompileState *c, struct Token* t, REG_TYPE r)
 REG_TYPE _do_number(struct CompileState *c, char* v, int r)
 {
 	r = get_tmp(c, r);
-	if (strstr(v, "."))
-	{
-		double f = atof(v);
-		char *t = (char *)malloc(sizeof(double));
-		code(c, OP_NUMBER, r, 1, 0);
-		memcpy(t, &f, sizeof(double));
-		write(c, t, sizeof(double));
-		free(t);
-	}
-	else {
-		int i = atoi(v);
-		char *t = (char *)malloc(sizeof(int));
-		code(c, OP_NUMBER, r, 0, 0);
-		memcpy(t, &i, sizeof(int));
-		write(c, t, sizeof(int));
-		free(t);
-	}
+	code_16(c, OP_CONST, r, const_index(c, strstr(v, ".") ? CONST_DOUBLE : CONST_INT, v));
 	return r;
 }
 
@@ -359,6 +364,11 @@ void merge_tags(struct CompileState *c)
 	c->D.out.tail = 0;
 	while(p)
 	{
+		if (p->isdata == I_POS)
+		{
+			p = p->next;
+			continue;
+		}
 		if (p->isdata == I_TAG)
 		{
 			tmp = p;
@@ -533,6 +543,29 @@ static int _get_metas(int sym)
 
 REG_TYPE do_set_ctx(struct CompileState *cst, struct Token* k, struct Token* v);
 
+/* picks the compare opcode for a comparison symbol, > and >= are turned
+ * into < and <= with the operands swapped */
+static int cmp_operands(struct Token* t, struct Token** b, struct Token** c)
+{
+	struct TListItem* items = t->items.head;
+	int v = t->vs;
+	*b = items->t;
+	*c = items->next->t;
+	if (v == S_BIG || v == S_BIGEQUAL)
+	{
+		*b = items->next->t;
+		*c = items->t;
+
+		if (v == S_BIG) v = S_LOW;
+		else v = S_LOWEQUAL;
+	}
+
+	if (v == S_LOW) return OP_LT;
+	if (v == S_LOWEQUAL) return OP_LE;
+	if (v == S_NOTEQUAL) return OP_NE;
+	return OP_EQ;
+}
+
 REG_TYPE do_symbol(struct CompileState *cst, struct Token* t, REG_TYPE r)
 {
 	struct TListItem* items = t->items.head;
@@ -567,21 +600,8 @@ REG_TYPE do_symbol(struct CompileState *cst, struct Token* t, REG_TYPE r)
 		return do_set_ctx(cst, items->t, items->next->t);
 	else if (in_sets(g_cmps, sizeof(g_cmps) / sizeof(int), t->vs))
 	{
-		struct Token* b = items->t, *c = items->next->t;
-		int cd = OP_EQ;
-		int v = t->vs;
-		if (v == S_BIG || v == S_BIGEQUAL)
-		{
-			b = items->next->t;
-			c = items->t;
-
-			if (v == S_BIG) v = S_LOW;
-			else v = S_LOWEQUAL;
-		}
-
-		if (v == S_LOW) cd = OP_LT;
-		if (v == S_LOWEQUAL) cd = OP_LE;
-		if (v == S_NOTEQUAL) cd = OP_NE;
+		struct Token* b, *c;
+		int cd = cmp_operands(t, &b, &c);
 		return infix(cst, cd, b, c, r);
 	}
 	else
@@ -672,7 +692,14 @@ REG_TYPE do_set_ctx(struct CompileState *cst, struct Token* k, struct Token* v)
 	r = do_expression(cst, k->items.head->t, INVALID_REG);
 	rr = do_expression(cst, v, INVALID_REG);
 	tmp = do_expression(cst, k->items.head->next->t, INVALID_REG);
-	code(cst, OP_SET, r, tmp, rr);
+	if (k->items.head->next->t->type == S_STRING)
+	{
+		struct ACache cache = { 0 };
+		code(cst, OP_SETATTR, r, tmp, rr);
+		write(cst, (const char*)&cache, sizeof(struct ACache));
+	}
+	else
+		code(cst, OP_SET, r, tmp, rr);
 	free_tmp(cst, r);
 	free_tmp(cst, tmp);
 	return rr;
@@ -825,6 +852,7 @@ REG_TYPE do_del(struct CompileState *cst, struct Token* tt)
 		code(cst, OP_DEL, r, r2, 0);
 		free_tmp(cst, r);
 		free_tmp(cst, r2);
+		kk = kk->next;
 	}
 
 	return INVALID_REG;
@@ -838,16 +866,59 @@ REG_TYPE do_del(struct CompileState *cst, struct Token* tt)
  *   |-- arg2
  *   ...
  */
+/*
+ * obj.name(args) with positional args only:
+ *
+ *   LOADMETHOD st, obj, "name"    st = method, st+1 = self or None
+ *   st+2 ... = args
+ *   CALLMETHOD r, st, nargs
+ *
+ * so a method is called without making a bound method first.
+ */
+REG_TYPE do_method_call(struct CompileState *cst, struct Token* f, struct TList* a, REG_TYPE r)
+{
+	REG_TYPE st, end, n, o, k;
+	struct TListItem* tt;
+	struct ACache cache = { 0 };
+	int l = get_list_len(a);
+
+	r = get_tmp(cst, r);
+	get_tmps(cst, l + 2, &st, &end);
+	o = do_expression(cst, f->items.head->t, INVALID_REG);
+	k = do_expression(cst, f->items.head->next->t, INVALID_REG);
+	code(cst, OP_LOADMETHOD, st, o, k);
+	write(cst, (const char*)&cache, sizeof(struct ACache));
+	free_tmp(cst, o);
+	free_tmp(cst, k);
+	n = st + 2;
+	for (tt = a->head; tt; tt = tt->next, n ++)
+	{
+		REG_TYPE b = do_expression(cst, tt->t, n);
+		if (b != n)
+		{
+			code(cst, OP_MOVE, n, b, 0);
+			free_tmp(cst, b);
+		}
+	}
+	code(cst, OP_CALLMETHOD, r, st, l);
+	free_tmps(cst, st, end);
+	return r;
+}
+
 REG_TYPE do_call(struct CompileState *cst, struct Token* t, REG_TYPE r)
 {
-	REG_TYPE fnc = do_expression(cst, t->items.head->t, INVALID_REG);
+	struct Token *f = t->items.head->t;
 	struct TList a = { 0 }, b = { 0 };
 	struct TListItem * item;
 	struct Token *c, *d, *nt, *nt2, *nt3;
-	REG_TYPE e, t1, t2;
+	REG_TYPE fnc, e, t1, t2;
 	
-	r = get_tmp(cst, r);
 	p_filter(cst, t->items.head->next, &a, &b, &c, &d);
+	if (f->type == S_GET && get_list_len(&f->items) == 2 && f->items.head->next->t->type == S_STRING
+		&& b.num == 0 && !c && !d)
+		return do_method_call(cst, f, &a, r);
+	fnc = do_expression(cst, f, INVALID_REG);
+	r = get_tmp(cst, r);
 	e = INVALID_REG;
 	if (b.num != 0 || d != 0)
 	{
@@ -899,15 +970,14 @@ REG_TYPE do_call(struct CompileState *cst, struct Token* t, REG_TYPE r)
 
 REG_TYPE do_name(struct CompileState *cst, struct Token* t, REG_TYPE r)
 {
-	REG_TYPE c;
+	struct GCache cache = { 0 };
 	if (find_str_item(&cst->D.scope->vars, t->vn))
 		return do_local(cst, t, r);
 	if (!find_str_item(&cst->D.scope->rglobals, t->vn))
 		append_strList_item(cst, &cst->D.scope->rglobals, t->vn);
 	r = get_tmp(cst, r);
-	c = do_string(cst, t, INVALID_REG);
-	code(cst, OP_GGET, r, c, 0);
-	free_tmp(cst, c);
+	code_16(cst, OP_GGET, r, const_index(cst, CONST_STRING, t->vn));
+	write(cst, (const char*)&cache, sizeof(struct GCache));
 	return r;
 }
 
@@ -1077,6 +1147,45 @@ REG_TYPE do_class(struct CompileState *cst, struct Token* t)
 	return INVALID_REG;
 }
 
+/*
+ * Emits a test of cond that falls through when it is true and jumps to the
+ * tag (t, s) when it is false. Comparisons become a fused OP_IFxx, which
+ * compares without creating a result object and uses the OP_JUMP after it
+ * as its branch target; the operands of an and are tested one by one.
+ */
+void do_cond(struct CompileState *cst, struct Token* cond, int t, int s)
+{
+	if (cond->type == S_SYMBOL && cond->vs == S_AND)
+	{
+		do_cond(cst, cond->items.head->t, t, s);
+		do_cond(cst, cond->items.head->next->t, t, s);
+		return;
+	}
+	selpos(cst, cond->row);
+	if (cond->type == S_SYMBOL && in_sets(g_cmps, sizeof(g_cmps) / sizeof(int), cond->vs))
+	{
+		struct Token* tb, *tc;
+		REG_TYPE b, c;
+		int cd = cmp_operands(cond, &tb, &tc);
+		b = do_expression(cst, tb, INVALID_REG);
+		c = do_expression(cst, tc, INVALID_REG);
+		if (cd == OP_LT) cd = OP_IFLT;
+		else if (cd == OP_LE) cd = OP_IFLE;
+		else if (cd == OP_NE) cd = OP_IFNE;
+		else cd = OP_IFEQ;
+		code(cst, cd, 0, b, c);
+		free_tmp(cst, b);
+		free_tmp(cst, c);
+	}
+	else
+	{
+		REG_TYPE r = do_expression(cst, cond, INVALID_REG);
+		code(cst, OP_IF, r, 0, 0);
+		free_tmp(cst, r);
+	}
+	jump(cst, t, s);
+}
+
 /*
  *    while
  *      |-- cond
@@ -1084,14 +1193,10 @@ REG_TYPE do_class(struct CompileState *cst, struct Token* t)
  */
 REG_TYPE do_while(struct CompileState *cst, struct Token* tok)
 {
-	REG_TYPE r;
     int t = stack_tag(cst);
     tag(cst, t, S_BEGIN);
     tag(cst, t, S_CONTINUE);
-    r = do_expression(cst, tok->items.head->t, INVALID_REG);
-    code(cst, OP_IF, r, 0, 0);
-    free_tmp(cst, r);
-    jump(cst, t, S_END);
+    do_cond(cst, tok->items.head->t, t, S_END);
     free_tmp(cst, do_expression(cst, tok->items.head->next->t, INVALID_REG));
     jump(cst, t, S_BEGIN);
     tag(cst, t, S_BREAK);
@@ -1177,10 +1282,7 @@ REG_TYPE do_if(struct CompileState *cst, struct Token* tt)
         tag(cst, t, MAX_SYMS + n);
         if (tt->type == S_ELIF)
         {
-            REG_TYPE a = do_expression(cst, tt->items.head->t, INVALID_REG);
-            code(cst, OP_IF, a, 0, 0);
-            free_tmp(cst, a);
-            jump(cst, t, MAX_SYMS + n + 1);
+            do_cond(cst, tt->items.head->t, t, MAX_SYMS + n + 1);
             free_tmp(cst, do_expression(cst, tt->items.head->next->t, INVALID_REG));
         }
         else if (tt->type == S_ELSE)
@@ -1263,7 +1365,12 @@ REG_TYPE do_dict(struct CompileState *cst, struct Token* t, REG_TYPE r)
 
 REG_TYPE do_get(struct CompileState *cst, struct Token* t, REG_TYPE r)
 {
-    return infix(cst, OP_GET, t->items.head->t, t->items.head->next->t, r);
+	struct ACache cache = { 0 };
+	if (t->items.head->next->t->type != S_STRING)
+		return infix(cst, OP_GET, t->items.head->t, t->items.head->next->t, r);
+	r = infix(cst, OP_GETATTR, t->items.head->t, t->items.head->next->t, r);
+	write(cst, (const char*)&cache, sizeof(struct ACache));
+	return r;
 }
 
 REG_TYPE do_break(struct CompileState *cst, struct Token* t)
@@ -1413,32 +1520,96 @@ REG_TYPE do_expression(struct CompileState *cst, struct Token* t, REG_TYPE r)
 		u_error(cst, "encode", cst->D.code, t->col, t->row);
 }
 
-void split(struct CompileState *cst, char* s)
+/* Encodes the pc -> line table: a (pc delta, line delta) byte pair for every
+ * line change, pc counted in words from the start of the module body.
+ * Returns the size in bytes, out may be 0 to only measure.
+ */
+int lnotab(struct CompileState *c, char* out)
 {
-	const char* h = s;
-	int i = 0, n = 0;
-	while (s[i])
+	struct IntListItem* p = c->D.pclines.head;
+	int n = 0, pc = 0, line = 0;
+	while (p && p->next)
 	{
-		if (s[i] == '\n') n++;
-		i ++;
+		int dpc = p->v - pc, dline = p->next->v - line;
+		pc = p->v;
+		line = p->next->v;
+		while (dpc > 255)
+		{
+			if (out) { out[n] = (char)255; out[n+1] = 0; }
+			n += 2;
+			dpc -= 255;
+		}
+		while (dline > 127 || dline < -128)
+		{
+			int d = dline > 0 ? 127 : -128;
+			if (out) { out[n] = (char)dpc; out[n+1] = (char)d; }
+			n += 2;
+			dpc = 0;
+			dline -= d;
+		}
+		if (out) { out[n] = (char)dpc; out[n+1] = (char)dline; }
+		n += 2;
+		p = p->next->next;
 	}
-	n++;
-	cst->D.lines = (const char**)malloc(n * sizeof(const char*));
-	cst->D.linenum = n;
-	i = 0;
-	n = 0;
-	while (s[i])
+	return n;
+}
+
+/* Puts the constant section in front of the module code: OP_CONSTS with the
+ * number of entries, then for every entry a word (kind, 0, byte length) and
+ * its data padded to 4 bytes. Nested functions share this table. The last
+ * entry is the line table, the module body starts right after it.
+ */
+void do_consts(struct CompileState *c)
+{
+	struct ItemList body = c->D.out;
+	struct StrListItem* p;
+	struct Item* item;
+	int n = 0, len;
+	char* tab;
+
+	for (item = body.head; item; item = item->next)
 	{
-		if (s[i] == '\n')
+		if (item->isdata == I_POS)
+		{
+			append_intList_item(c, &c->D.pclines, n);
+			append_intList_item(c, &c->D.pclines, item->i);
+		}
+		else if (item->isdata != I_TAG)
+			n ++;
+	}
+
+	memset(&c->D.out, 0, sizeof(struct ItemList));
+	code_16(c, OP_CONSTS, 0, c->D.consts.num + 1);
+	for (p = c->D.consts.head; p; p = p->next)
+	{
+		const char* v = p->s + 1;
+		if (p->s[0] == CONST_INT)
+		{
+			int i = atoi(v);
+			code_16(c, CONST_INT, 0, sizeof(int));
+			write(c, (const char*)&i, sizeof(int));
+		}
+		else if (p->s[0] == CONST_DOUBLE)
+		{
+			double f = atof(v);
+			code_16(c, CONST_DOUBLE, 0, sizeof(double));
+			write(c, (const char*)&f, sizeof(double));
+		}
+		else
 		{
-			cst->D.lines[n] = h;
-			s[i] = '\0';
-			h = &s[i + 1];
-			n++;
+			len = strlen(v) + 1;
+			code_16(c, CONST_STRING, 0, len);
+			write(c, v, len);
 		}
-		i++;
 	}
-	cst->D.lines[n] = h;
+	len = lnotab(c, 0);
+	tab = new_string(c, len + 1);
+	lnotab(c, tab);
+	code_16(c, CONST_LINES, 0, len);
+	write(c, tab, len);
+	c->D.out.tail->next = body.head;
+	c->D.out.tail = body.tail;
+	c->D.out.num += body.num;
 }
 
 const char* encode(struct CompileState *cst, const char* fname, char* s, struct Token* t)
@@ -1448,10 +1619,10 @@ const char* encode(struct CompileState *cst, const char* fname, char* s, struct
 	memset(&cst->D, 0, sizeof(struct DState));
     cst->D.fname = fname;
 	cst->D.code = s;
-	split(cst, s);
     begin(cst, true);
     do_expression(cst, nt, INVALID_REG);
     end(cst);
+    do_consts(cst);
     merge_tags(cst);
     return cst->D.so;
 }
@@ -1,9 +1,318 @@
 #include "lp.h"
 #include "lp_internal.h"
 
-void lp_collect(LP) {
-    /**/
+/* Cycle collector.
+ *
+ * Reference counting frees everything but cycles, so now and then the
+ * containers (lists, dicts, functions and dict views) are searched for
+ * groups that are only referenced from each other. The search is a trial
+ * deletion: every container starts with its reference count and each
+ * reference held by another container is subtracted from it. What remains
+ * are the references from outside any container (C code, the frames of the
+ * VM, lp_vm fields), and the containers that have some are the roots.
+ * Whatever the roots reach is alive, the rest is garbage. Garbage is
+ * cleared, which breaks the cycles and lets reference counting free it.
+ *
+ * Nothing is tracked per object, the object pools are walked and the counts
+ * are kept in a scratch array; gc_base of a pool is the index of its first
+ * slot in that array.
+ *
+ * Collections run at safepoints of the VM, through LP_GC_CHECK, after
+ * gc_limit containers have been allocated. The limit is the larger of
+ * gc_threshold and the number of containers that survived the previous
+ * collection, so a big heap is not walked more often than it grows. A
+ * gc_threshold of 0 leaves collecting to lp_collect. Under a memory limit a
+ * collection is also due when the memory in use passes lp->mem_gc, see
+ * lp_mem_limit.
+ *
+ * A collection is not incremental. It stops the VM and walks every object
+ * pool three times, live objects and free slots alike, plus a mark pass
+ * over the roots. So the pause grows with the size of the heap, not with
+ * the amount of garbage. Because gc_limit follows the surviving
+ * containers, the cost per allocated container stays flat, but a single
+ * pause on a large heap can be long. Trial deletion needs the counts of
+ * one consistent moment, so the walk cannot be spread over safepoints
+ * while the VM keeps changing them.
+ */
+
+#define GC_CONTAINER(v) ((v) && lp_is_ptr(v) && \
+	((v)->type == LP_LIST || (v)->type == LP_DICT || (v)->type == LP_FNC || \
+	((v)->type == LP_DATA && _lp_dict_view(v))))
+
+typedef struct gc_state {
+	lp_vm *vm;
+	int *refs;
+	lp_obj **stack;
+	int len;
+	int alloc;
+	/* set when the stack could not grow, an object was left out */
+	int full;
+} gc_state;
+
+/* 0 for the objects kept out of an arena, those are not walked */
+static int *gc_ref(gc_state *s, lp_obj* v) {
+	struct LpObjPool *p = (struct LpObjPool *)lp_pool_of(v);
+	if (p->gc_base < 0) return 0;
+	return &s->refs[p->gc_base + (int)(v - p->obj)];
+}
+
+static void gc_push(gc_state *s, lp_obj* v) {
+	if (s->len == s->alloc) {
+		int n = s->alloc ? s->alloc * 2 : 256;
+		lp_obj **r = (lp_obj**)lp_realloc(s->vm, s->stack, s->alloc * sizeof(lp_obj*), n * sizeof(lp_obj*));
+		if (!r) {
+			s->full = 1;
+			return;
+		}
+		s->stack = r;
+		s->alloc = n;
+	}
+	s->stack[s->len++] = v;
+}
+
+/* calls fn for each container v holds a reference to */
+static void gc_children(gc_state *s, lp_obj* v, void fn(gc_state*, lp_obj*)) {
+	int i;
+	switch (v->type) {
+	case LP_LIST:
+		for (i = 0; i < v->list->len; i++) {
+			if (GC_CONTAINER(v->list->items[i])) fn(s, v->list->items[i]);
+		}
+		break;
+	case LP_DICT: {
+		_lp_dict *d = v->dict.val;
+		for (i = 0; i < d->used; i++) {
+			if (d->items[i].used <= 0) continue;
+			if (GC_CONTAINER(d->items[i].key)) fn(s, d->items[i].key);
+			if (GC_CONTAINER(d->items[i].val)) fn(s, d->items[i].val);
+		}
+		if (GC_CONTAINER(d->meta)) fn(s, d->meta);
+		break;
+	}
+	case LP_FNC: {
+		_lp_fnc *f = v->fnc.info;
+		if (GC_CONTAINER(f->code)) fn(s, f->code);
+		if (GC_CONTAINER(f->self)) fn(s, f->self);
+		if (GC_CONTAINER(f->globals)) fn(s, f->globals);
+		if (GC_CONTAINER(f->consts)) fn(s, f->consts);
+		break;
+	}
+	case LP_DATA:
+		fn(s, (lp_obj*)v->data.val);
+		break;
+	}
 }
 
-/**/
+static void gc_unref(gc_state *s, lp_obj* v) {
+	int *r = gc_ref(s, v);
+	if (r) (*r)--;
+}
+
+static void gc_reach(gc_state *s, lp_obj* v) {
+	int *r = gc_ref(s, v);
+	if (!r || *r) return;
+	*r = 1;
+	gc_push(s, v);
+}
+
+/* drops every reference v holds, v itself stays allocated */
+static void gc_clear(LP, lp_obj* v) {
+	int i;
+	switch (v->type) {
+	case LP_LIST: {
+		_lp_list *l = v->list;
+		int len = l->len;
+		l->len = 0;
+		for (i = 0; i < len; i++) {
+			LP_OBJ_DEC(l->items[i]);
+		}
+		break;
+	}
+	case LP_DICT: {
+		_lp_dict *d = v->dict.val;
+		lp_obj* meta = d->meta;
+		d->meta = 0;
+		_lp_dict_clear(lp, d);
+		LP_OBJ_DEC(meta);
+		break;
+	}
+	case LP_FNC: {
+		_lp_fnc *f = v->fnc.info;
+		lp_obj *c = f->code, *self = f->self, *g = f->globals, *k = f->consts;
+		f->code = f->self = f->globals = f->consts = 0;
+		LP_OBJ_DEC(c);
+		LP_OBJ_DEC(self);
+		LP_OBJ_DEC(g);
+		LP_OBJ_DEC(k);
+		break;
+	}
+	case LP_DATA: {
+		lp_obj *d = (lp_obj*)v->data.val;
+		v->data.val = lp->lp_None;
+		LP_OBJ_DEC(d);
+		break;
+	}
+	}
+}
+
+/* Function: lp_collect
+ * Frees the lists, dicts and functions that are only kept alive by
+ * reference cycles.
+ *
+ * Collections also happen on their own, see lp_vm.gc_threshold.
+ *
+ * The collector needs tables that grow with the heap. If the memory for
+ * them is refused, see <lp_malloc>, MemoryError is raised and what it
+ * could not trace is left for a later collection.
+ *
+ * Returns:
+ * The number of containers freed.
+ */
+int lp_collect(LP) {
+	gc_state s = { 0 };
+	struct LpObjPool *p;
+	int i, n = 0, live = 0, freed;
+
+	s.vm = lp;
+	while (lp_free_pending(lp, LP_FREE_SLICE));
+	for (p = lp->obj_pool; p; p = p->next) {
+		p->gc_base = n;
+		n += OBJ_SIZE;
+	}
+	s.refs = (int*)lp_malloc(lp, n * sizeof(int));
+	if (!s.refs) {
+		lp->gc_count = 0;
+		return 0;
+	}
 
+	for (p = lp->obj_pool; p; p = p->next) {
+		for (i = 0; i < OBJ_SIZE; i++) {
+			lp_obj* v = &p->obj[i];
+			if (v->ref > 0 && GC_CONTAINER(v)) s.refs[p->gc_base + i] = v->ref;
+		}
+	}
+	for (p = lp->obj_pool; p; p = p->next) {
+		for (i = 0; i < OBJ_SIZE; i++) {
+			lp_obj* v = &p->obj[i];
+			if (v->ref > 0 && GC_CONTAINER(v)) gc_children(&s, v, gc_unref);
+		}
+	}
+
+	/* the roots, and then everything they reach, become 1 */
+	for (p = lp->obj_pool; p; p = p->next) {
+		for (i = 0; i < OBJ_SIZE; i++) {
+			lp_obj* v = &p->obj[i];
+			if (v->ref > 0 && GC_CONTAINER(v) && s.refs[p->gc_base + i]) {
+				s.refs[p->gc_base + i] = 1;
+				gc_push(&s, v);
+			}
+		}
+	}
+	while (s.len) {
+		gc_children(&s, s.stack[--s.len], gc_reach);
+	}
+	/* what was left out may reach objects that now look like garbage */
+	if (s.full) {
+		lp_free(lp, s.refs, n * sizeof(int));
+		lp_free(lp, s.stack, s.alloc * sizeof(lp_obj*));
+		lp->gc_count = 0;
+		return 0;
+	}
+
+	for (p = lp->obj_pool; p; p = p->next) {
+		for (i = 0; i < OBJ_SIZE; i++) {
+			lp_obj* v = &p->obj[i];
+			if (!(v->ref > 0 && GC_CONTAINER(v))) continue;
+			if (s.refs[p->gc_base + i]) {
+				live++;
+			} else {
+				gc_push(&s, v);
+			}
+		}
+	}
+	lp_free(lp, s.refs, n * sizeof(int));
+
+	/* hold the garbage while it is cleared, so that none of it is freed
+	 * before all of it has let go of the rest */
+	freed = s.len;
+	for (i = 0; i < s.len; i++) {
+		LP_OBJ_INC(s.stack[i]);
+	}
+	for (i = 0; i < s.len; i++) {
+		gc_clear(lp, s.stack[i]);
+	}
+	for (i = 0; i < s.len; i++) {
+		LP_OBJ_DEC(s.stack[i]);
+	}
+	lp_free(lp, s.stack, s.alloc * sizeof(lp_obj*));
+	while (lp_free_pending(lp, LP_FREE_SLICE));
+	lp_pool_trim(lp);
+
+	lp->gc_count = 0;
+	lp->gc_limit = lp->gc_threshold ? _lp_max(lp->gc_threshold, live) : LP_GCMAX;
+	/* under a memory limit the next collection is due halfway to it */
+	if (lp->mem_limit != LP_NO_LIMIT) {
+		unsigned long used = lp->mem_used < lp->mem_limit ? lp->mem_used : lp->mem_limit;
+		lp->mem_gc = used + (lp->mem_limit - used) / 2;
+	}
+	return freed;
+}
+
+/* the work LP_GC_CHECK asks for: a slice of the containers waiting to be
+ * freed, a collection when enough were allocated, unmapping spare pools
+ * and taking back the memory reserve once the allocator has room again */
+void lp_gc_step(LP) {
+	if (lp->dead_count) {
+		lp_free_pending(lp, LP_FREE_SLICE + lp->free_credit);
+		lp->free_credit = 0;
+	}
+	if (lp->gc_count >= lp->gc_limit) {
+		if (lp->gc_threshold || lp->mem_used > lp->mem_gc) {
+			lp_collect(lp);
+		} else {
+			lp->gc_count = 0;
+		}
+	}
+	if (lp->pools_empty > 2 * LP_POOL_SPARE) {
+		lp_pool_trim(lp);
+	}
+	if (!lp->mem_reserve) {
+		lp_mem_reserve(lp);
+	}
+}
+
+/* Function: gc.collect
+ * Runs the cycle collector, returns the number of containers freed. */
+lp_obj* lpf_gc_collect(LP, LP_ARGS) {
+	return lp_number_from_int(lp, lp_collect(lp));
+}
+
+/* Function: gc.threshold
+ * With an argument, sets how many containers are allocated before the
+ * collector runs on its own (0 turns that off). Returns the threshold it
+ * had before.
+ *
+ * Each collection pauses the script for a walk of the whole heap. A lower
+ * threshold makes pauses more frequent but not shorter. Code that cannot
+ * afford a pause at a random point can turn the threshold off and call
+ * gc.collect where a pause does no harm. Under a memory limit a collection
+ * still runs once memory gets short. */
+lp_obj* lpf_gc_threshold(LP, LP_ARGS) {
+	int r = lp->gc_threshold;
+	if (argc > 0) {
+		lp->gc_threshold = _lp_max(0, LP_ARG_INTEGER(0));
+		lp->gc_limit = lp->gc_threshold ? lp->gc_threshold : LP_GCMAX;
+	}
+	return lp_number_from_int(lp, r);
+}
+
+/* sets up the collector and the gc module */
+void lp_gc_init(LP) {
+	lp_obj* gc = lp_dict(lp);
+	lp->gc_threshold = LP_GCMAX;
+	lp->gc_limit = LP_GCMAX;
+	lp->gc_count = 0;
+	lp_setkv(lp, gc, lp_string(lp, "collect"), lp_vfnc(lp, lpf_gc_collect));
+	lp_setkv(lp, gc, lp_string(lp, "threshold"), lp_vfnc(lp, lpf_gc_threshold));
+	lp_setkv(lp, lp->modules, lp_string(lp, "gc"), gc);
+}
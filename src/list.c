@@ -1,26 +1,35 @@
 #include "lp.h"
 #include "lp_internal.h"
 
-void _lp_list_realloc(LP, _lp_list *self,int len) {
+/* moves the items to storage with room for len of them; returns 0 and
+ * leaves self as it is if there is no memory for it */
+int _lp_list_realloc(LP, _lp_list *self,int len) {
 	lp_obj **items = self->items;
 	void* item_pool = self->item_pool;
 	int item_index = self->item_index;
+    lp_obj **r;
     if (!len) { len=1; }
-    self->items = lp_obj_array_malloc(lp, len, &self->item_pool, &self->item_index);
+    r = lp_obj_array_malloc(lp, len, &self->item_pool, &self->item_index);
+    if (!r) { return 0; }
+    self->items = r;
 	if (items)
 	{
 		memcpy(self->items, items, self->len * sizeof(lp_obj *));
 		lp_obj_array_release(lp, self->alloc, item_pool, item_index);
 	}
     self->alloc = len;
+    return 1;
 }
 
 void _lp_list_set(LP,_lp_list *self,int k, lp_obj* v, const char *error) {
-    if (k >= self->len) {
+    lp_obj* old;
+    if (k < 0 || k >= self->len) {
         lp_raise(,lp_string(lp, "(_lp_list_set) KeyError"));
     }
-    self->items[k] = v;
+    old = self->items[k];
     LP_OBJ_INC(v);
+    self->items[k] = v;
+    LP_OBJ_DEC(old);
 }
 void _lp_list_free(LP, _lp_list *self) {
     lp_obj_array_release(lp, self->alloc, self->item_pool, self->item_index);
@@ -40,9 +49,11 @@ lp_obj* _lp_list_get(LP,_lp_list *self,int k,const char *error) {
     }
 	RETURN_LP_OBJ(self->items[k]);
 }
+/* takes the reference to v, and drops it if the list cannot grow */
 void _lp_list_insertx(LP,_lp_list *self, int n, lp_obj* v) {
-    if (self->len >= self->alloc) {
-        _lp_list_realloc(lp, self,self->alloc*2);
+    if (self->len >= self->alloc && !_lp_list_realloc(lp, self,self->alloc*2)) {
+        LP_OBJ_DEC(v);
+        return;
     }
     if (n < self->len) { memmove(&self->items[n+1],&self->items[n],sizeof(lp_obj *)*(self->len-n)); }
     self->items[n] = v;
@@ -52,8 +63,8 @@ void _lp_list_appendx(LP,_lp_list *self, lp_obj* v) {
     _lp_list_insertx(lp,self,self->len,v);
 }
 void _lp_list_insert(LP,_lp_list *self, int n, lp_obj* v) {
-    _lp_list_insertx(lp,self,n,v);
     LP_OBJ_INC(v);
+    _lp_list_insertx(lp,self,n,v);
 }
 void _lp_list_append(LP,_lp_list *self, lp_obj* v) {
     _lp_list_insert(lp,self,self->len,v);
@@ -76,9 +87,9 @@ int _lp_list_find(LP,_lp_list *self, lp_obj* v) {
     return -1;
 }
 
-lp_obj* lpf_index(LP) {
-    lp_obj* self = LP_OBJ(0);
-    lp_obj* v = LP_OBJ(1);
+lp_obj* lpf_index(LP, LP_ARGS) {
+    lp_obj* self = LP_ARG(0);
+    lp_obj* v = LP_ARG(1);
     int i = _lp_list_find(lp,self->list,v);
     if (i < 0) {
         lp_raise(0,lp_string(lp, "(lp_index) ValueError: list.index(x): x not in list"));
@@ -87,12 +98,20 @@ lp_obj* lpf_index(LP) {
 }
 
 lp_obj* lp_list_copy(LP, lp_obj* rr) {
-    lp_obj* val = lp_obj_new(lp, LP_LIST);
     _lp_list *o = rr->list;
-    _lp_list *r = lp_list_new(lp);
+    void* item_pool = 0;
+    int item_index = 0;
+    lp_obj **items = lp_obj_array_malloc(lp, o->alloc, &item_pool, &item_index);
+    lp_obj* val;
+    _lp_list *r;
+    if (o->alloc && !items) { return 0; }
+    val = lp_obj_new(lp, LP_LIST);
+    r = lp_list_new(lp);
 	r->alloc = o->alloc;
 	r->len = o->len;
-    r->items = lp_obj_array_malloc(lp, o->alloc, &r->item_pool, &r->item_index);
+    r->items = items;
+    r->item_pool = item_pool;
+    r->item_index = item_index;
     memcpy(r->items,o->items,sizeof(lp_obj *)*o->len);
 	for (int i = 0; i < o->len; i ++)
 	{
@@ -102,32 +121,33 @@ lp_obj* lp_list_copy(LP, lp_obj* rr) {
     return val;
 }
 
-lp_obj* lpf_append(LP) {
-    lp_obj* self = LP_OBJ(0);
-    lp_obj* v = LP_OBJ(1);
+lp_obj* lpf_append(LP, LP_ARGS) {
+    lp_obj* self = LP_ARG(0);
+    lp_obj* v = LP_ARG(1);
     _lp_list_append(lp,self->list,v);
     RETURN_LP_OBJ(lp->lp_None);
 }
 
-lp_obj* lpf_pop(LP) {
-    lp_obj* self = LP_OBJ(0);
+lp_obj* lpf_pop(LP, LP_ARGS) {
+    lp_obj* self = LP_ARG(0);
     return _lp_list_pop(lp,self->list,self->list->len-1,"pop");
 }
 
-lp_obj* lpf_insert(LP) {
-    lp_obj* self = LP_OBJ(0);
-	int n = LP_INTEGER(1);
-    lp_obj* v = LP_OBJ(2);
+lp_obj* lpf_insert(LP, LP_ARGS) {
+    lp_obj* self = LP_ARG(0);
+	int n = LP_ARG_INTEGER(1);
+    lp_obj* v = LP_ARG(2);
     _lp_list_insert(lp,self->list,n,v);
 	RETURN_LP_OBJ(lp->lp_None);
 }
 
-lp_obj* lpf_extend(LP) {
-    lp_obj* self = LP_OBJ(0);
-    lp_obj* v = LP_OBJ(1);
+lp_obj* lpf_extend(LP, LP_ARGS) {
+    lp_obj* self = LP_ARG(0);
+    lp_obj* v = LP_ARG_TYPE(1,LP_LIST);
     int i;
     for (i=0; i<v->list->len; i++) {
         _lp_list_append(lp,self->list,v->list->items[i]);
+        if (lp->ex) { return 0; }
     }
     RETURN_LP_OBJ(lp->lp_None);
 }
@@ -163,8 +183,8 @@ int _lp_sort_cmp(lp_obj **a,lp_obj **b) {
     return lp_cmp(0,*a,*b);
 }
 
-lp_obj* lpf_sort(LP) {
-    lp_obj* self = LP_OBJ(0);
+lp_obj* lpf_sort(LP, LP_ARGS) {
+    lp_obj* self = LP_ARG(0);
     qsort(self->list->items, self->list->len, sizeof(lp_obj *), (int(*)(const void**,const void**))_lp_sort_cmp);
     RETURN_LP_OBJ(lp->lp_None);
 }
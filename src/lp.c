@@ -1,6 +1,11 @@
 
 #include "lp.h"
 #include "lp_internal.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
 
 /**/
 
@@ -9,138 +14,751 @@ lp_obj* lp_none(LP)
 	RETURN_LP_OBJ(lp->lp_None);
 }
 
-static struct LpObjPool * obj_pool_new()
+/* LP_POOL_BYTES of memory aligned to LP_POOL_BYTES, see lp_pool_of. This
+ * maps pages directly, an aligned malloc would waste up to a pool per pool. */
+static void* pool_malloc(void* ud)
 {
-	struct LpObjPool * pool = (struct LpObjPool *)malloc(sizeof(struct LpObjPool));
+#ifdef _WIN32
+	/* VirtualAlloc returns 64k aligned memory */
+	return VirtualAlloc(0, LP_POOL_BYTES, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+	char *p = (char*)mmap(0, 2 * LP_POOL_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	char *a;
+	if (p == MAP_FAILED) return 0;
+	a = (char*)lp_pool_of(p + LP_POOL_BYTES - 1);
+	if (a > p) munmap(p, a - p);
+	munmap(a + LP_POOL_BYTES, p + LP_POOL_BYTES - a);
+	return a;
+#endif
+}
+
+static void pool_free(void* ud, void* p)
+{
+#ifdef _WIN32
+	VirtualFree(p, 0, MEM_RELEASE);
+#else
+	munmap(p, LP_POOL_BYTES);
+#endif
+}
+
+static void* std_alloc(void* ud, size_t size)
+{
+	return malloc(size);
+}
+
+static void std_release(void* ud, void* p, size_t size)
+{
+	free(p);
+}
+
+const lp_allocator lp_std_allocator = { std_alloc, std_release, pool_malloc, pool_free, 0 };
+
+static void pool_cache_free(LP);
+static void pool_trim(LP, int keep);
+
+/* Memory accounting
+ *
+ * Everything the VM takes from its allocator goes through mem_get and
+ * mem_put, which keep lp->mem_used and lp->mem_peak. A pool counts whole
+ * from the time it is mapped until it is unmapped, also while it is empty
+ * or in lp->pool_cache.
+ *
+ * When a block would go past the limit (see lp_mem_limit), or the
+ * allocator does not have it, mem_get first gives back what can be given
+ * back at once: the containers waiting to be freed, then all empty pools
+ * and the pool cache. What it does if that is not enough depends on the
+ * block.
+ *
+ * A block larger than a pool is refused: mem_get raises MemoryError and
+ * returns 0. These are the bodies of long strings, lists and dicts, and
+ * the code that asked for one returns without it, see lp_malloc.
+ *
+ * Pools and smaller blocks hold the objects themselves, and their callers
+ * cannot do without them. For those mem_get frees lp->mem_reserve, a
+ * block held back for this, raises MemoryError and tries again. The
+ * reserve counts in lp->mem_used, so the block takes its place under the
+ * limit; it is taken again at a later safepoint, see lp_mem_reserve. Once
+ * the reserve is spent, blocks of this kind are handed out past the limit
+ * while the exception unwinds, and the VM aborts if the allocator itself
+ * has none left.
+ *
+ * The only blocks that go past the limit otherwise are those lp_arena_end
+ * moves the items of long-lived lists and dicts to, out of arena slabs
+ * that are about to go away. It sets lp->mem_must meanwhile, and the
+ * arena it frees right after gives back more than they take.
+ *
+ * Before it comes to that, going past lp->mem_gc makes the next safepoint
+ * run the cycle collector, see lp_collect.
+ */
+
+/* what mem_get is asked for: a block or a pool */
+#define MEM_BLOCK 0
+#define MEM_POOL 1
+
+static int mem_over(LP, size_t size)
+{
+	return lp->mem_limit != LP_NO_LIMIT && lp->mem_used + size > lp->mem_limit;
+}
+
+static void mem_raise(LP)
+{
+	if (lp->ex) return;
+	LP_OBJ_INC(lp->mem_error);
+	lp->ex = lp->mem_error;
+}
+
+static void mem_put(LP, void* p, size_t size, int pool)
+{
+	lp->mem_used -= size;
+	if (pool) lp->mem.pool_release(lp->mem.ud, p);
+	else lp->mem.release(lp->mem.ud, p, size);
+}
+
+static void* mem_try(LP, size_t size, int kind)
+{
+	return kind == MEM_POOL ? lp->mem.pool_alloc(lp->mem.ud) : lp->mem.alloc(lp->mem.ud, size);
+}
+
+/* the block would go past the limit or the allocator failed: tries again
+ * after giving back what can be given back, then refuses a large block or
+ * spends the reserve on a small one */
+static void* mem_out(LP, size_t size, int kind)
+{
+	void* p = 0;
+	while (lp_free_pending(lp, LP_FREE_SLICE));
+	pool_trim(lp, 0);
+	pool_cache_free(lp);
+	if (!mem_over(lp, size) || lp->mem_must) p = mem_try(lp, size, kind);
+	if (p) return p;
+	if (kind == MEM_BLOCK && size > LP_POOL_BYTES && !lp->mem_must)
+	{
+		mem_raise(lp);
+		return 0;
+	}
+	if (lp->mem_reserve)
+	{
+		mem_put(lp, lp->mem_reserve, LP_MEM_RESERVE, 0);
+		lp->mem_reserve = 0;
+	}
+	mem_raise(lp);
+	p = mem_try(lp, size, kind);
+	if (!p)
+	{
+		fprintf(stderr, "(lp_malloc) MemoryError: out of memory\n");
+		abort();
+	}
+	return p;
+}
+
+static void* mem_get(LP, size_t size, int kind)
+{
+	void* p = 0;
+	if (!mem_over(lp, size)) p = mem_try(lp, size, kind);
+	if (!p) p = mem_out(lp, size, kind);
+	if (!p) return 0;
+	lp->mem_used += size;
+	if (lp->mem_used > lp->mem_peak) lp->mem_peak = lp->mem_used;
+	if (lp->mem_used > lp->mem_gc) lp->gc_count = lp->gc_limit;
+	return p;
+}
+
+/* takes lp->mem_reserve from the allocator if it is not held, and there is
+ * room for it under the memory limit */
+void lp_mem_reserve(LP)
+{
+	if (lp->mem_reserve) return;
+	if (lp->mem_limit != LP_NO_LIMIT && lp->mem_used + LP_MEM_RESERVE > lp->mem_limit) return;
+	lp->mem_reserve = mem_try(lp, LP_MEM_RESERVE, MEM_BLOCK);
+	if (!lp->mem_reserve) return;
+	lp->mem_used += LP_MEM_RESERVE;
+	if (lp->mem_used > lp->mem_peak) lp->mem_peak = lp->mem_used;
+}
+
+/* Function: lp_malloc
+ * Allocates size bytes from the allocator of the VM and counts them in
+ * lp->mem_used.
+ *
+ * A block larger than LP_POOL_BYTES that would go past the limit of the
+ * VM, or that the allocator does not have, is refused: lp_malloc raises
+ * MemoryError and returns 0. Smaller blocks are always returned, see the
+ * notes on memory accounting above.
+ */
+void* lp_malloc(LP, size_t size)
+{
+	return mem_get(lp, size, MEM_BLOCK);
+}
+
+/* Function: lp_free
+ * Frees a block of <lp_malloc>, size is the size it was allocated with.
+ */
+void lp_free(LP, void* p, size_t size)
+{
+	if (p) mem_put(lp, p, size, 0);
+}
+
+/* Function: lp_realloc
+ * Resizes a block of <lp_malloc> from osize to size bytes.
+ *
+ * Returns 0 and leaves p as it is if <lp_malloc> refuses the new block.
+ */
+void* lp_realloc(LP, void* p, size_t osize, size_t size)
+{
+	void* r = lp_malloc(lp, size);
+	if (!r) return 0;
+	if (p) memcpy(r, p, osize < size ? osize : size);
+	lp_free(lp, p, osize);
+	return r;
+}
+
+/* Function: lp_mem_limit
+ * Limits the memory the VM takes from its allocator to limit bytes, or
+ * lifts the limit with LP_NO_LIMIT. A script that needs more than that
+ * gets a MemoryError.
+ */
+void lp_mem_limit(LP, unsigned long limit)
+{
+	lp->mem_limit = limit;
+	lp->mem_gc = limit == LP_NO_LIMIT ? ULONG_MAX : limit - limit / 4;
+}
+
+/* unmaps p, or with keep puts it on lp->pool_cache */
+static void pool_drop(LP, void* p, int keep)
+{
+	if (!keep)
+	{
+		mem_put(lp, p, LP_POOL_BYTES, 1);
+		return;
+	}
+	*(void**)p = lp->pool_cache;
+	lp->pool_cache = p;
+}
+
+static void pool_cache_free(LP)
+{
+	void* p;
+	while ((p = lp->pool_cache))
+	{
+		lp->pool_cache = *(void**)p;
+		mem_put(lp, p, LP_POOL_BYTES, 1);
+	}
+}
+
+/* a pool from lp->pool_cache if there is one, see lp_pool_trim and
+ * lp_arena_end */
+static void* pool_get(LP)
+{
+	void* p = lp->pool_cache;
+	if (!p) return mem_get(lp, LP_POOL_BYTES, MEM_POOL);
+	lp->pool_cache = *(void**)p;
+	return p;
+}
+
+static struct LpObjPool * obj_pool_new(LP)
+{
+	struct LpObjPool * pool = (struct LpObjPool *)pool_get(lp);
 	memset(pool, 0, sizeof(struct LpObjPool));
 	for (int i = 0; i < OBJ_SIZE; i++)
 	{
-		pool->obj[i].pool = pool;
-		if (i == 0)
-		{
-			pool->obj[i].prev = 0;
-			pool->obj[i].next = &pool->obj[i+1];
-		}
-		else if (i == OBJ_SIZE - 1)
-		{
-			pool->obj[i].prev = &pool->obj[i - 1];
-			pool->obj[i].next = 0;
-		}
-		else {
-			pool->obj[i].prev = &pool->obj[i - 1];
-			pool->obj[i].next = &pool->obj[i + 1];
-		}
+		pool->obj[i].next = i < OBJ_SIZE - 1 ? &pool->obj[i + 1] : 0;
 	}
-	pool->head = &pool->obj[0];
-	pool->tail = &pool->obj[OBJ_SIZE-1];
+	pool->free = &pool->obj[0];
+	pool->next = lp->obj_pool;
+	lp->obj_pool = pool;
+	pool->next_free = lp->obj_pool_free;
+	lp->obj_pool_free = pool;
+	lp->pools_empty++;
 	return pool;
 }
 
-static struct LpDictPool * dict_pool_new()
+static struct LpDictPool * dict_pool_new(LP)
 {
-	struct LpDictPool * pool = (struct LpDictPool *)malloc(sizeof(struct LpDictPool));
+	struct LpDictPool * pool = (struct LpDictPool *)pool_get(lp);
 	memset(pool, 0, sizeof(struct LpDictPool));
 	for (int i = 0; i < DICT_SIZE; i++)
 	{
-		pool->obj[i].pool = pool;
-		if (i == 0)
-		{
-			pool->obj[i].prev = 0;
-			pool->obj[i].next = &pool->obj[i + 1];
-		}
-		else if (i == DICT_SIZE - 1)
-		{
-			pool->obj[i].prev = &pool->obj[i - 1];
-			pool->obj[i].next = 0;
-		}
-		else {
-			pool->obj[i].prev = &pool->obj[i - 1];
-			pool->obj[i].next = &pool->obj[i + 1];
-		}
+		pool->obj[i].next = i < DICT_SIZE - 1 ? &pool->obj[i + 1] : 0;
 	}
-	pool->head = &pool->obj[0];
-	pool->tail = &pool->obj[DICT_SIZE - 1];
+	pool->free = &pool->obj[0];
+	pool->next = lp->dict_pool;
+	lp->dict_pool = pool;
+	pool->next_free = lp->dict_pool_free;
+	lp->dict_pool_free = pool;
+	lp->pools_empty++;
 	return pool;
 }
 
-static struct LpListPool * list_pool_new()
+static struct LpListPool * list_pool_new(LP)
 {
-	struct LpListPool * pool = (struct LpListPool *)malloc(sizeof(struct LpListPool));
+	struct LpListPool * pool = (struct LpListPool *)pool_get(lp);
 	memset(pool, 0, sizeof(struct LpListPool));
 	for (int i = 0; i < LIST_SIZE; i++)
 	{
-		pool->obj[i].pool = pool;
-		if (i == 0)
+		pool->obj[i].next = i < LIST_SIZE - 1 ? &pool->obj[i + 1] : 0;
+	}
+	pool->free = &pool->obj[0];
+	pool->next = lp->list_pool;
+	lp->list_pool = pool;
+	pool->next_free = lp->list_pool_free;
+	lp->list_pool_free = pool;
+	lp->pools_empty++;
+	return pool;
+}
+
+static struct LpFunPool * func_pool_new(LP)
+{
+	struct LpFunPool * pool = (struct LpFunPool *)pool_get(lp);
+	memset(pool, 0, sizeof(struct LpFunPool));
+	for (int i = 0; i < FUNC_SIZE; i++)
+	{
+		pool->obj[i].next = i < FUNC_SIZE - 1 ? &pool->obj[i + 1] : 0;
+	}
+	pool->free = &pool->obj[0];
+	pool->next = lp->func_pool;
+	lp->func_pool = pool;
+	pool->next_free = lp->func_pool_free;
+	lp->func_pool_free = pool;
+	lp->pools_empty++;
+	return pool;
+}
+
+void init_lp_mem(LP)
+{
+	lp_mem_reserve(lp);
+	obj_pool_new(lp);
+	dict_pool_new(lp);
+	list_pool_new(lp);
+	func_pool_new(lp);
+	lp->lp_None = LP_IMM_NONE;
+	lp->lp_True = lp_number_from_int(lp, 1);
+	lp->lp_False = lp_number_from_int(lp, 0);
+}
+
+/* Moves the empty pools of the list all to lp->pool_cache. An empty pool
+ * has free slots, so it is also on the list avail; it is taken off that
+ * first and marked with a free of 0, which a pool that has free slots
+ * never has otherwise. */
+#define POOL_TRIM(type, all, avail) do { \
+	type **pp, *p; \
+	for (pp = &(avail); (p = *pp); ) { \
+		if (!p->used) { *pp = p->next_free; p->free = 0; } \
+		else pp = &p->next_free; \
+	} \
+	for (pp = &(all); (p = *pp); ) { \
+		if (!p->used && !p->free) { *pp = p->next; pool_drop(lp, p, 1); lp->pools_empty--; } \
+		else pp = &p->next; \
+	} \
+} while (0)
+
+/* unmaps the pools in lp->pool_cache past the first keep */
+static void pool_cache_trim(LP, int keep)
+{
+	void** pp = &lp->pool_cache;
+	void* p;
+	while ((p = *pp) && keep-- > 0) pp = (void**)p;
+	while ((p = *pp))
+	{
+		*pp = *(void**)p;
+		mem_put(lp, p, LP_POOL_BYTES, 1);
+	}
+}
+
+/* empties all pools into lp->pool_cache and keeps keep of them there.
+ * Any kind of pool or slab is made from the cache, so the spare ones serve
+ * whatever the program allocates next. */
+static void pool_trim(LP, int keep)
+{
+	POOL_TRIM(struct LpObjPool, lp->obj_pool, lp->obj_pool_free);
+	POOL_TRIM(struct LpDictPool, lp->dict_pool, lp->dict_pool_free);
+	POOL_TRIM(struct LpListPool, lp->list_pool, lp->list_pool_free);
+	POOL_TRIM(struct LpFunPool, lp->func_pool, lp->func_pool_free);
+	for (int cls = 0; cls < LP_SLAB_CLASSES; cls++)
+	{
+		POOL_TRIM(struct LpSlab, lp->slab[cls], lp->slab_free[cls]);
+	}
+	if (!lp->arena) pool_cache_trim(lp, keep);
+}
+
+/* Function: lp_pool_trim
+ * Gives the memory of empty pools and slabs back to the system.
+ *
+ * Every empty pool and slab goes to lp->pool_cache, and LP_POOL_SPARE of
+ * them are kept there. Pools and slabs of every kind are made from the
+ * cache, so that a program that keeps freeing and allocating around a pool
+ * boundary, whatever it allocates, does not map and unmap each time.
+ * Runs at safepoints once there are more than twice that many, see
+ * LP_GC_CHECK, and at the end of lp_collect.
+ */
+void lp_pool_trim(LP)
+{
+	pool_trim(lp, LP_POOL_SPARE);
+}
+
+#define POOL_FREE_ALL(type, all) do { \
+	type *p, *n; \
+	for (p = (all); p; p = n) { n = p->next; pool_drop(lp, p, keep); } \
+	(all) = 0; \
+} while (0)
+
+/* frees the pools and slabs on the lists of h, whatever is still in them.
+ * With keep they go to lp->pool_cache instead of being unmapped. */
+static void heap_free(LP, lp_heap* h, int keep)
+{
+	struct LpSlab *s, *n;
+	POOL_FREE_ALL(struct LpObjPool, h->obj_pool);
+	POOL_FREE_ALL(struct LpDictPool, h->dict_pool);
+	POOL_FREE_ALL(struct LpListPool, h->list_pool);
+	POOL_FREE_ALL(struct LpFunPool, h->func_pool);
+	for (int cls = 0; cls < LP_SLAB_CLASSES; cls++)
+	{
+		POOL_FREE_ALL(struct LpSlab, h->slab[cls]);
+	}
+	for (s = h->slab_large; s; s = n)
+	{
+		n = s->next;
+		mem_put(lp, s, s->used, 0);
+	}
+	memset(h, 0, sizeof(lp_heap));
+}
+
+#define HEAP_SWAP(type, a, b) do { type t_ = (a); (a) = (b); (b) = t_; } while (0)
+
+/* exchanges the pool and slab lists of lp with those of h */
+static void heap_swap(LP, lp_heap* h)
+{
+	HEAP_SWAP(struct LpObjPool*, lp->obj_pool, h->obj_pool);
+	HEAP_SWAP(struct LpDictPool*, lp->dict_pool, h->dict_pool);
+	HEAP_SWAP(struct LpListPool*, lp->list_pool, h->list_pool);
+	HEAP_SWAP(struct LpFunPool*, lp->func_pool, h->func_pool);
+	HEAP_SWAP(struct LpObjPool*, lp->obj_pool_free, h->obj_pool_free);
+	HEAP_SWAP(struct LpDictPool*, lp->dict_pool_free, h->dict_pool_free);
+	HEAP_SWAP(struct LpListPool*, lp->list_pool_free, h->list_pool_free);
+	HEAP_SWAP(struct LpFunPool*, lp->func_pool_free, h->func_pool_free);
+	for (int cls = 0; cls < LP_SLAB_CLASSES; cls++)
+	{
+		HEAP_SWAP(struct LpSlab*, lp->slab[cls], h->slab[cls]);
+		HEAP_SWAP(struct LpSlab*, lp->slab_free[cls], h->slab_free[cls]);
+	}
+	HEAP_SWAP(struct LpSlab*, lp->slab_large, h->slab_large);
+	HEAP_SWAP(int, lp->pools_empty, h->pools_empty);
+}
+
+/* calls free_fun for each data object still alive in the pools from p
+ * on, the host may have resources in them that dropping the pools would
+ * leak. free_fun is cleared first, so an object is only finalized once
+ * whatever the others drop. */
+static void data_free_all(LP, struct LpObjPool *p)
+{
+	int i;
+	for (; p; p = p->next)
+	{
+		for (i = 0; i < OBJ_SIZE; i++)
 		{
-			pool->obj[i].prev = 0;
-			pool->obj[i].next = &pool->obj[i + 1];
+			lp_obj* v = &p->obj[i];
+			void (*free_fun)(LP, lp_obj);
+			if (v->type != LP_DATA || !(v->ref > 0 || v->ref == LP_ARENA_DEAD)) continue;
+			free_fun = v->data.free_fun;
+			if (!free_fun) continue;
+			v->data.free_fun = 0;
+			free_fun(lp, *v);
 		}
-		else if (i == LIST_SIZE - 1)
+	}
+}
+
+/* finalizes the data objects that are left, before anything is torn down */
+void deinit_lp_data(LP)
+{
+	data_free_all(lp, lp->obj_pool);
+	if (lp->arena) data_free_all(lp, lp->kept.obj_pool);
+}
+
+/* frees all pools and slabs, whatever is still in them */
+void deinit_lp_mem(LP)
+{
+	lp_heap h = { 0 };
+	heap_swap(lp, &h);
+	heap_free(lp, &h, 0);
+	if (lp->arena) heap_free(lp, &lp->kept, 0);
+	pool_cache_free(lp);
+	if (lp->mem_reserve) mem_put(lp, lp->mem_reserve, LP_MEM_RESERVE, 0);
+}
+
+/* Arenas
+ *
+ * A VM that runs one short script after another can put everything a
+ * script allocates in an arena and drop it all at once afterwards:
+ *
+ * > lp_arena_begin(lp);
+ * > r = lp_exec(lp, code, globals);
+ * > ...
+ * > lp_arena_end(lp);
+ *
+ * Whatever exists when the arena opens (builtins, modules, anything the
+ * embedder set up) is long-lived and stays. lp_arena_begin sets those
+ * pools aside in lp->kept and the allocations that follow get pools and
+ * slabs of their own. The long-lived objects keep their real reference
+ * counts through the arena. One whose count drops to 0 is not freed while
+ * the arena is open, since its pools are not the ones the VM allocates
+ * from then; its count is set to LP_ARENA_DEAD instead.
+ *
+ * lp_arena_end drops the pools and slabs of the arena without freeing what
+ * is in them one by one. They are not unmapped but kept in lp->pool_cache,
+ * where the next arena takes its pools from, so a VM that runs request
+ * after request keeps reusing memory that is already paged in.
+ * lp_pool_trim trims the cache when no arena is open. Before dropping
+ * them, lp_arena_end gives back the references the objects of the arena
+ * hold to long-lived ones, which costs a pass over the arena. A pass over
+ * the long-lived objects then drops the references they hold into the
+ * arena: a long-lived dict forgets the keys that are in the arena and its
+ * values in the arena become None, a long-lived list gets None in their
+ * place, and the items of long-lived dicts and lists that grew into arena
+ * slabs are copied out first. The long-lived objects that died during the
+ * arena, or by losing the references of the arena, are freed then.
+ *
+ * Between the two calls the VM works as usual, reference counting and the
+ * cycle collector reuse memory inside the arena. Arenas do not nest, and
+ * lp_arena_end must not be called from code that runs in the arena.
+ */
+
+#define ARENA_OBJ(v) ((v) && lp_is_ptr(v) && \
+	((struct LpObjPool *)lp_pool_of(v))->gc_base >= 0)
+
+/* gives back the references the object v of the arena holds to long-lived
+ * objects, the arena is about to be dropped without freeing v */
+static void arena_release(LP, lp_obj* v)
+{
+	int i;
+	switch (v->type)
+	{
+	case LP_STRING:
+	{
+		_lp_string *s = v->string.info;
+		if (s && !((struct LpSlab*)s->pool)->arena && --s->ref == 0) lp_string_release(lp, s);
+		break;
+	}
+	case LP_LIST:
+		for (i = 0; i < v->list->len; i++)
 		{
-			pool->obj[i].prev = &pool->obj[i - 1];
-			pool->obj[i].next = 0;
+			if (!ARENA_OBJ(v->list->items[i])) LP_OBJ_DEC(v->list->items[i]);
 		}
-		else {
-			pool->obj[i].prev = &pool->obj[i - 1];
-			pool->obj[i].next = &pool->obj[i + 1];
+		break;
+	case LP_DICT:
+	{
+		_lp_dict *d = v->dict.val;
+		for (i = 0; i < d->used; i++)
+		{
+			if (d->items[i].used <= 0) continue;
+			if (!ARENA_OBJ(d->items[i].key)) LP_OBJ_DEC(d->items[i].key);
+			if (!ARENA_OBJ(d->items[i].val)) LP_OBJ_DEC(d->items[i].val);
 		}
+		if (!ARENA_OBJ(d->meta)) LP_OBJ_DEC(d->meta);
+		break;
+	}
+	case LP_FNC:
+	{
+		_lp_fnc *f = v->fnc.info;
+		if (!ARENA_OBJ(f->self)) LP_OBJ_DEC(f->self);
+		if (!ARENA_OBJ(f->globals)) LP_OBJ_DEC(f->globals);
+		if (!ARENA_OBJ(f->code)) LP_OBJ_DEC(f->code);
+		if (!ARENA_OBJ(f->consts)) LP_OBJ_DEC(f->consts);
+		break;
+	}
+	case LP_DATA:
+		if (_lp_dict_view(v))
+		{
+			if (!ARENA_OBJ((lp_obj*)v->data.val)) LP_OBJ_DEC((lp_obj*)v->data.val);
+		}
+		else if (v->data.free_fun)
+		{
+			v->data.free_fun(lp, *v);
+		}
+		break;
 	}
-	pool->head = &pool->obj[0];
-	pool->tail = &pool->obj[LIST_SIZE - 1];
-	return pool;
 }
 
-static struct LpFunPool * func_pool_new()
+/* drops the references of the long-lived v into the arena that is being
+ * closed, and moves its items out of arena slabs */
+static void arena_scrub(LP, lp_obj* v)
 {
-	struct LpFunPool * pool = (struct LpFunPool *)malloc(sizeof(struct LpFunPool));
-	memset(pool, 0, sizeof(struct LpFunPool));
-	for (int i = 0; i < FUNC_SIZE; i++)
+	int i;
+	switch (v->type)
 	{
-		pool->obj[i].pool = pool;
-		if (i == 0)
+	case LP_LIST:
+	{
+		_lp_list *l = v->list;
+		for (i = 0; i < l->len; i++)
 		{
-			pool->obj[i].prev = 0;
-			pool->obj[i].next = &pool->obj[i + 1];
+			if (ARENA_OBJ(l->items[i])) l->items[i] = lp->lp_None;
 		}
-		else if (i == FUNC_SIZE - 1)
+		if (l->alloc && ((struct LpSlab*)l->item_pool)->arena)
 		{
-			pool->obj[i].prev = &pool->obj[i - 1];
-			pool->obj[i].next = 0;
+			lp_obj** items = lp_obj_array_malloc(lp, l->alloc, &l->item_pool, &l->item_index);
+			memcpy(items, l->items, l->len * sizeof(lp_obj*));
+			l->items = items;
 		}
-		else {
-			pool->obj[i].prev = &pool->obj[i - 1];
-			pool->obj[i].next = &pool->obj[i + 1];
+		break;
+	}
+	case LP_DICT:
+	{
+		_lp_dict *d = v->dict.val;
+		int changed = 0, removed = 0;
+		for (i = 0; i < d->used; i++)
+		{
+			lp_item* t = &d->items[i];
+			if (t->used <= 0) continue;
+			if (ARENA_OBJ(t->key))
+			{
+				t->used = -1;
+				d->len--;
+				changed = removed = 1;
+			}
+			else if (ARENA_OBJ(t->val))
+			{
+				t->val = lp->lp_None;
+				changed = 1;
+			}
+		}
+		if (ARENA_OBJ(d->meta))
+		{
+			d->meta = 0;
+			changed = 1;
 		}
+		if (changed) LP_DICT_CHANGED(lp, d);
+		if (removed) d->shape = 0;
+		/* rebuilding the index drops the removed entries */
+		if (d->alloc && (removed || ((struct LpSlab*)d->item_pool)->arena))
+		{
+			_lp_dict_lp_realloc(lp, d, d->alloc);
+		}
+		break;
+	}
+	/* functions are made with all their fields and never change */
 	}
-	pool->head = &pool->obj[0];
-	pool->tail = &pool->obj[FUNC_SIZE - 1];
-	return pool;
 }
 
-void init_lp_mem(LP)
+/* marks s and the shapes below it to be freed by shape_prune */
+static void shape_doom(lp_shape *s)
 {
-	lp->obj_pool = obj_pool_new();
-	lp->string_pool = 0;
-	lp->item_pool = 0;
-	lp->obj_array_pool = 0;
-	lp->dict_pool = dict_pool_new();
-	lp->list_pool = list_pool_new();
-	lp->func_pool = func_pool_new();
-	lp->lp_None = lp_obj_new(lp, LP_NONE);
-	lp->lp_True = lp_number_from_int(lp, 1);
-	lp->lp_False = lp_number_from_int(lp, 0);
+	lp_shape *c;
+	s->len = -1;
+	for (c = s->child; c; c = c->sibling) shape_doom(c);
+}
+
+/* frees the shapes that add a key of the arena and those below them, the
+ * objects that have them are gone. The attribute caches that still point
+ * at them never match again, since the meta_version moves. */
+static void shape_prune(LP)
+{
+	lp_shape *s, **pp;
+	for (s = lp->shapes; s; s = s->all)
+	{
+		if (s->len < 0 || !s->key || !ARENA_OBJ(s->key)) continue;
+		for (pp = &s->parent->child; *pp != s; pp = &(*pp)->sibling);
+		*pp = s->sibling;
+		shape_doom(s);
+	}
+	for (pp = &lp->shapes; (s = *pp); )
+	{
+		if (s->len >= 0)
+		{
+			pp = &s->all;
+			continue;
+		}
+		*pp = s->all;
+		lp_free(lp, s, sizeof(lp_shape));
+		lp->shape_count--;
+	}
+	lp->meta_version++;
+}
+
+/* Function: lp_arena_begin
+ * Opens an arena: the objects allocated until <lp_arena_end> are freed
+ * together by it, the ones that exist now are kept.
+ *
+ * Does nothing if an arena is already open.
+ */
+void lp_arena_begin(LP)
+{
+	struct LpObjPool *p;
+	if (lp->arena) return;
+	while (lp_free_pending(lp, LP_FREE_SLICE));
+	for (p = lp->obj_pool; p; p = p->next) p->gc_base = -1;
+	heap_swap(lp, &lp->kept);
+	lp->arena = 1;
+	lp->gc_count = 0;
+}
+
+/* Function: lp_arena_end
+ * Frees everything allocated since <lp_arena_begin> at once.
+ *
+ * References the long-lived objects hold into the arena are dropped, see
+ * the notes at the top of this section.
+ */
+void lp_arena_end(LP)
+{
+	struct LpObjPool *p;
+	int i;
+	if (!lp->arena) return;
+	/* whatever waits to be freed is in the arena, but may still hold
+	 * long-lived objects */
+	while (lp_free_pending(lp, LP_FREE_SLICE));
+	for (p = lp->obj_pool; p; p = p->next)
+	{
+		for (i = 0; i < OBJ_SIZE; i++)
+		{
+			if (p->obj[i].ref > 0) arena_release(lp, &p->obj[i]);
+		}
+	}
+	heap_swap(lp, &lp->kept);
+	lp->arena = 0;
+
+	/* items cannot stay in the arena, see the notes on memory accounting */
+	lp->mem_must = 1;
+	for (p = lp->obj_pool; p; p = p->next)
+	{
+		for (i = 0; i < OBJ_SIZE; i++)
+		{
+			lp_obj* v = &p->obj[i];
+			if (v->ref > 0) arena_scrub(lp, v);
+			else if (v->ref == LP_ARENA_DEAD)
+			{
+				arena_scrub(lp, v);
+				v->ref = 1;
+				LP_OBJ_DEC(v);
+			}
+		}
+	}
+	lp->mem_must = 0;
+	for (i = 0; i < LP_FRAMES; i++)
+	{
+		lp_frame_ *f = &lp->frames[i];
+		if (ARENA_OBJ(f->code))
+		{
+			f->code = 0;
+			f->cur = f->jmp = 0;
+		}
+		if (ARENA_OBJ(f->fname)) f->fname = 0;
+		if (ARENA_OBJ(f->name)) f->name = 0;
+		if (ARENA_OBJ(f->globals)) f->globals = 0;
+		if (ARENA_OBJ(f->consts)) f->consts = 0;
+	}
+	if (ARENA_OBJ(lp->ex)) lp->ex = 0;
+	if (ARENA_OBJ(lp->oldex)) lp->oldex = 0;
+	shape_prune(lp);
+
+	heap_free(lp, &lp->kept, 1);
+	lp->gc_count = 0;
 }
 
 void lp_print_object_pool(LP)
 {
-	int num[8] = { 0 };
+	int num[LP_RANGE+1] = { 0 };
 
-	struct LpObjPool *p = lp->obj_pool;
-	while (1)
+	struct LpObjPool *p;
+	for (p = lp->obj_pool; p; p = p->next)
 	{
-		lp_obj* n = p->head;
-		while (n)
+		for (int i = 0; i < OBJ_SIZE; i++)
 		{
+			lp_obj* n = &p->obj[i];
 			if (n->ref)
 			{
 				num[n->type]++;
@@ -152,13 +770,10 @@ void lp_print_object_pool(LP)
 						printf("string : %s\n", n->string.val);
 				}
 			}
-			n = n->next;
 		}
-		if (!p->next) break;
-		p = p->next;
 	}
 
-	for (int i = 0; i < 8; i++)
+	for (int i = 0; i <= LP_RANGE; i++)
 	{
 		printf("%d %d\n", i, num[i]);
 	}
@@ -168,51 +783,49 @@ void lp_print_object_pool(LP)
 lp_obj* lp_obj_new(LP, int type)
 {
 	lp_obj* n;
-	struct LpObjPool *p = lp->obj_pool;
-	while (1)
+	struct LpObjPool *p = lp->obj_pool_free;
+	if (!p && lp->dead_count)
 	{
-		if (p->head->ref == 0)
-		{
-			n = p->head;
-			n->type = type;
-			n->ref = 1;
-			n->prev = p->tail;
-			p->tail->next = n;
-			p->head = n->next;
-			p->head->prev = 0;
-			p->tail = n;
-			n->next = 0;
-			return n;
-		}
-		if (!p->next) break;
-		p = p->next;
+		lp_free_pending(lp, LP_FREE_SLICE);
+		p = lp->obj_pool_free;
 	}
-
-	p->next = obj_pool_new();
-	p = p->next;
-	n = p->head;
+	if (!p) p = obj_pool_new(lp);
+	n = p->free;
+	p->free = n->next;
+	if (!p->free) lp->obj_pool_free = p->next_free;
+	if (!p->used++) lp->pools_empty--;
 	n->type = type;
 	n->ref = 1;
-	n->prev = p->tail;
-	p->tail->next = n;
-	p->head = n->next;
-	p->head->prev = 0;
-	p->tail = n;
 	n->next = 0;
 	return n;
 }
 
+static void obj_release(LP, lp_obj* obj)
+{
+	struct LpObjPool *p = (struct LpObjPool *)lp_pool_of(obj);
+	if (!p->free)
+	{
+		p->next_free = lp->obj_pool_free;
+		lp->obj_pool_free = p;
+	}
+	obj->next = p->free;
+	p->free = obj;
+	if (!--p->used) lp->pools_empty++;
+}
+
 void lp_obj_dec(LP, lp_obj* obj)
 {
-	int type;
-	if (!obj) return;
-	type = obj->type;
-	if (type < 0)
-		return;
+	if (!obj || !lp_is_ptr(obj)) return;
 	obj->ref--;
 	if (obj->ref == 0)
 	{
-		switch (type)
+		/* long-lived, freed by lp_arena_end */
+		if (lp->arena && !ARENA_OBJ(obj))
+		{
+			obj->ref = LP_ARENA_DEAD;
+			return;
+		}
+		switch (obj->type)
 		{
 		case LP_STRING:
 			if (obj->string.info)
@@ -223,470 +836,374 @@ void lp_obj_dec(LP, lp_obj* obj)
 			}
 			break;
 		case LP_LIST:
-			obj->type = -obj->type;
-			for (int i = 0; i < obj->list->len; i++)
-			{
-				lp_obj* t = obj->list->items[i];
-				lp_obj_dec(lp, t);
-			}
-			obj->type = -obj->type;
-			_lp_list_free(lp, obj->list);
+			obj->list->next = lp->dead_lists;
+			lp->dead_lists = obj->list;
+			lp->dead_count++;
 			break;
 		case LP_DICT:
-			obj->type = -obj->type;
-			for (int i = 0; i < obj->dict.val->alloc; i++)
-			{
-				lp_item *t = &obj->dict.val->items[i];
-				if (t->used)
-				{
-					lp_obj_dec(lp, t->key);
-					lp_obj_dec(lp, t->val);
-				}
-			}
-			lp_obj_dec(lp, obj->dict.val->meta);
-			obj->type = -obj->type;
-			_lp_dict_free(lp, obj->dict.val);
+			obj->dict.val->next = lp->dead_dicts;
+			lp->dead_dicts = obj->dict.val;
+			lp->dead_count++;
 			break;
 		case LP_FNC:
-			obj->type = -obj->type;
-			lp_obj_dec(lp, obj->fnc.info->code);
-			lp_obj_dec(lp, obj->fnc.info->self);
-			lp_obj_dec(lp, obj->fnc.info->globals);
-			lp_fnc_free(lp, obj->fnc.info);
-			obj->type = -obj->type;
+			obj->fnc.info->next = lp->dead_fncs;
+			lp->dead_fncs = obj->fnc.info;
+			lp->dead_count++;
+			break;
+		case LP_DATA:
+			if (obj->data.free_fun) obj->data.free_fun(lp, *obj);
 			break;
 		}
 
-		struct LpObjPool *p = (struct LpObjPool *)obj->pool;
-		if (obj->prev)
+		obj_release(lp, obj);
+	}
+}
+
+/* Function: lp_free_pending
+ * Tears down containers whose last reference is gone.
+ *
+ * lp_obj_dec does not free the contents of a list, dict or function, it
+ * queues the container, so dropping a big structure takes constant time and
+ * no C stack. The queue is worked off here, budget slots at a time: at the
+ * safepoints of the VM, before a pool grows, and all at once in
+ * lp_collect. Children that die go to the queue as well.
+ *
+ * Returns:
+ * Non-zero if there is more to free.
+ */
+int lp_free_pending(LP, int budget)
+{
+	while (budget > 0)
+	{
+		if (lp->dead_lists)
 		{
-			obj->prev->next = obj->next;
-			p->head->prev = obj;
+			_lp_list* l = lp->dead_lists;
+			lp->dead_lists = l->next;
+			while (l->len && budget > 0)
+			{
+				lp_obj* t = l->items[--l->len];
+				LP_OBJ_DEC(t);
+				budget--;
+			}
+			if (l->len)
+			{
+				l->next = lp->dead_lists;
+				lp->dead_lists = l;
+				break;
+			}
+			_lp_list_free(lp, l);
 		}
-		else {
-			return;
+		else if (lp->dead_dicts)
+		{
+			_lp_dict* d = lp->dead_dicts;
+			lp->dead_dicts = d->next;
+			while (d->used && budget > 0)
+			{
+				lp_item* t = &d->items[--d->used];
+				if (t->used > 0)
+				{
+					LP_OBJ_DEC(t->key);
+					LP_OBJ_DEC(t->val);
+				}
+				budget--;
+			}
+			if (d->used)
+			{
+				d->next = lp->dead_dicts;
+				lp->dead_dicts = d;
+				break;
+			}
+			LP_OBJ_DEC(d->meta);
+			_lp_dict_free(lp, d);
 		}
-		if (obj->next)
+		else if (lp->dead_fncs)
 		{
-			obj->next->prev = obj->prev;
+			_lp_fnc* f = lp->dead_fncs;
+			lp->dead_fncs = f->next;
+			LP_OBJ_DEC(f->code);
+			LP_OBJ_DEC(f->self);
+			LP_OBJ_DEC(f->globals);
+			LP_OBJ_DEC(f->consts);
+			lp_fnc_free(lp, f);
 		}
-		else {
-			p->tail = obj->prev;
+		else
+		{
+			break;
 		}
-		obj->prev = 0;
-		obj->next = p->head;
-		p->head = obj;
+		lp->dead_count--;
+		budget--;
 	}
+	return lp->dead_count;
 }
 
-static int find_bit_map(int *bit_map, int count, int total)
+static const int slab_size[LP_SLAB_CLASSES] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096,
+};
+
+static struct LpSlab* slab_new(LP, int cls)
 {
-	int i = 0, j = 0, m;
-	total -= count;
-	while (i <= total)
+	int size = slab_size[cls], n = LP_SLAB_BYTES / size;
+	struct LpSlab* slab = (struct LpSlab*)pool_get(lp);
+	for (int i = 0; i < n; i++)
 	{
-		m = i + count;
-		for (j = i; j < m; j++)
-		{
-			if (((bit_map[j / 32]) >> (j % 32)) & 1)
-				break;
-		}
-		if (j == m) return i;
-		i = j + 1;
+		*(void**)&slab->mem[i * size] = i < n - 1 ? &slab->mem[(i + 1) * size] : 0;
 	}
-
-	return -1;
+	slab->free = slab->mem;
+	slab->used = 0;
+	slab->cls = cls;
+	slab->arena = lp->arena;
+	slab->next = lp->slab[cls];
+	lp->slab[cls] = slab;
+	slab->next_free = lp->slab_free[cls];
+	lp->slab_free[cls] = slab;
+	lp->pools_empty++;
+	return slab;
 }
 
-static void set_bit_map(int *bit_map, int start, int count)
+/* a block of at least size bytes, *pool is set to the slab it is in; 0
+ * if the block is too large for a slab and mem_get refuses it */
+static void* slab_malloc(LP, size_t size, struct LpSlab** pool)
 {
-	int m = start + count;
-	for (int i = start; i < m; i++)
+	struct LpSlab* slab;
+	void* r;
+	int cls = 0;
+	while (cls < LP_SLAB_CLASSES && slab_size[cls] < size) cls++;
+	if (cls == LP_SLAB_CLASSES)
 	{
-		if (bit_map[i / 32] & (1 << (i % 32)))
+		if (size > INT_MAX - sizeof(struct LpSlab))
 		{
-			//printf("123\n");
+			mem_raise(lp);
+			return 0;
 		}
-		bit_map[i / 32] |= (1 << (i%32));
+		slab = (struct LpSlab*)mem_get(lp, sizeof(struct LpSlab) + size, MEM_BLOCK);
+		if (!slab) return 0;
+		slab->next = lp->slab_large;
+		slab->next_free = 0;
+		if (slab->next) slab->next->next_free = slab;
+		lp->slab_large = slab;
+		slab->free = 0;
+		slab->used = (int)sizeof(struct LpSlab) + size;
+		slab->cls = cls;
+		slab->arena = lp->arena;
+		*pool = slab;
+		return slab->mem;
 	}
-
-	if (count >= 256)
-		m = 10;
+	slab = lp->slab_free[cls];
+	if (!slab) slab = slab_new(lp, cls);
+	r = slab->free;
+	slab->free = *(void**)r;
+	if (!slab->free) lp->slab_free[cls] = slab->next_free;
+	if (!slab->used++) lp->pools_empty--;
+	*pool = slab;
+	return r;
 }
 
-static void reset_bit_map(int *bit_map, int start, int count)
+static void slab_release(LP, struct LpSlab* slab, void* p)
 {
-	int m = start + count;
-	for (int i = start; i < m; i++)
+	/* the items of a long-lived dict or list can be released while an arena
+	 * is open, their slab goes back to the kept lists */
+	lp_heap *h = slab->arena == lp->arena ? 0 : &lp->kept;
+	if (slab->cls == LP_SLAB_CLASSES)
 	{
-		if (!(bit_map[i / 32] & (1 << (i % 32))))
-		{
-			//printf("123\n");
-		}
-		bit_map[i / 32] &= ~(1 << (i % 32));
+		if (slab->next) slab->next->next_free = slab->next_free;
+		if (slab->next_free) slab->next_free->next = slab->next;
+		else if (h) h->slab_large = slab->next;
+		else lp->slab_large = slab->next;
+		mem_put(lp, slab, slab->used, 0);
+		return;
+	}
+	if (!slab->free)
+	{
+		struct LpSlab **avail = h ? &h->slab_free[slab->cls] : &lp->slab_free[slab->cls];
+		slab->next_free = *avail;
+		*avail = slab;
+	}
+	*(void**)p = slab->free;
+	slab->free = p;
+	if (!--slab->used)
+	{
+		if (h) h->pools_empty++;
+		else lp->pools_empty++;
 	}
 }
 
+/* item_index is the offset of the items in their slab */
 lp_item* lp_item_malloc(LP, int count, void** item_pool, int* item_index)
 {
-	struct LpItemPool *p;
-	int total_size = count;
-	if (!lp->item_pool)
+	struct LpSlab* slab;
+	lp_item* r;
+	if (!count)
 	{
-		if (total_size < 1024) total_size = 1024;
-		else if (total_size < 2048) total_size = 2048;
-		else if (total_size < 4096) total_size = 4096;
-		lp->item_pool = (struct LpItemPool*)malloc(sizeof(struct LpItemPool) + total_size * sizeof(lp_item));
-		lp->item_pool->bit_map = (int*)malloc((total_size / 32 + 1) * sizeof(int));
-		memset(lp->item_pool->bit_map, 0, (total_size / 32 + 1) * sizeof(int));
-		lp->item_pool->next = 0;
-		lp->item_pool->total_size = total_size;
-		lp->item_pool->not_used = total_size;
+		*item_pool = 0;
+		*item_index = 0;
+		return 0;
 	}
-
-	p = lp->item_pool;
-	do
-	{
-		int n = -1;
-		if (p->not_used >= count)
-			n = find_bit_map(p->bit_map, count, p->total_size);
-		if (n >= 0)
-		{
-			set_bit_map(p->bit_map, n, count);
-			p->not_used -= count;
-			*item_pool = p;
-			*item_index = n;
-			memset(&(p->mem[n]), 0, count * sizeof(lp_item));
-			return &(p->mem[n]);
-		}
-		if (!p->next) break;
-		p = p->next;
-	} while (p);
-
-	if (total_size < 1024) total_size = 1024;
-	else if (total_size < 2048) total_size = 2048;
-	else if (total_size < 4096) total_size = 4096;
-	p->next = (struct LpItemPool*)malloc(sizeof(struct LpItemPool) + total_size * sizeof(lp_item));
-	p->next->bit_map = (int*)malloc((total_size / 32 + 1) * sizeof(int));
-	memset(p->next->bit_map, 0, (total_size / 32 + 1) * sizeof(int));
-	set_bit_map(p->next->bit_map, 0, count);
-	p->next->next = 0;
-	p->next->total_size = total_size;
-	p->next->not_used = total_size - count;
-	*item_pool = p->next;
-	*item_index = 0;
-	memset(&(p->next->mem[0]), 0, count * sizeof(lp_item));
-	return &(p->next->mem[0]);
+	if (lp->dead_count) lp->free_credit += count;
+	r = (lp_item*)slab_malloc(lp, count * sizeof(lp_item), &slab);
+	if (!r) return 0;
+	*item_pool = slab;
+	*item_index = (int)((char*)r - slab->mem);
+	memset(r, 0, count * sizeof(lp_item));
+	return r;
 }
 
 void lp_item_release(LP, int count, void* item_pool, int item_index)
 {
-	struct LpItemPool *pool = (struct LpItemPool *)item_pool;
-	reset_bit_map(pool->bit_map, item_index, count);
-	pool->not_used += count;
+	struct LpSlab* slab = (struct LpSlab*)item_pool;
+	if (!count) return;
+	slab_release(lp, slab, &slab->mem[item_index]);
 }
 
 lp_obj** lp_obj_array_malloc(LP, int count, void** item_pool, int* item_index)
 {
-	struct LpObjArrayPool *p;
-	int total_size = count;
-	if (!lp->obj_array_pool)
+	struct LpSlab* slab;
+	lp_obj** r;
+	if (!count)
 	{
-		if (total_size < 1024) total_size = 1024;
-		else if (total_size < 2048) total_size = 2048;
-		else if (total_size < 4096) total_size = 4096;
-		lp->obj_array_pool = (struct LpObjArrayPool*)malloc(sizeof(struct LpObjArrayPool) + total_size * sizeof(lp_obj*));
-		lp->obj_array_pool->bit_map = (int*)malloc((total_size / 32 + 1) * sizeof(int));
-		memset(lp->obj_array_pool->bit_map, 0, (total_size / 32 + 1) * sizeof(int));
-		lp->obj_array_pool->next = 0;
-		lp->obj_array_pool->total_size = total_size;
-		lp->obj_array_pool->not_used = total_size;
+		*item_pool = 0;
+		*item_index = 0;
+		return 0;
 	}
-
-	p = lp->obj_array_pool;
-	do
-	{
-		int n = -1;
-		if (p->not_used >= count)
-			n = find_bit_map(p->bit_map, count, p->total_size);
-		if (n >= 0)
-		{
-			set_bit_map(p->bit_map, n, count);
-			p->not_used -= count;
-			*item_pool = p;
-			*item_index = n;
-			return &(p->mem[n]);
-		}
-		if (!p->next) break;
-		p = p->next;
-	} while (p);
-
-	if (total_size < 1024) total_size = 1024;
-	else if (total_size < 2048) total_size = 2048;
-	else if (total_size < 4096) total_size = 4096;
-	p->next = (struct LpObjArrayPool*)malloc(sizeof(struct LpObjArrayPool) + total_size * sizeof(lp_obj*));
-	p->next->bit_map = (int*)malloc((total_size / 32 + 1) * sizeof(int));
-	memset(p->next->bit_map, 0, (total_size / 32 + 1) * sizeof(int));
-	set_bit_map(p->next->bit_map, 0, count);
-	p->next->next = 0;
-	p->next->total_size = total_size;
-	p->next->not_used = total_size - count;
-	*item_pool = p->next;
-	*item_index = 0;
-	return &(p->next->mem[0]);
+	if (lp->dead_count) lp->free_credit += count;
+	r = (lp_obj**)slab_malloc(lp, count * sizeof(lp_obj*), &slab);
+	if (!r) return 0;
+	*item_pool = slab;
+	*item_index = (int)((char*)r - slab->mem);
+	return r;
 }
 
 void lp_obj_array_release(LP, int count, void* item_pool, int item_index)
 {
-	struct LpObjArrayPool *pool = (struct LpObjArrayPool *)item_pool;
-	reset_bit_map(pool->bit_map, item_index, count);
-	pool->not_used += count;
+	struct LpSlab* slab = (struct LpSlab*)item_pool;
+	if (!count) return;
+	slab_release(lp, slab, &slab->mem[item_index]);
 }
 
 _lp_dict* lp_dict_new(LP)
 {
 	_lp_dict* n;
-	struct LpDictPool *p = lp->dict_pool;
-	while (1)
+	struct LpDictPool *p = lp->dict_pool_free;
+	if (!p && lp->dead_count)
 	{
-		if (p->head->hold == 0)
-		{
-			n = p->head;
-			n->hold = 1;
-			n->prev = p->tail;
-			p->tail->next = n;
-			p->head = n->next;
-			p->head->prev = 0;
-			p->tail = n;
-			n->next = 0;
-			return n;
-		}
-		if (!p->next) break;
-		p = p->next;
+		lp_free_pending(lp, LP_FREE_SLICE);
+		p = lp->dict_pool_free;
 	}
-
-	p->next = dict_pool_new();
-	p = p->next;
-	n = p->head;
+	if (!p) p = dict_pool_new(lp);
+	n = p->free;
+	p->free = n->next;
+	if (!p->free) lp->dict_pool_free = p->next_free;
+	if (!p->used++) lp->pools_empty--;
 	n->hold = 1;
-	n->prev = p->tail;
-	p->tail->next = n;
-	p->head = n->next;
-	p->head->prev = 0;
-	p->tail = n;
+	n->version = ++lp->dict_version;
 	n->next = 0;
+	lp->gc_count++;
 	return n;
 }
 
 void lp_dict_release(LP, _lp_dict* dict)
 {
-	struct LpDictPool *p = (struct LpDictPool *)dict->pool;
+	struct LpDictPool *p = (struct LpDictPool *)lp_pool_of(dict);
 	dict->hold = 0;
 	dict->len = 0;
 	dict->alloc = 0;
 	dict->meta = 0;
 	dict->used = 0;
-	if (dict->prev)
+	dict->asize = 0;
+	dict->shape = 0;
+	/* a new dict at the same place must not pass for this meta */
+	if (dict->is_meta) lp->meta_version++;
+	dict->is_meta = 0;
+	if (!p->free)
 	{
-		dict->prev->next = dict->next;
-		p->head->prev = dict;
-	}
-	else {
-		return;
+		p->next_free = lp->dict_pool_free;
+		lp->dict_pool_free = p;
 	}
-	if (dict->next)
-	{
-		dict->next->prev = dict->prev;
-	}
-	else {
-		p->tail = dict->prev;
-	}
-	dict->prev = 0;
-	dict->next = p->head;
-	p->head = dict;
+	dict->next = p->free;
+	p->free = dict;
+	if (!--p->used) lp->pools_empty++;
 }
 
 _lp_list* lp_list_new(LP)
 {
 	_lp_list* n;
-	struct LpListPool *p = lp->list_pool;
-	while (1)
+	struct LpListPool *p = lp->list_pool_free;
+	if (!p && lp->dead_count)
 	{
-		if (p->head->hold == 0)
-		{
-			n = p->head;
-			n->hold = 1;
-			n->prev = p->tail;
-			p->tail->next = n;
-			p->head = n->next;
-			p->head->prev = 0;
-			p->tail = n;
-			n->next = 0;
-			return n;
-		}
-		if (!p->next) break;
-		p = p->next;
+		lp_free_pending(lp, LP_FREE_SLICE);
+		p = lp->list_pool_free;
 	}
-
-	p->next = list_pool_new();
-	p = p->next;
-	n = p->head;
+	if (!p) p = list_pool_new(lp);
+	n = p->free;
+	p->free = n->next;
+	if (!p->free) lp->list_pool_free = p->next_free;
+	if (!p->used++) lp->pools_empty--;
 	n->hold = 1;
-	n->prev = p->tail;
-	p->tail->next = n;
-	p->head = n->next;
-	p->head->prev = 0;
-	p->tail = n;
 	n->next = 0;
+	lp->gc_count++;
 	return n;
 }
 
 void lp_list_release(LP, _lp_list* list)
 {
-	struct LpListPool *p = (struct LpListPool *)list->pool;
+	struct LpListPool *p = (struct LpListPool *)lp_pool_of(list);
 	list->hold = 0;
-	if (list->prev)
+	if (!p->free)
 	{
-		list->prev->next = list->next;
-		p->head->prev = list;
+		p->next_free = lp->list_pool_free;
+		lp->list_pool_free = p;
 	}
-	else {
-		return;
-	}
-	if (list->next)
-	{
-		list->next->prev = list->prev;
-	}
-	else {
-		p->tail = list->prev;
-	}
-	list->prev = 0;
-	list->next = p->head;
-	p->head = list;
+	list->next = p->free;
+	p->free = list;
+	if (!--p->used) lp->pools_empty++;
 }
 
 _lp_string* lp_string_new(LP, int len)
 {
-	_lp_string* r;
-	struct LpStringPool *p;
-	int total_size, size;
-	size = len + sizeof(_lp_string);
-	total_size = size;
-	if (!lp->string_pool)
-	{
-		if (total_size < 1024) total_size = 1024;
-		else if (total_size < 2048) total_size = 2048;
-		else if (total_size < 4096) total_size = 4096;
-		lp->string_pool = (struct LpStringPool*)malloc(sizeof(struct LpStringPool) + total_size);
-		lp->string_pool->bit_map = (int*)malloc((total_size / 32 + 1) * sizeof(int));
-		memset(lp->string_pool->bit_map, 0, (total_size / 32 + 1) * sizeof(int));
-		lp->string_pool->next = 0;
-		lp->string_pool->total_size = total_size;
-		lp->string_pool->not_used = total_size;
-	}
-
-	p = lp->string_pool;
-	do
-	{
-		int n = -1;
-		if (p->not_used >= size)
-			n = find_bit_map(p->bit_map, size, p->total_size);
-		if (n >= 0)
-		{
-			set_bit_map(p->bit_map, n, size);
-			p->not_used -= size;
-			r = (_lp_string *)&(p->mem[n]);
-			r->ref = 1;
-			r->len = len;
-			r->pool = p;
-			r->index = n;
-			return r;
-		}
-		if (!p->next) break;
-		p = p->next;
-	} while (p);
-
-	if (total_size < 1024) total_size = 1024;
-	else if (total_size < 2048) total_size = 2048;
-	else if (total_size < 4096) total_size = 4096;
-	p->next = (struct LpStringPool*)malloc(sizeof(struct LpStringPool) + total_size);
-	p->next->bit_map = (int*)malloc((total_size / 32 + 1) * sizeof(int));
-	memset(p->next->bit_map, 0, (total_size / 32 + 1) * sizeof(int));
-	p->next->next = 0;
-	p->next->total_size = total_size;
-	set_bit_map(p->next->bit_map, 0, size);
-	p->next->not_used = total_size - size;
-	r = (_lp_string *)&(p->next->mem[0]);
+	struct LpSlab* slab;
+	/* one more byte for the terminator lp_printf's vsprintf writes */
+	_lp_string* r = (_lp_string*)slab_malloc(lp, (size_t)len + 1 + sizeof(_lp_string), &slab);
+	if (!r) return 0;
 	r->ref = 1;
 	r->len = len;
-	r->pool = p->next;
-	r->index = 0;
+	r->pool = slab;
 	return r;
 }
 
 void lp_string_release(LP, _lp_string* string)
 {
-	struct LpStringPool *pool = (struct LpStringPool *)string->pool;
-	int count = string->len + sizeof(_lp_string);
-	reset_bit_map(pool->bit_map, string->index, count);
-	pool->not_used += count;
+	slab_release(lp, (struct LpSlab*)string->pool, string);
 }
 
 _lp_fnc* lp_fnc_malloc(LP)
 {
 	_lp_fnc* n;
-	struct LpFunPool *p = lp->func_pool;
-	while (1)
+	struct LpFunPool *p = lp->func_pool_free;
+	if (!p && lp->dead_count)
 	{
-		if (p->head->hold == 0)
-		{
-			n = p->head;
-			n->hold = 1;
-			n->prev = p->tail;
-			p->tail->next = n;
-			p->head = n->next;
-			p->head->prev = 0;
-			p->tail = n;
-			n->next = 0;
-			return n;
-		}
-		if (!p->next) break;
-		p = p->next;
+		lp_free_pending(lp, LP_FREE_SLICE);
+		p = lp->func_pool_free;
 	}
-
-	p->next = func_pool_new();
-	p = p->next;
-	n = p->head;
+	if (!p) p = func_pool_new(lp);
+	n = p->free;
+	p->free = n->next;
+	if (!p->free) lp->func_pool_free = p->next_free;
+	if (!p->used++) lp->pools_empty--;
 	n->hold = 1;
-	n->prev = p->tail;
-	p->tail->next = n;
-	p->head = n->next;
-	p->head->prev = 0;
-	p->tail = n;
 	n->next = 0;
+	lp->gc_count++;
 	return n;
 }
 
 void lp_fnc_free(LP, _lp_fnc* fnc)
 {
-	struct LpFunPool *p = (struct LpFunPool *)fnc->pool;
+	struct LpFunPool *p = (struct LpFunPool *)lp_pool_of(fnc);
 	fnc->hold = 0;
-	if (fnc->prev)
+	if (!p->free)
 	{
-		fnc->prev->next = fnc->next;
-		p->head->prev = fnc;
-	}
-	else {
-		return;
+		p->next_free = lp->func_pool_free;
+		lp->func_pool_free = p;
 	}
-	if (fnc->next)
-	{
-		fnc->next->prev = fnc->prev;
-	}
-	else {
-		p->tail = fnc->prev;
-	}
-	fnc->prev = 0;
-	fnc->next = p->head;
-	p->head = fnc;
-}
\ No newline at end of file
+	fnc->next = p->free;
+	p->free = fnc;
+	if (!--p->used) lp->pools_empty++;
+}
@@ -12,9 +12,11 @@
 #include <stdarg.h>
 #include <math.h>
 #include <time.h>
+#include <stdint.h>
+#include <limits.h>
 
 #ifdef __GNUC__
-#define lp_inline __inline__
+#define lp_inline static __inline__
 #endif
 
 #ifdef _MSC_VER
@@ -25,24 +27,16 @@
 #error "Unsuported compiler"
 #endif
 
-/*  #define lp_malloc(x) calloc((x),1)
-    #define lp_realloc(x,y) realloc(x,y)
-    #define lp_free(x) free(x) */
-
-/* #include <gc/gc.h>
-   #define lp_malloc(x) GC_MALLOC(x)
-   #define lp_realloc(x,y) GC_REALLOC(x,y)
-   #define lp_free(x)*/
-
 enum {
     LP_NONE, LP_INT, LP_DOUBLE, LP_STRING,LP_DICT,
-    LP_LIST,LP_FNC,LP_DATA,
+    LP_LIST,LP_FNC,LP_DATA,LP_RANGE,
 };
 
 typedef struct lp_string_ {
     struct _lp_string *info;
     char const *val;
     int len;
+    int hash; /* 0 until lp_hash has computed it */
 } lp_string_;
 typedef struct lp_dict_ {
     struct _lp_dict *val;
@@ -58,6 +52,12 @@ typedef struct lp_data_ {
     void *val;
     int magic;
 } lp_data_;
+typedef struct lp_range_ {
+    int start;
+    int stop;
+    int step;
+    int len;
+} lp_range_;
 
 struct _lp_list;
 
@@ -82,14 +82,22 @@ struct _lp_list;
  * data - LP_DATA
  * data.val - The user-provided data pointer.
  * data.magic - The user-provided magic number for identifying the data type.
+ * range - LP_RANGE, the lazy result of range()
+ * range.start, range.stop, range.step - The arguments range() was called with.
+ * range.len - The number of items.
+ *
+ * next - Links the slot into its pool's free list while it is not in use.
+ *
+ * Integers, None and (on 64-bit hosts) most doubles are not allocated at all,
+ * they are encoded directly in the lp_obj pointer. Never read type, integer or
+ * doublen from a value directly, use <lp_typeof>, <lp_integer> and
+ * <lp_doublen> instead.
  */
 typedef struct lp_obj {
     int type;
 	int ref;
-	struct lp_obj* prev;
-	struct lp_obj* next;
-	void* pool;
 	union {
+		struct lp_obj* next;
 		int integer;
 		double doublen;
 		lp_string_ string;
@@ -97,20 +105,96 @@ typedef struct lp_obj {
 		lp_dict_ dict;
 		lp_fnc_ fnc;
 		lp_data_ data;
+		lp_range_ range;
 	};
 } lp_obj;
 
+/* Immediate values
+ *
+ * Pool objects are at least 4-byte aligned, so the low two bits of a real
+ * lp_obj pointer are always zero. The other bit patterns are immediates:
+ *
+ * ...xx1 - integer, the value is stored in the remaining bits.
+ * ...x10 - None (the value 2 exactly) or, on 64-bit hosts, a "flonum": a
+ *          double whose exponent fits in the remaining bits. Doubles outside
+ *          that range (and all doubles on 32-bit hosts) are still boxed.
+ *
+ * Immediates are not reference counted; LP_OBJ_INC and lp_obj_dec ignore them.
+ */
+#if UINTPTR_MAX > 0xffffffffu
+#define LP_FLONUM 1
+#endif
+
+#define LP_IMM_NONE ((lp_obj*)(uintptr_t)2)
+#define lp_is_ptr(v) (!((uintptr_t)(v) & 3))
+#define lp_is_fixnum(v) ((uintptr_t)(v) & 1)
+#define lp_is_flonum(v) (((uintptr_t)(v) & 3) == 2 && (v) != LP_IMM_NONE)
+#define lp_fixnum(n) ((lp_obj*)(((uintptr_t)(intptr_t)(n) << 1) | 1))
+#define lp_fixnum_val(v) ((int)((intptr_t)(v) >> 1))
+#define lp_fixnum_fits(n) ((intptr_t)(n) >= -(INTPTR_MAX >> 1) - 1 && (intptr_t)(n) <= (INTPTR_MAX >> 1))
+
+#ifdef LP_FLONUM
+#define LP_FLONUM_ZERO ((lp_obj*)(uintptr_t)0x8000000000000002ull)
+
+lp_inline lp_obj* lp_flonum(double d) {
+    union { double d; uint64_t v; } t;
+    int bits;
+    t.d = d;
+    bits = (int)((t.v >> 60) & 7);
+    /* 2.0 would encode to LP_IMM_NONE, leave it boxed */
+    if (t.v != 0x3000000000000000ull && t.v != 0x4000000000000000ull && !((bits-3) & ~1)) {
+        return (lp_obj*)(uintptr_t)((((t.v << 3) | (t.v >> 61)) & ~(uint64_t)1) | 2);
+    }
+    if (t.v == 0) { return LP_FLONUM_ZERO; }
+    return 0;
+}
+
+lp_inline double lp_flonum_val(lp_obj* v) {
+    union { double d; uint64_t v; } t;
+    uint64_t b;
+    if (v == LP_FLONUM_ZERO) { return 0.0; }
+    b = (uint64_t)(uintptr_t)v;
+    b = (2 - (b >> 63)) | (b & ~(uint64_t)3);
+    t.v = (b >> 3) | (b << 61);
+    return t.d;
+}
+#endif
+
+/* Function: lp_typeof
+ * Returns the type (LP_INT, LP_STRING, ...) of any value, immediate or not.
+ */
+lp_inline int lp_typeof(lp_obj* v) {
+    uintptr_t b = (uintptr_t)v & 3;
+    if (!b) { return v->type; }
+    if (b & 1) { return LP_INT; }
+    return v == LP_IMM_NONE ? LP_NONE : LP_DOUBLE;
+}
+
+/* Function: lp_integer
+ * Returns the value of an LP_INT object.
+ */
+lp_inline int lp_integer(lp_obj* v) {
+    return lp_is_fixnum(v) ? lp_fixnum_val(v) : v->integer;
+}
+
+/* Function: lp_doublen
+ * Returns the value of an LP_DOUBLE object.
+ */
+lp_inline double lp_doublen(lp_obj* v) {
+#ifdef LP_FLONUM
+    if (lp_is_flonum(v)) { return lp_flonum_val(v); }
+#endif
+    return v->doublen;
+}
+
 typedef struct _lp_string {
     int ref;
     int len;
 	void *pool;
-	int index;
     char s[];
 } _lp_string;
 typedef struct _lp_list {
-	struct _lp_list *prev;
 	struct _lp_list *next;
-	void *pool;
 	lp_obj **items;
 	int hold;
 	int len;
@@ -124,28 +208,45 @@ typedef struct lp_item {
     lp_obj* key;
     lp_obj* val;
 } lp_item;
+/* Type: lp_shape
+ * The string keys an object got, in the order it got them.
+ *
+ * Objects that were given the same keys in the same order share a shape, so
+ * the caches of the VM can find a key by its position in their entries.
+ * Shapes form a tree from lp->shape_root, each child adding one key, which
+ * is an interned string and only compared by identity. They live as long as
+ * the VM, see _lp_shape_add, or as long as the arena their key was made in.
+ */
+typedef struct lp_shape {
+	struct lp_shape *parent;
+	struct lp_shape *child;
+	struct lp_shape *sibling;
+	struct lp_shape *all;
+	lp_obj* key;
+	int len;
+} lp_shape;
 typedef struct _lp_dict {
-	struct _lp_dict *prev;
 	struct _lp_dict *next;
-	void *pool;
     lp_item *items;
     int len;
     int alloc;
-    int cur;
     int mask;
     int used;
 	int hold;
+	int is_meta; /* some object has it as meta, see lp->meta_version */
     lp_obj* meta;
 	void *item_pool;
 	int item_index;
+	int asize; /* the first asize entries have the keys 0 to asize-1 */
+	uint64_t version;
+	lp_shape *shape; /* 0 unless it is an object without deleted keys */
 } _lp_dict;
 typedef struct _lp_fnc {
-	struct _lp_fnc *prev;
 	struct _lp_fnc *next;
-	void *pool;
     lp_obj* self;
     lp_obj* globals;
     lp_obj* code;
+    lp_obj* consts;
 	int hold;
 } _lp_fnc;
 
@@ -166,82 +267,155 @@ typedef struct lp_frame_ {
     lp_obj **ret_dest;
     lp_obj* fname;
     lp_obj* name;
-    lp_obj* line;
     lp_obj* globals;
-    int lineno;
+    lp_obj* consts;
     int cregs;
 } lp_frame_;
 
 #define LP_GCMAX 4096
+#define LP_FREE_SLICE 1024
+#define LP_POOL_SPARE 8
+/* bytes held back from the allocator for when it runs out, see mem_get */
+#define LP_MEM_RESERVE (4 * LP_POOL_BYTES)
+/* reference count of objects that live as long as the VM; no amount of
+ * stray LP_OBJ_INC or LP_OBJ_DEC takes it to 0 or past INT_MAX */
+#define LP_IMMORTAL (INT_MAX / 2)
+/* reference count of a long-lived object that died while an arena is open,
+ * see lp_arena_begin */
+#define LP_ARENA_DEAD (-1)
+/* longest name lp_string and the constants of compiled code intern */
+#define LP_INTERN_MAX 32
+/* objects with more keys go without a shape, and no more shapes are made
+ * once a VM has LP_SHAPES */
+#define LP_SHAPE_KEYS 32
+#define LP_SHAPES 4096
 #define LP_FRAMES 256
 #define LP_REGS_EXTRA 2
 /* #define LP_REGS_PER_FRAME 256*/
 #define LP_REGS 16384
 
-#define OBJ_SIZE 1024
-#define DICT_SIZE 128
-#define LIST_SIZE 128
-#define FUNC_SIZE 128
+/* Fixed size pools. The free slots of a pool are linked through their next
+ * field, and the pools that have a free slot are linked through next_free
+ * from lp->*_pool_free, so neither allocating nor releasing a slot has to
+ * search. The next field of a pool links all pools of its kind.
+ *
+ * A pool takes LP_POOL_BYTES and is aligned to that size, so the pool of a
+ * slot is found from the slot's address with lp_pool_of. LP_POOL_HEADER
+ * is room for the fields in front of the slots of any pool. */
+
+#define LP_POOL_BYTES 65536
+#define LP_POOL_HEADER 32
+#define LP_POOL_SLOTS(t) ((LP_POOL_BYTES - LP_POOL_HEADER) / sizeof(t))
+#define lp_pool_of(p) ((void*)((uintptr_t)(p) & ~(uintptr_t)(LP_POOL_BYTES - 1)))
+
+#define OBJ_SIZE LP_POOL_SLOTS(lp_obj)
+#define DICT_SIZE LP_POOL_SLOTS(_lp_dict)
+#define LIST_SIZE LP_POOL_SLOTS(_lp_list)
+#define FUNC_SIZE LP_POOL_SLOTS(_lp_fnc)
 
 struct LpObjPool
 {
-	lp_obj obj[OBJ_SIZE];
-	lp_obj *head;
-	lp_obj *tail;
+	lp_obj *free;
+	int used;
+	/* index of obj[0] in the collector's scratch array, -1 while the pool
+	 * is kept out of an arena */
+	int gc_base;
 	struct LpObjPool* next;
+	struct LpObjPool* next_free;
+	lp_obj obj[OBJ_SIZE];
 };
 
-struct LpStringPool
-{
-	int *bit_map;
-	int total_size;
-	struct LpStringPool* next;
-	int not_used;
-	char mem[];
-};
+/* Variable size blocks (string data, dict items and list items) come from
+ * slabs, one size class per slab. Like the pools above, the free blocks of a
+ * slab are linked through their first word and the slabs with a free block
+ * are linked through next_free from lp->slab_free[cls]. Slabs are mapped
+ * like pools. A block bigger than the largest class gets a malloc'd slab of
+ * its own, of class LP_SLAB_CLASSES, on lp->slab_large, which is linked both
+ * ways (next_free is the previous one) so that it can be freed at once, and
+ * whose used is its size in bytes. arena is lp->arena at the time the slab
+ * was made. */
 
-struct LpItemPool
-{
-	int *bit_map;
-	int total_size;
-	struct LpItemPool* next;
-	int not_used;
-	lp_item mem[];
-};
+#define LP_SLAB_CLASSES 16
+#define LP_SLAB_BYTES (LP_POOL_BYTES - LP_POOL_HEADER)
 
-struct LpObjArrayPool
+struct LpSlab
 {
-	int *bit_map;
-	int total_size;
-	struct LpObjArrayPool* next;
-	int not_used;
-	lp_obj* mem[];
+	struct LpSlab* next;
+	struct LpSlab* next_free;
+	void *free;
+	int used;
+	short cls;
+	short arena;
+	char mem[];
 };
 
 struct LpDictPool
 {
-	_lp_dict obj[DICT_SIZE];
-	_lp_dict *head;
-	_lp_dict *tail;
+	_lp_dict *free;
+	int used;
 	struct LpDictPool* next;
+	struct LpDictPool* next_free;
+	_lp_dict obj[DICT_SIZE];
 };
 
 struct LpListPool
 {
-	_lp_list obj[LIST_SIZE];
-	_lp_list *head;
-	_lp_list *tail;
+	_lp_list *free;
+	int used;
 	struct LpListPool* next;
+	struct LpListPool* next_free;
+	_lp_list obj[LIST_SIZE];
 };
 
 struct LpFunPool
 {
-	_lp_fnc obj[FUNC_SIZE];
-	_lp_fnc *head;
-	_lp_fnc *tail;
+	_lp_fnc *free;
+	int used;
 	struct LpFunPool* next;
+	struct LpFunPool* next_free;
+	_lp_fnc obj[FUNC_SIZE];
 };
 
+/* Type: lp_allocator
+ * Where a VM gets its memory from, see <lp_init_alloc>. <lp_init> uses
+ * lp_std_allocator, which is malloc and free and maps the pools.
+ *
+ * Fields:
+ * alloc - Returns size bytes, or 0 if there are none.
+ * release - Frees a block from alloc, size is the size it was asked with.
+ * pool_alloc - Returns LP_POOL_BYTES bytes aligned to LP_POOL_BYTES, or 0.
+ * pool_release - Frees a block from pool_alloc.
+ * ud - Passed to all of the above.
+ */
+typedef struct lp_allocator {
+	void *(*alloc)(void *ud, size_t size);
+	void (*release)(void *ud, void *p, size_t size);
+	void *(*pool_alloc)(void *ud);
+	void (*pool_release)(void *ud, void *p);
+	void *ud;
+} lp_allocator;
+
+extern const lp_allocator lp_std_allocator;
+
+/* Type: lp_heap
+ * The lists of pools and slabs of a VM, where lp_vm keeps those of the
+ * long-lived objects while an arena is open, see <lp_arena_begin>.
+ */
+typedef struct lp_heap {
+	struct LpObjPool *obj_pool;
+	struct LpDictPool *dict_pool;
+	struct LpListPool *list_pool;
+	struct LpFunPool *func_pool;
+	struct LpObjPool *obj_pool_free;
+	struct LpDictPool *dict_pool_free;
+	struct LpListPool *list_pool_free;
+	struct LpFunPool *func_pool_free;
+	struct LpSlab *slab[LP_SLAB_CLASSES];
+	struct LpSlab *slab_free[LP_SLAB_CLASSES];
+	struct LpSlab *slab_large;
+	int pools_empty;
+} lp_heap;
+
 /* Type: lp_vm
  * Representation of a tinypy virtual machine instance.
  * 
@@ -260,11 +434,24 @@ struct LpFunPool
  * frames - A list of all call frames.
  * cur - The index of the currently executing call frame.
  * frames[n].globals - A dictionary of global sybmols in callframe n.
+ * dict_version - Last version tag handed out to a dictionary.
+ * meta_version - Changes whenever a dictionary that is the meta of some
+ *                object changes, or a dictionary becomes one.
+ * shape_root - The shape of an object without keys, see <lp_shape>.
+ * hash_seed - Seeds the hash of strings, see <lp_hash>.
+ * list_methods, string_methods - Dictionaries of the unbound methods of lists
+ *                                 and strings, see <lp_get_method>.
+ * mem_used, mem_peak - Bytes the VM has from its allocator now, and at most
+ *                      so far. Pools count whole.
+ * mem_limit - See <lp_mem_limit>.
  */
 typedef struct lp_vm {
     lp_obj* builtins;
+    lp_obj* list_methods;
+    lp_obj* string_methods;
 	lp_obj* path;
     lp_obj* modules;
+    lp_obj* strings;
     lp_frame_ frames[LP_FRAMES];
     lp_obj* _params;
     lp_obj* params;
@@ -279,25 +466,63 @@ typedef struct lp_vm {
     char chars[256][2];
     int cur;
 	struct LpObjPool *obj_pool;
-	struct LpStringPool *string_pool;
-	struct LpItemPool *item_pool;
-	struct LpObjArrayPool *obj_array_pool;
 	struct LpDictPool *dict_pool;
 	struct LpListPool *list_pool;
 	struct LpFunPool *func_pool;
+	struct LpObjPool *obj_pool_free;
+	struct LpDictPool *dict_pool_free;
+	struct LpListPool *list_pool_free;
+	struct LpFunPool *func_pool_free;
+	struct LpSlab *slab[LP_SLAB_CLASSES];
+	struct LpSlab *slab_free[LP_SLAB_CLASSES];
+	struct LpSlab *slab_large;
+	int pools_empty;
+	/* non-zero while an arena is open, kept has the pools from before */
+	int arena;
+	lp_heap kept;
+	/* empty pools and slabs kept for reuse, see lp_pool_trim, and the
+	 * pools dropped by lp_arena_end, linked through their first word */
+	void *pool_cache;
+	uint64_t dict_version;
+	uint64_t meta_version;
+	lp_shape *shape_root;
+	lp_shape *shapes;
+	int shape_count;
+	uint64_t hash_seed;
+	/* cycle collector, see gc.c. gc_threshold is the number of containers
+	 * allocated between collections, 0 if only lp_collect collects */
+	int gc_threshold;
+	int gc_limit;
+	int gc_count;
+	/* containers waiting for lp_free_pending, free_credit is the number of
+	 * slots allocated meanwhile, which the next slice frees on top */
+	struct _lp_list *dead_lists;
+	struct _lp_dict *dead_dicts;
+	struct _lp_fnc *dead_fncs;
+	int dead_count;
+	int free_credit;
     int steps;
     /* sandbox */
     clock_t clocks;
     double time_elapsed;
     double time_limit;
+    /* memory, mem_gc is the mem_used at which a collection is due */
+    lp_allocator mem;
     unsigned long mem_limit;
     unsigned long mem_used;
-    int mem_exceeded;
+    unsigned long mem_peak;
+    unsigned long mem_gc;
+    lp_obj* mem_error;
+    void* mem_reserve;
+    /* non-zero while no block may be refused, see mem_get */
+    int mem_must;
+    /* the one character strings, see lp_string_char */
+    lp_obj* char_strings[256];
 } lp_vm;
 
 #define LP lp_vm *lp
 
-#define LP_OBJ_INC(obj) if(obj) {(obj)->ref++;}
+#define LP_OBJ_INC(obj) if((obj) && lp_is_ptr(obj)) {(obj)->ref++;}
 #define LP_OBJ_DEC(obj) lp_obj_dec(lp, obj)
 #define RETURN_LP_OBJ(obj) do { LP_OBJ_INC(obj)return obj; } while(0);
 #define RETURN_LP_NONE do { LP_OBJ_INC(lp->lp_None)return lp->lp_None; } while(0);
@@ -305,6 +530,14 @@ typedef struct lp_vm {
 /* lp */
 lp_obj* lp_obj_new(LP, int type);
 void lp_obj_dec(LP, lp_obj* obj);
+int lp_free_pending(LP, int budget);
+void lp_pool_trim(LP);
+void lp_arena_begin(LP);
+void lp_arena_end(LP);
+void* lp_malloc(LP, size_t size);
+void* lp_realloc(LP, void* p, size_t osize, size_t size);
+void lp_free(LP, void* p, size_t size);
+void lp_mem_limit(LP, unsigned long limit);
 lp_obj* lp_none(LP);
 
 lp_item* lp_item_malloc(LP, int count, void** item_pool, int* item_index);
@@ -321,7 +554,11 @@ _lp_fnc* lp_fnc_malloc(LP);
 void lp_fnc_free(LP, _lp_fnc* fnc);
 void lp_print_object_pool(LP);
 
+/* gc */
+int lp_collect(LP);
+
 /* builtins */
+int lp_lookup_(LP, lp_obj* self, lp_obj* k, lp_obj **meta, int depth);
 int lp_lookup(LP, lp_obj* self, lp_obj* k, lp_obj **meta);
 int lp_lookupx(LP, lp_obj* self, const char* k, lp_obj **meta);
 lp_obj* lp_object(LP);
@@ -347,8 +584,10 @@ lp_obj* lp_tcall(LP, lp_obj* fnc);
 lp_obj* lp_def(LP, lp_obj* code, lp_obj* g);
 lp_obj* lp_fnc_new(LP, int t, void *v, lp_obj* c, lp_obj* s, lp_obj* g);
 lp_obj* lp_fnc(LP, lp_obj* v(LP));
+lp_obj* lp_vfnc(LP, lp_obj* v(LP, int argc, lp_obj **argv));
 lp_obj* lp_method(LP, lp_obj* self, lp_obj* v(LP));
 lp_obj* lp_data(LP, int magic, void *v);
+lp_obj* lp_range(LP, int start, int stop, int step);
 lp_obj* lp_params(LP);
 void lp_params_n(LP, int n, lp_obj* argv[]);
 void lp_params_v(LP, int n, ...);
@@ -361,6 +600,7 @@ lp_obj* lp_has(LP, lp_obj* self, lp_obj* k);
 void lp_del(LP, lp_obj* self, lp_obj* k);
 lp_obj* lp_iter(LP, lp_obj* self, lp_obj* k);
 lp_obj* lp_get(LP, lp_obj* self, lp_obj* k);
+lp_obj* lp_get_method(LP, lp_obj* self, lp_obj* k, lp_obj** s);
 lp_obj* lp_getk(LP, lp_obj* self, lp_obj* k);
 int lp_iget(LP, lp_obj **r, lp_obj* self, lp_obj* k);
 int lp_igetk(LP, lp_obj **r, lp_obj* self, lp_obj* k);
@@ -386,6 +626,8 @@ lp_obj* lp_lsh(LP, lp_obj* _a, lp_obj* _b);
 lp_obj* lp_rsh(LP, lp_obj* _a, lp_obj* _b);
 
 /* string */
+lp_obj* lp_intern(LP, char const *v, int n);
+int lp_is_name(char const *v, int n);
 lp_obj* lp_string_t(LP, int n);
 lp_obj* lp_string_copy(LP, const char *s, int n);
 lp_obj* lp_string_sub(LP, lp_obj* s, int a, int b);
@@ -395,6 +637,7 @@ lp_obj* lp_printf(LP, char const *fmt, ...);
 void lp_deinit(LP);
 void lp_frame(LP, lp_obj* globals, lp_obj* code, lp_obj **ret_dest);
 void lp_print_stack(LP);
+int lp_lineno(LP, lp_frame_ *f);
 lp_obj* lp_call(LP, lp_obj* self);
 void lp_return(LP, lp_obj* v);
 lp_obj* lp_ez_call(LP, const char *mod, const char *fnc);
@@ -406,6 +649,7 @@ void lp_args(LP, int argc, char *argv[]);
 lp_obj* lp_main(LP, char *fname, void *code, int len);
 lp_obj* lp_eval(LP, const char *text, lp_obj* globals);
 lp_vm *lp_init(int argc, char *argv[]);
+lp_vm *lp_init_alloc(int argc, char *argv[], const lp_allocator* mem);
 lp_obj* lp_disasm(LP, lp_obj* code);
 
 
@@ -424,9 +668,10 @@ lp_obj* lp_disasm(LP, lp_obj* code);
     return r; \
 }
 */
+/* v is 0 when there was no memory for it, the MemoryError is kept then */
 #define lp_raise(r,v) { \
-	lp_obj_dec(lp, lp->ex); \
-    lp->ex = v; \
+	lp_obj* lp_raise_v = (v); \
+	if (lp_raise_v) { lp_obj_dec(lp, lp->ex); lp->ex = lp_raise_v; } \
     return r; \
 }
 
@@ -440,12 +685,15 @@ lp_obj* lp_disasm(LP, lp_obj* code);
  * it does not go out of scope, and don't de-allocate it. Also be aware that
  * tinypy will not delete the string for you. In many cases, it is best to
  * use <lp_string_t> or <lp_string_slice> to create a string where tinypy
- * manages storage for you.
+ * manages storage for you. Names up to LP_INTERN_MAX bytes are interned
+ * instead, see <lp_intern>, and do not refer to v at all.
  */
 lp_inline lp_obj* lp_string(LP, char const *v) {
-    lp_obj* val = lp_obj_new(lp, LP_STRING);
-    lp_string_ s = {0, v, 0};
+    lp_obj* val;
+    lp_string_ s = {0, v, 0, 0};
     s.len = strlen(v);
+    if (s.len <= LP_INTERN_MAX && lp_is_name(v, s.len)) { return lp_intern(lp, v, s.len); }
+    val = lp_obj_new(lp, LP_STRING);
     val->string = s;
     return val;
 }
@@ -456,7 +704,7 @@ lp_obj* lp_string_copy(LP, const char *s, int n);
 #define LP_CSTR_LEN 256
 
 lp_inline void lp_cstr(LP,lp_obj* v, char *s, int l) {
-    if (v->type != LP_STRING) { 
+    if (lp_typeof(v) != LP_STRING) { 
         lp_raise(,lp_string(lp, "(lp_cstr) TypeError: value not a string"));
     }
     if (v->string.len >= l) {
@@ -469,26 +717,28 @@ lp_inline void lp_cstr(LP,lp_obj* v, char *s, int l) {
 
 #define LP_OBJ(n) (_lp_list_iget(lp,lp->params->list,n))
 lp_inline lp_obj* lp_type(LP,int t,lp_obj* v) {
-    if (v->type != t) { lp_raise(0,lp_string(lp, "(lp_type) TypeError: unexpected type")); }
+    if (lp_typeof(v) != t) { lp_raise(0,lp_string(lp, "(lp_type) TypeError: unexpected type")); }
     return v;
 }
 
 lp_inline int lp_is_number(lp_obj* v) {
-	return v->type == LP_INT || v->type == LP_DOUBLE;
+	int type = lp_typeof(v);
+	return type == LP_INT || type == LP_DOUBLE;
 }
 
 lp_inline double lp_type_number(LP, lp_obj* v) {
 	double n;
-	if (v->type != LP_INT && v->type != LP_DOUBLE) { lp_raise(0, lp_string(lp, "(lp_type) TypeError: unexpected type")); }
-	if (v->type == LP_INT) n = v->integer;
-	else n = v->doublen;
+	int type = lp_typeof(v);
+	if (type != LP_INT && type != LP_DOUBLE) { lp_raise(0, lp_string(lp, "(lp_type) TypeError: unexpected type")); }
+	if (type == LP_INT) n = lp_integer(v);
+	else n = lp_doublen(v);
 	return n;
 }
 
 #define LP_NO_LIMIT 0
 #define LP_TYPE(n,t) lp_type(lp,t,LP_OBJ(n))
 #define LP_NUM(n) (lp_type_number(lp,LP_OBJ(n)))
-#define LP_INTEGER(n) (LP_TYPE(n,LP_INT)->integer)
+#define LP_INTEGER(n) (lp_integer(LP_TYPE(n,LP_INT)))
 /* #define LP_STR() (LP_CSTR(LP_TYPE(LP_STRING))) */
 #define LP_STR(n) (LP_TYPE(n,LP_STRING))
 #define LP_INTEGER_DEFAULT(n,d) (n<lp->params->list->len?lp_type_number(lp,LP_OBJ(n)):(d))
@@ -518,6 +768,31 @@ lp_inline double lp_type_number(LP, lp_obj* v) {
 #define LP_END \
     }
 
+/* Macro: LP_ARGS
+ * Parameter list of a vector call C function.
+ *
+ * A C function wrapped with <lp_vfnc> gets its arguments as an array instead
+ * of through lp->params, and the VM calls it straight from the caller's
+ * registers. Use the LP_ARG macros, which work like their LP_OBJ
+ * counterparts, to read them:
+ *
+ * > lp_obj *my_func(LP, LP_ARGS)
+ * > {
+ * >     double x = LP_ARG_NUM(0);
+ * >     int i; for (i=1; i<argc; i++) { ... argv[i] ... }
+ * > }
+ *
+ * The arguments are borrowed, INC any of them you return or keep.
+ */
+#define LP_ARGS int argc, lp_obj **argv
+#define LP_ARG(n) ((n)<argc?argv[n]:lp->lp_None)
+#define LP_ARG_TYPE(n,t) lp_type(lp,t,LP_ARG(n))
+#define LP_ARG_NUM(n) (lp_type_number(lp,LP_ARG(n)))
+#define LP_ARG_INTEGER(n) (lp_integer(LP_ARG_TYPE(n,LP_INT)))
+#define LP_ARG_STR(n) (LP_ARG_TYPE(n,LP_STRING))
+#define LP_ARG_INTEGER_DEFAULT(n,d) ((n)<argc?lp_type_number(lp,argv[n]):(d))
+#define LP_ARG_DEFAULT(n,o) ((n)<argc?argv[n]:(o))
+
 lp_obj* _lp_list_get(LP,_lp_list *self,int k,const char *error);
 
 lp_inline int _lp_min(int a, int b) { return (a<b?a:b); }
@@ -526,19 +801,36 @@ lp_inline int _lp_sign(double v) { return (v<0?-1:(v>0?1:0)); }
 
 /* Function: lp_number
  * Creates a new numeric object.
+ *
+ * Integers (and doubles, where the host allows it) come back as immediates,
+ * only values that do not fit are allocated from the object pool.
  */
 lp_inline lp_obj* lp_number_from_double(LP, double v) {
-    lp_obj* val = lp_obj_new(lp, LP_DOUBLE);
+    lp_obj* val;
+#ifdef LP_FLONUM
+    val = lp_flonum(v);
+    if (val) { return val; }
+#endif
+    val = lp_obj_new(lp, LP_DOUBLE);
     val->doublen = v;
     return val;
 }
 
 lp_inline lp_obj* lp_number_from_int(LP, int v) {
-	lp_obj* val = lp_obj_new(lp, LP_INT);
+	lp_obj* val;
+	if (lp_fixnum_fits(v)) { return lp_fixnum(v); }
+	val = lp_obj_new(lp, LP_INT);
 	val->integer = v;
 	return val;
 }
 
+/* int arithmetic is done in long long, results that leave the int range
+ * become doubles instead of wrapping around */
+lp_inline lp_obj* lp_number_from_llong(LP, long long v) {
+	if (v < INT_MIN || v > INT_MAX) { return lp_number_from_double(lp, (double)v); }
+	return lp_number_from_int(lp, (int)v);
+}
+
 lp_inline void lp_echo(LP,lp_obj* e) {
     e = lp_str(lp,e);
     fwrite(e->string.val,1,e->string.len,stdout);
@@ -553,11 +845,23 @@ lp_inline void lp_echo(LP,lp_obj* e) {
  */
 lp_inline lp_obj* lp_string_n(LP, char const *v,int n) {
     lp_obj* val = lp_obj_new(lp, LP_STRING);
-    lp_string_ s = {0,v,n};
+    lp_string_ s = {0,v,n,0};
     val->string = s;
     return val;
 }
 
+/* Function: lp_string_char
+ * Returns the one character string of c.
+ *
+ * These are made once per VM and are immortal, so indexing into or
+ * iterating over a string does not allocate.
+ */
+lp_inline lp_obj* lp_string_char(LP, unsigned char c) {
+    lp_obj* r = lp->char_strings[c];
+    r->ref++;
+    return r;
+}
+
 
 
 const char* compile(const char* fname, char* code, int* size, int *res);
@@ -10,33 +10,33 @@
     }
 
 
-lp_obj* lpf_print(LP);
-lp_obj* lpf_bind(LP);
-lp_obj* lpf_min(LP);
-lp_obj* lpf_max(LP);
-lp_obj* lpf_copy(LP);
-lp_obj* lpf_len(LP);
-lp_obj* lpf_assert(LP);
-lp_obj* lpf_range(LP);
-lp_obj* lpf_system(LP);
-lp_obj* lpf_istype(LP);
-lp_obj* lpf_float(LP);
-lp_obj* lpf_save(LP);
-lp_obj* lpf_load(LP);
-lp_obj* lpf_fpack(LP);
-lp_obj* lpf_abs(LP);
-lp_obj* lpf_int(LP);
-lp_obj* lpf_round(LP);
-lp_obj* lpf_exists(LP);
-lp_obj* lpf_mtime(LP);
-lp_obj* lpf_setmeta(LP);
-lp_obj* lpf_getmeta(LP);
+lp_obj* lpf_print(LP, LP_ARGS);
+lp_obj* lpf_bind(LP, LP_ARGS);
+lp_obj* lpf_min(LP, LP_ARGS);
+lp_obj* lpf_max(LP, LP_ARGS);
+lp_obj* lpf_copy(LP, LP_ARGS);
+lp_obj* lpf_len(LP, LP_ARGS);
+lp_obj* lpf_assert(LP, LP_ARGS);
+lp_obj* lpf_range(LP, LP_ARGS);
+lp_obj* lpf_system(LP, LP_ARGS);
+lp_obj* lpf_istype(LP, LP_ARGS);
+lp_obj* lpf_float(LP, LP_ARGS);
+lp_obj* lpf_save(LP, LP_ARGS);
+lp_obj* lpf_load(LP, LP_ARGS);
+lp_obj* lpf_fpack(LP, LP_ARGS);
+lp_obj* lpf_abs(LP, LP_ARGS);
+lp_obj* lpf_int(LP, LP_ARGS);
+lp_obj* lpf_round(LP, LP_ARGS);
+lp_obj* lpf_exists(LP, LP_ARGS);
+lp_obj* lpf_mtime(LP, LP_ARGS);
+lp_obj* lpf_setmeta(LP, LP_ARGS);
+lp_obj* lpf_getmeta(LP, LP_ARGS);
 lp_obj* lpf_object(LP);
 lp_obj* lpf_object_new(LP);
 lp_obj* lpf_object_call(LP);
-lp_obj* lpf_getraw(LP);
+lp_obj* lpf_getraw(LP, LP_ARGS);
 lp_obj* lpf_class(LP);
-lp_obj* lpf_builtins_bool(LP);
+lp_obj* lpf_builtins_bool(LP, LP_ARGS);
 
 
 /* list */
@@ -49,39 +49,60 @@ void _lp_list_appendx(LP,_lp_list *self, lp_obj* v);
 void _lp_list_set(LP,_lp_list *self,int k, lp_obj* v, const char *error);
 int _lp_list_find(LP,_lp_list *self, lp_obj* v);
 void _lp_list_insert(LP,_lp_list *self, int n, lp_obj* v);
-lp_obj* lpf_index(LP);
-lp_obj* lpf_append(LP);
-lp_obj* lpf_pop(LP);
-lp_obj* lpf_insert(LP);
-lp_obj* lpf_extend(LP);
-lp_obj* lpf_sort(LP);
+lp_obj* lpf_index(LP, LP_ARGS);
+lp_obj* lpf_append(LP, LP_ARGS);
+lp_obj* lpf_pop(LP, LP_ARGS);
+lp_obj* lpf_insert(LP, LP_ARGS);
+lp_obj* lpf_extend(LP, LP_ARGS);
+lp_obj* lpf_sort(LP, LP_ARGS);
 
 /* dict */
+int _lua_hash(void const *v,int l);
+uint64_t _lp_wyhash(const void *key, int len, uint64_t seed);
 void _lp_dict_free(LP, _lp_dict *self);
 void _lp_dict_set(LP,_lp_dict *self,lp_obj* k, lp_obj* v);
 lp_obj* _lp_dict_get(LP,_lp_dict *self,lp_obj* k, const char *error);
 int _lp_dict_find(LP,_lp_dict *self,lp_obj* k);
-int _lp_dict_next(LP,_lp_dict *self);
+int _lp_dict_hash_find(LP,_lp_dict *self, int hash, lp_obj* k);
+int _lp_dict_next(_lp_dict *self, int i);
+int _lp_dict_nth(_lp_dict *self, int k);
+int _lp_dict_probes(_lp_dict *self);
+void _lp_dict_merge(LP,_lp_dict *self,_lp_dict *src);
 void _lp_dict_del(LP,_lp_dict *self,lp_obj* k, const char *error);
+void _lp_dict_clear(LP,_lp_dict *self);
+int _lp_dict_lp_realloc(LP,_lp_dict *self,int len);
+/* gives d a new version, and the metas of objects a new lp->meta_version */
+#define LP_DICT_CHANGED(lp,d) { \
+    (d)->version = ++(lp)->dict_version; \
+    if ((d)->is_meta) { (lp)->meta_version++; } }
+void _lp_shape_init(LP);
+void _lp_shape_deinit(LP);
+lp_shape* _lp_shape_add(LP, lp_shape *s, lp_obj* k);
 lp_obj* lpf_merge(LP);
+/* kinds of dict views, the magic of their data objects */
+enum { LP_VIEW_KEYS = 1, LP_VIEW_VALUES, LP_VIEW_ITEMS };
+int _lp_dict_view(lp_obj* v);
+lp_obj* _lp_dict_view_item(LP, int kind, lp_item *t, lp_obj* reuse);
+lp_obj* lpf_keys(LP, LP_ARGS);
+lp_obj* lpf_values(LP, LP_ARGS);
+lp_obj* lpf_items(LP, LP_ARGS);
 
 /* string */
 int _lp_str_index(lp_obj* s, int i, lp_obj* k);
 int _lp_str_cmp(lp_obj* s, const char* k);
-lp_obj* lpf_join(LP);
-lp_obj* lpf_split(LP);
-lp_obj* lpf_find(LP);
-lp_obj* lpf_str_index(LP);
+lp_obj* lpf_join(LP, LP_ARGS);
+lp_obj* lpf_split(LP, LP_ARGS);
+lp_obj* lpf_find(LP, LP_ARGS);
+lp_obj* lpf_str_index(LP, LP_ARGS);
 lp_obj* lpf_str2(LP);
 lp_obj* lpf_chr(LP);
 lp_obj* lpf_ord(LP);
-lp_obj* lpf_strip(LP);
-lp_obj* lpf_replace(LP);
+lp_obj* lpf_strip(LP, LP_ARGS);
+lp_obj* lpf_replace(LP, LP_ARGS);
 
 /* gc */
-void lp_grey(LP, lp_obj* v);
 void lp_gc_init(LP);
-void lp_delete(LP,lp_obj* v);
-void lp_full(LP);
-void lp_gc_deinit(LP);
-lp_obj* lp_track(LP, lp_obj* v);
+void lp_gc_step(LP);
+void lp_mem_reserve(LP);
+#define LP_GC_CHECK(lp) if ((lp)->dead_count || (lp)->gc_count >= (lp)->gc_limit || \
+	(lp)->pools_empty > 2 * LP_POOL_SPARE) { lp_gc_step(lp); }
@@ -51,8 +51,8 @@ int main(int argc, char *argv[]) {
 	}
 	c = lp_string_copy(lp, rc, size);
 	free(rc);
-    r = lp_exec(lp, c, g);
-	if (!r) lp_print_stack(lp);
+    r = c ? lp_exec(lp, c, g) : 0;
+	if (!r) { lp_print_stack(lp); result = 0; }
 	else LP_OBJ_DEC(r);
 	//c = lp_disasm(lp, c);
 	//printf(c->string.val);
@@ -61,7 +61,7 @@ int main(int argc, char *argv[]) {
     lp_deinit(lp);
 	printf("%s\n", "lp quit...");
 	getchar();
-    return(0);
+    return(result ? 0 : 1);
 }
 
 /**/
@@ -1,5 +1,15 @@
 #pragma once
 
+struct CompileState;
+struct Token;
+struct TList;
+struct IntList;
+struct IntListItem;
+struct StrList;
+struct StrListItem;
+struct Item;
+struct ItemList;
+
 const char* get_compile_error(struct CompileState *c);
 void clear_compile_mem(struct CompileState *c);
 
@@ -12,6 +12,10 @@ lp_obj* lp_tcall(LP,lp_obj* fnc) {
     if (fnc->fnc.ftype&2) {
         _lp_list_insert(lp,lp->params->list,0,fnc->fnc.info->self);
     }
+    if (fnc->fnc.ftype&4) {
+        return ((lp_obj *(*)(lp_vm *,int,lp_obj **))fnc->fnc.cfnc)(lp,
+            lp->params->list->len,lp->params->list->items);
+    }
     return _lp_dcall(lp,(lp_obj *(*)(lp_vm *))fnc->fnc.cfnc);
 }
 
@@ -21,6 +25,7 @@ lp_obj* lp_fnc_new(LP,int t, void *v, lp_obj* c,lp_obj* s, lp_obj* g) {
     info->code = c;
     info->self = s;
     info->globals = g;
+    info->consts = 0;
 	LP_OBJ_INC(c);
 	LP_OBJ_INC(s);
 	LP_OBJ_INC(g);
@@ -45,6 +50,16 @@ lp_obj* lp_fnc(LP,lp_obj* v(LP)) {
     return lp_fnc_new(lp,0,v,lp->lp_None,lp->lp_None,lp->lp_None);
 }
 
+/* Function: lp_vfnc
+ * Creates a new tinypy function object for a vector call C function.
+ *
+ * Like <lp_fnc>, but the C function takes its arguments as an array, see
+ * <LP_ARGS>. Calls from the VM do not go through lp->params at all.
+ */
+lp_obj* lp_vfnc(LP,lp_obj* v(LP,LP_ARGS)) {
+    return lp_fnc_new(lp,4,v,lp->lp_None,lp->lp_None,lp->lp_None);
+}
+
 lp_obj* lp_method(LP,lp_obj* self,lp_obj* v(LP)) {
     return lp_fnc_new(lp,2,v,lp->lp_None,self,lp->lp_None);
 }
@@ -67,17 +82,17 @@ lp_obj* lp_method(LP,lp_obj* self,lp_obj* v(LP)) {
  * 
  * magic      - An integer number stored in the object.
  * val        - The data pointer of the object.
- * info->free - If not NULL, a callback function called when the object gets
+ * free_fun   - If not NULL, a callback function called when the object gets
  *              destroyed.
  * 
  * Example:
- * > void *__free__(LP, lp_obj self)
+ * > void __free__(LP, lp_obj self)
  * > {
  * >     free(self.data.val);
  * > }
  * >
- * > lp_obj my_obj = lp_data(LP, 0, my_ptr);
- * > my_obj.data.info->free = __free__;
+ * > lp_obj* my_obj = lp_data(LP, 0, my_ptr);
+ * > my_obj->data.free_fun = __free__;
  */
 lp_obj* lp_data(LP,int magic,void *v) {
     lp_obj* r = lp_obj_new(lp, LP_DATA);
@@ -87,6 +102,32 @@ lp_obj* lp_data(LP,int magic,void *v) {
     return r;
 }
 
+/* Function: lp_range
+ * Creates a new range object.
+ *
+ * The items are computed when they are asked for, so a range takes the same
+ * space whatever its length. A step of 0 gives an empty range. Raises
+ * OverflowError for a range of more than INT_MAX items.
+ */
+lp_obj* lp_range(LP, int start, int stop, int step) {
+    lp_obj* r;
+    long long n = 0;
+    if (step > 0 && start < stop) {
+        n = ((long long)stop - start + step - 1) / step;
+    } else if (step < 0 && start > stop) {
+        n = ((long long)start - stop - step - 1) / -(long long)step;
+    }
+    if (n > INT_MAX) {
+        lp_raise(0,lp_string(lp, "(lp_range) OverflowError: range has too many items"));
+    }
+    r = lp_obj_new(lp, LP_RANGE);
+    r->range.start = start;
+    r->range.stop = stop;
+    r->range.step = step;
+    r->range.len = (int)n;
+    return r;
+}
+
 /* Function: lp_params
  * Initialize the tinypy parameters.
  *
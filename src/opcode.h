@@ -13,8 +13,6 @@ enum OPCODE
 	OP_CMP,
 	OP_GET,
 	OP_SET,
-	OP_NUMBER,
-	OP_STRING,
 	OP_GGET,
 	OP_GSET,
 	OP_MOVE,
@@ -32,7 +30,6 @@ enum OPCODE
 	OP_LIST,
 	OP_NONE,
 	OP_LEN,
-	OP_POS,
 	OP_PARAMS,
 	OP_IGET,
 	OP_FILE,
@@ -51,4 +48,51 @@ enum OPCODE
 	OP_IFN,
 	OP_NOT,
 	OP_BITNOT,
+	OP_CONST,
+	OP_CONSTS,
+	OP_IFLT,
+	OP_IFLE,
+	OP_IFEQ,
+	OP_IFNE,
+	OP_LOADMETHOD,
+	OP_CALLMETHOD,
+	OP_GETATTR,
+	OP_SETATTR,
+};
+
+/* inline cache reserved after every OP_GGET, filled in by the vm: the
+ * versions of the globals and builtins dicts the value was looked up in.
+ * It takes up GCACHE_WORDS code words and is only 4-byte aligned there, so
+ * it is always copied in and out with memcpy */
+struct GCache
+{
+	unsigned long long gver;
+	unsigned long long bver;
+	void* val;
+};
+#define GCACHE_WORDS ((int)((sizeof(struct GCache) + 3) / 4))
+
+/* inline cache reserved after every OP_GETATTR, OP_SETATTR and
+ * OP_LOADMETHOD, filled in by the vm: the shape and meta of the object the
+ * key was looked up on, the meta_version then, and what was found: the
+ * entry n of the object, or for n -1 the value val of its class, for n -2
+ * the function val of its class that is bound to the object. Like the
+ * GCache it is copied in and out with memcpy */
+struct ACache
+{
+	void* shape;
+	void* meta;
+	unsigned long long mver;
+	void* val;
+	int n;
+};
+#define ACACHE_WORDS ((int)((sizeof(struct ACache) + 3) / 4))
+
+/* kinds of the entries in the OP_CONSTS section */
+enum CONSTTYPE
+{
+	CONST_INT = 1,
+	CONST_DOUBLE,
+	CONST_STRING,
+	CONST_LINES,
 };
\ No newline at end of file
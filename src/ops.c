@@ -11,12 +11,12 @@
  * Returns a string object representating self.
  */
 lp_obj* lp_str(LP,lp_obj* self) {
-    int type = self->type;
+    int type = lp_typeof(self);
     if (type == LP_STRING) { RETURN_LP_OBJ(self); }
 	else if (type == LP_INT) {
-		return lp_printf(lp, "%d", self->integer);
+		return lp_printf(lp, "%d", lp_integer(self));
 	} else if (type == LP_DOUBLE) {
-        return lp_printf(lp,"%f", self->doublen);
+        return lp_printf(lp,"%f", lp_doublen(self));
     } else if(type == LP_DICT) {
         return lp_printf(lp,"<dict 0x%x>",self->dict);
     } else if(type == LP_LIST) {
@@ -25,6 +25,9 @@ lp_obj* lp_str(LP,lp_obj* self) {
         return lp_string(lp, "None");
     } else if (type == LP_DATA) {
         return lp_printf(lp,"<data 0x%x>",self->data.val);
+    } else if (type == LP_RANGE) {
+        if (self->range.step == 1) { return lp_printf(lp,"range(%d, %d)",self->range.start,self->range.stop); }
+        return lp_printf(lp,"range(%d, %d, %d)",self->range.start,self->range.stop,self->range.step);
     } else if (type == LP_FNC) {
         return lp_printf(lp,"<fnc 0x%x>",self->fnc.info);
     }
@@ -39,13 +42,14 @@ lp_obj* lp_str(LP,lp_obj* self) {
  * is returned.
  */
 int lp_bool(LP,lp_obj* v) {
-    switch(v->type) {
-        case LP_INT: return v->integer != 0;
-		case LP_DOUBLE:	return v->doublen != 0.0;
+    switch(lp_typeof(v)) {
+        case LP_INT: return lp_integer(v) != 0;
+		case LP_DOUBLE:	return lp_doublen(v) != 0.0;
         case LP_NONE: return 0;
         case LP_STRING: return v->string.len != 0;
         case LP_LIST: return v->list->len != 0;
         case LP_DICT: return v->dict.val->len != 0;
+        case LP_RANGE: return v->range.len != 0;
     }
     return 1;
 }
@@ -57,14 +61,21 @@ int lp_bool(LP,lp_obj* v) {
  * Returns lp_True if self[k] exists, lp_False otherwise.
  */
 lp_obj* lp_has(LP,lp_obj* self, lp_obj* k) {
-    int type = self->type;
+    int type = lp_typeof(self);
     if (type == LP_DICT) {
         if (_lp_dict_find(lp,self->dict.val,k) != -1) { RETURN_LP_OBJ(lp->lp_True); }
 		RETURN_LP_OBJ(lp->lp_False);
-    } else if (type == LP_STRING && k->type == LP_STRING) {
+    } else if (type == LP_STRING && lp_typeof(k) == LP_STRING) {
         return lp_number_from_int(lp, _lp_str_index(self,0,k)!=-1);
     } else if (type == LP_LIST) {
         return lp_number_from_int(lp, _lp_list_find(lp,self->list,k)!=-1);
+    } else if (type == LP_RANGE) {
+        long long n;
+        if (lp_typeof(k) != LP_INT || !self->range.len) { return lp_number_from_int(lp, 0); }
+        n = (long long)lp_integer(k) - self->range.start;
+        if (n % self->range.step) { return lp_number_from_int(lp, 0); }
+        n /= self->range.step;
+        return lp_number_from_int(lp, n >= 0 && n < self->range.len);
     }
     lp_raise(0,lp_string(lp, "(lp_has) TypeError: iterable argument required"));
 }
@@ -77,7 +88,7 @@ lp_obj* lp_has(LP,lp_obj* self, lp_obj* k) {
  * Note that unlike with Python, you cannot use this to remove list items.
  */
 void lp_del(LP,lp_obj* self, lp_obj* k) {
-    int type = self->type;
+    int type = lp_typeof(self);
     if (type == LP_DICT) {
         _lp_dict_del(lp,self->dict.val,k,"lp_del");
         return;
@@ -87,18 +98,19 @@ void lp_del(LP,lp_obj* self, lp_obj* k) {
 
 
 /* Function: lp_iter
- * Iterate through a list or dict.
+ * Iterate through a list, range or dict.
  *
- * If self is a list/string/dictionary, this will iterate over the
- * elements/characters/keys respectively, if k is an increasing index
+ * If self is a list/range/string/dictionary, this will iterate over the
+ * elements/numbers/characters/keys respectively, if k is an increasing index
  * starting with 0 up to the length of the object-1.
  *
  * In the case of a list of string, the returned items will correspond to the
- * item at index k. For a dictionary, no guarantees are made about the order.
- * You also cannot call the function with a specific k to get a specific
- * item -- it is only meant for iterating through all items, calling this
- * function len(self) times. Use <lp_get> to retrieve a specific item, and
- * <lp_len> to get the length.
+ * item at index k. A dictionary gives its keys in the order they were
+ * inserted, and a view from keys(), values() or items() its keys, values or
+ * [key, value] lists. Once entries were deleted from a dictionary, finding
+ * the k-th one walks the entries; the VM walks dictionaries with a position
+ * of its own instead. Use <lp_get> to retrieve a specific item, and <lp_len>
+ * to get the length.
  *
  * Parameters:
  * self - The object over which to iterate.
@@ -109,16 +121,26 @@ void lp_del(LP,lp_obj* self, lp_obj* k) {
  * The first (k = 0) or next (k = 1 .. len(self)-1) item in the iteration.
  */
 lp_obj* lp_iter(LP,lp_obj* self, lp_obj* k) {
-    int type = self->type;
-    if (type == LP_LIST || type == LP_STRING) { return lp_get(lp,self,k); }
-    if (type == LP_DICT && k->type == LP_INT) {
-        lp_obj* obj = self->dict.val->items[_lp_dict_next(lp,self->dict.val)].key;
-		RETURN_LP_OBJ(obj);
+    int type = lp_typeof(self);
+    if (type == LP_LIST || type == LP_STRING || type == LP_RANGE) { return lp_get(lp,self,k); }
+    if ((type == LP_DICT || _lp_dict_view(self)) && lp_typeof(k) == LP_INT) {
+        int kind = type == LP_DICT ? LP_VIEW_KEYS : self->data.magic;
+        _lp_dict *d = type == LP_DICT ? self->dict.val : ((lp_obj*)self->data.val)->dict.val;
+        int n = _lp_dict_nth(d, lp_integer(k));
+        if (n < 0) { lp_raise(0,lp_string(lp, "(lp_iter) IndexError: dict changed size")); }
+        return _lp_dict_view_item(lp, kind, &d->items[n], 0);
     }
     lp_raise(0,lp_string(lp, "(lp_iter) TypeError: iteration over non-sequence"));
 }
 
 
+/* the unbound method k of a list or string, 0 if there is none */
+static lp_obj* _lp_type_method(LP, lp_obj* self, lp_obj* k) {
+    lp_obj* m = lp_typeof(self) == LP_LIST ? lp->list_methods : lp->string_methods;
+    int n = _lp_dict_find(lp,m->dict.val,k);
+    return n == -1 ? 0 : m->dict.val->items[n].val;
+}
+
 /* Function: lp_get
  * Attribute lookup.
  * 
@@ -129,7 +151,7 @@ lp_obj* lp_iter(LP,lp_obj* self, lp_obj* k) {
  * element in the list and subsequently remove it from the list.
  */
 lp_obj* lp_get(LP,lp_obj* self, lp_obj* k) {
-    int type = self->type;
+    int type = lp_typeof(self);
     lp_obj* r;
     if (type == LP_DICT) {
         LP_META_BEGIN(self,"__get__");
@@ -140,65 +162,53 @@ lp_obj* lp_get(LP,lp_obj* self, lp_obj* k) {
         LP_META_END;
         if (self->dict.dtype && lp_lookup(lp,self,k,&r)) { return r; }
         return _lp_dict_get(lp,self->dict.val,k,"lp_get");
+    } else if (type == LP_RANGE && lp_typeof(k) == LP_INT) {
+        int n = lp_integer(k);
+        n = (n<0?self->range.len+n:n);
+        if (n < 0 || n >= self->range.len) { lp_raise(0,lp_string(lp, "(lp_get) KeyError")); }
+        return lp_number_from_llong(lp, self->range.start + (long long)n*self->range.step);
     } else if (type == LP_LIST) {
-        if (k->type == LP_INT) {
+        if (lp_typeof(k) == LP_INT) {
             int l = lp_lenx(lp,self);
-            int n = k->integer;
+            int n = lp_integer(k);
             n = (n<0?l+n:n);
             return _lp_list_get(lp,self->list,n,"lp_get");
-        } else if (k->type == LP_STRING) {
-            if (_lp_str_cmp(k, "append") == 0) {
-                return lp_method(lp,self,lpf_append);
-            } else if (_lp_str_cmp(k, "pop") == 0) {
-                return lp_method(lp,self,lpf_pop);
-            } else if (_lp_str_cmp(k, "index") == 0) {
-                return lp_method(lp,self,lpf_index);
-            } else if (_lp_str_cmp(k, "sort") == 0) {
-                return lp_method(lp,self,lpf_sort);
-            } else if (_lp_str_cmp(k, "extend") == 0) {
-                return lp_method(lp,self,lpf_extend);
+        } else if (lp_typeof(k) == LP_STRING) {
+            if ((r = _lp_type_method(lp,self,k))) {
+                return lp_fnc_new(lp,r->fnc.ftype|2,r->fnc.cfnc,lp->lp_None,self,lp->lp_None);
             } else if (_lp_str_cmp(k, "*") == 0) {
-                lp_params_v(lp,1,self);
-                r = lpf_copy(lp);
+                r = lpf_copy(lp,1,&self);
                 self->list->len=0;
                 return r;
             }
-        } else if (k->type == LP_NONE) {
+        } else if (lp_typeof(k) == LP_NONE) {
             return _lp_list_pop(lp,self->list,0,"lp_get");
         }
     } else if (type == LP_STRING) {
-        if (k->type == LP_INT) {
+        if (lp_typeof(k) == LP_INT) {
             int l = self->string.len;
-            int n = k->integer;
+            int n = lp_integer(k);
             n = (n<0?l+n:n);
-            if (n >= 0 && n < l) { return lp_string_n(lp, lp->chars[(unsigned char)self->string.val[n]],1); }
-        } else if (k->type == LP_STRING) {
-            if (lp_cmps(lp, k, "join") == 0) {
-                return lp_method(lp,self,lpf_join);
-            } else if (lp_cmps(lp, k, "split") == 0) {
-                return lp_method(lp,self,lpf_split);
-            } else if (lp_cmps(lp, k, "index") == 0) {
-                return lp_method(lp,self,lpf_str_index);
-            } else if (lp_cmps(lp, k, "strip") == 0) {
-                return lp_method(lp,self,lpf_strip);
-            } else if (lp_cmps(lp, k, "replace") == 0) {
-                return lp_method(lp,self,lpf_replace);
+            if (n >= 0 && n < l) { return lp_string_char(lp, self->string.val[n]); }
+        } else if (lp_typeof(k) == LP_STRING) {
+            if ((r = _lp_type_method(lp,self,k))) {
+                return lp_fnc_new(lp,r->fnc.ftype|2,r->fnc.cfnc,lp->lp_None,self,lp->lp_None);
             }
         }
     }
 
-    if (k->type == LP_LIST) {
+    if (lp_typeof(k) == LP_LIST) {
         int a,b,l;
         lp_obj* tmp;
 		l = lp_lenx(lp, self);
         tmp = _lp_list_get(lp, k->list, 0, "lp_get");
-		if (tmp->type == LP_INT) { a = tmp->integer; }
-        else if(tmp->type == LP_NONE) { a = 0; }
+		if (lp_typeof(tmp) == LP_INT) { a = lp_integer(tmp); }
+        else if(lp_typeof(tmp) == LP_NONE) { a = 0; }
         else { LP_OBJ_DEC(tmp); lp_raise(0,lp_string(lp, "(lp_get) TypeError: indices must be integer")); }
 		LP_OBJ_DEC(tmp);
         tmp = _lp_list_get(lp, k->list, 1, "lp_get");
-        if (tmp->type == LP_INT) { b = tmp->integer; }
-        else if(tmp->type == LP_NONE) { b = l; }
+        if (lp_typeof(tmp) == LP_INT) { b = lp_integer(tmp); }
+        else if(lp_typeof(tmp) == LP_NONE) { b = l; }
         else { LP_OBJ_DEC(tmp); lp_raise(0,lp_string(lp, "(lp_get) TypeError: indices must be integer")); }
 		LP_OBJ_DEC(tmp);
         a = _lp_max(0,(a<0?l+a:a)); b = _lp_min(l,(b<0?l+b:b));
@@ -219,6 +229,46 @@ lp_obj* lp_getk(LP, lp_obj* self, lp_obj* k)
 	return r;
 }
 
+/* Function: lp_get_method
+ * Attribute lookup for a method call.
+ *
+ * This is like <lp_get>, but when self[k] would be a method bound to self,
+ * the unbound function is returned and self is stored in *s instead, so no
+ * bound method gets made. Otherwise *s is set to None.
+ */
+lp_obj* lp_get_method(LP, lp_obj* self, lp_obj* k, lp_obj** s) {
+    int type = lp_typeof(self);
+    lp_obj* r;
+    *s = lp->lp_None;
+    if (lp_typeof(k) != LP_STRING) { return lp_get(lp,self,k); }
+    if (type == LP_DICT && self->dict.dtype == 2) {
+        lp_obj* meta = self->dict.val->meta;
+        int n;
+        if (lp_lookupx(lp,self,"__get__",&r)) {
+            LP_OBJ_DEC(r);
+            return lp_get(lp,self,k);
+        }
+        n = _lp_dict_find(lp,self->dict.val,k);
+        if (n != -1) { RETURN_LP_OBJ(self->dict.val->items[n].val); }
+        /* same depth as the lookup through self in lp_get */
+        if (meta && lp_typeof(meta) == LP_DICT && lp_lookup_(lp,meta,k,&r,7)) {
+            if (lp_typeof(r) == LP_FNC && !(r->fnc.ftype&2)) {
+                *s = self; LP_OBJ_INC(self);
+            } else if (lp_typeof(r) == LP_FNC) {
+                LP_OBJ_DEC(r);
+                return lp_get(lp,self,k);
+            }
+            return r;
+        }
+    } else if (type == LP_LIST || type == LP_STRING) {
+        if ((r = _lp_type_method(lp,self,k))) {
+            *s = self; LP_OBJ_INC(self);
+            RETURN_LP_OBJ(r);
+        }
+    }
+    return lp_get(lp,self,k);
+}
+
 /* Function: lp_iget
  * Failsafe attribute lookup.
  *
@@ -227,14 +277,14 @@ lp_obj* lp_getk(LP, lp_obj* self, lp_obj* k)
  * over the reference parameter r.
  */
 int lp_iget(LP,lp_obj **r, lp_obj* self, lp_obj* k) {
-    if (self->type == LP_DICT) {
+    if (lp_typeof(self) == LP_DICT) {
         int n = _lp_dict_find(lp,self->dict.val,k);
         if (n == -1) { return 0; }
         *r = self->dict.val->items[n].val;
 		LP_OBJ_INC(*r);
         return 1;
     }
-    if (self->type == LP_LIST && !self->list->len) { return 0; }
+    if (lp_typeof(self) == LP_LIST && !self->list->len) { return 0; }
     *r = lp_get(lp,self,k);
     return 1;
 }
@@ -253,7 +303,7 @@ int lp_igetk(LP, lp_obj **r, lp_obj* self, lp_obj* k)
  * in actual tinypy code.
  */
 void lp_set(LP,lp_obj* self, lp_obj* k, lp_obj* v) {
-    int type = self->type;
+    int type = lp_typeof(self);
 	lp_obj* r;
 
     if (type == LP_DICT) {
@@ -267,16 +317,17 @@ void lp_set(LP,lp_obj* self, lp_obj* k, lp_obj* v) {
         _lp_dict_set(lp,self->dict.val,k,v);
         return;
     } else if (type == LP_LIST) {
-        if (k->type == LP_INT) {
-            _lp_list_set(lp,self->list, k->integer,v,"lp_set");
+        if (lp_typeof(k) == LP_INT) {
+            int n = lp_integer(k);
+            _lp_list_set(lp,self->list, n<0?self->list->len+n:n,v,"lp_set");
             return;
-        } else if (k->type == LP_NONE) {
+        } else if (lp_typeof(k) == LP_NONE) {
             _lp_list_append(lp,self->list,v);
             return;
-        } else if (k->type == LP_STRING) {
+        } else if (lp_typeof(k) == LP_STRING) {
 			lp_obj* name = lp_string(lp, "*");
             if (lp_cmp(lp,name,k) == 0) {
-                lp_params_v(lp,2,self,v);lpf_extend(lp);
+                lp_obj* a[2] = {self,v}; lpf_extend(lp,2,a);
 				LP_OBJ_DEC(name);
                 return;
             }
@@ -306,23 +357,34 @@ void lp_setkv(LP, lp_obj* self, lp_obj* k, lp_obj* v)
 }
 
 lp_obj* lp_add(LP,lp_obj* a, lp_obj* b) {
+    if (lp_is_fixnum(a) && lp_is_fixnum(b)) {
+        return lp_number_from_llong(lp, (long long)lp_fixnum_val(a) + lp_fixnum_val(b));
+    }
     if (lp_is_number(a) && lp_is_number(b)) {
-		if (a->type == LP_INT && a->type == b->type)
-			return lp_number_from_int(lp, a->integer + b->integer);
+		if (lp_typeof(a) == LP_INT && lp_typeof(a) == lp_typeof(b))
+			return lp_number_from_llong(lp, (long long)lp_integer(a) + lp_integer(b));
 		else
 			return lp_number_from_double(lp, lp_type_number(lp, a) + lp_type_number(lp, b));
-    } else if (a->type == LP_STRING && a->type == b->type) {
+    } else if (lp_typeof(a) == LP_STRING && lp_typeof(a) == lp_typeof(b)) {
         int al = a->string.len, bl = b->string.len;
-        lp_obj* r = lp_string_t(lp,al+bl);
-        char *s = r->string.info->s;
+        lp_obj* r;
+        char *s;
+        if (al > INT_MAX - bl) {
+            lp_raise(0,lp_string(lp, "(lp_add) OverflowError: string too long"));
+        }
+        r = lp_string_t(lp,al+bl);
+        if (!r) { return 0; }
+        s = r->string.info->s;
         memcpy(s,a->string.val,al); memcpy(s+al,b->string.val,bl);
         return r;
-    } else if (a->type == LP_LIST && a->type == b->type) {
+    } else if (lp_typeof(a) == LP_LIST && lp_typeof(a) == lp_typeof(b)) {
         lp_obj* r;
-        lp_params_v(lp,1,a);
-        r = lpf_copy(lp);
-        lp_params_v(lp,2,r,b);
-        lpf_extend(lp);
+        lp_obj* v[2];
+        r = lpf_copy(lp,1,&a);
+        if (!r) { return 0; }
+        v[0] = r; v[1] = b;
+        lpf_extend(lp,2,v);
+        if (lp->ex) { LP_OBJ_DEC(r); return 0; }
         return r;
     }
     lp_raise(0,lp_string(lp, "(lp_add) TypeError: ?"));
@@ -330,21 +392,25 @@ lp_obj* lp_add(LP,lp_obj* a, lp_obj* b) {
 
 lp_obj* lp_mul(LP,lp_obj* a, lp_obj* b) {
     if (lp_is_number(a) && lp_is_number(b)) {
-		if (a->type == LP_INT && a->type == b->type)
-			return lp_number_from_int(lp, a->integer * b->integer);
+		if (lp_typeof(a) == LP_INT && lp_typeof(a) == lp_typeof(b))
+			return lp_number_from_int(lp, lp_integer(a) * lp_integer(b));
 		else
 			return lp_number_from_double(lp, lp_type_number(lp, a) * lp_type_number(lp, b));
-    } else if ((a->type == LP_STRING && (b->type == LP_INT)) ||
-               ((a->type == LP_INT) && b->type == LP_STRING)) {
-        if(a->type == LP_INT) {
+    } else if ((lp_typeof(a) == LP_STRING && (lp_typeof(b) == LP_INT)) ||
+               ((lp_typeof(a) == LP_INT) && lp_typeof(b) == LP_STRING)) {
+        if(lp_typeof(a) == LP_INT) {
             lp_obj* c = a; a = b; b = c;
         }
-        int al = a->string.len; int n = b->integer;
+        int al = a->string.len; int n = lp_integer(b);
         if(n <= 0) {
             lp_obj* r = lp_string_t(lp,0);
             return r;
         }
+        if ((long long)al*n > INT_MAX) {
+            lp_raise(0,lp_string(lp, "(lp_mul) OverflowError: string too long"));
+        }
         lp_obj* r = lp_string_t(lp,al*n);
+        if (!r) { return 0; }
         char *s = r->string.info->s;
         int i; for (i=0; i<n; i++) { memcpy(s+al*i,a->string.val,al); }
         return r;
@@ -355,16 +421,21 @@ lp_obj* lp_mul(LP,lp_obj* a, lp_obj* b) {
 /* Function: lp_len
  * Returns the length of an object.
  *
- * Returns the number of items in a list or dict, or the length of a string.
+ * Returns the number of items in a list, range or dict, or the length of a
+ * string.
  */
 lp_obj* lp_len(LP,lp_obj* self) {
-    int type = self->type;
+    int type = lp_typeof(self);
     if (type == LP_STRING) {
         return lp_number_from_int(lp, self->string.len);
     } else if (type == LP_DICT) {
         return lp_number_from_int(lp, self->dict.val->len);
     } else if (type == LP_LIST) {
         return lp_number_from_int(lp, self->list->len);
+    } else if (type == LP_RANGE) {
+        return lp_number_from_int(lp, self->range.len);
+    } else if (_lp_dict_view(self)) {
+        return lp_number_from_int(lp, ((lp_obj*)self->data.val)->dict.val->len);
     }
     
     lp_raise(0,lp_string(lp, "(lp_len) TypeError: len() of unsized object"));
@@ -372,7 +443,7 @@ lp_obj* lp_len(LP,lp_obj* self) {
 
 int lp_lenx(LP, lp_obj* self)
 {
-	int type = self->type;
+	int type = lp_typeof(self);
 	if (type == LP_STRING) {
 		return self->string.len;
 	}
@@ -382,18 +453,29 @@ int lp_lenx(LP, lp_obj* self)
 	else if (type == LP_LIST) {
 		return self->list->len;
 	}
+	else if (type == LP_RANGE) {
+		return self->range.len;
+	}
+	else if (_lp_dict_view(self)) {
+		return ((lp_obj*)self->data.val)->dict.val->len;
+	}
 
 	lp_raise(0, lp_string(lp, "(lp_len) TypeError: len() of unsized object"));
 }
 
 int lp_cmp(LP,lp_obj* a, lp_obj* b) {
-    if (a->type != b->type) { return a->type-b->type; }
-    switch(a->type) {
+    if (lp_is_fixnum(a) && lp_is_fixnum(b)) {
+        int x = lp_fixnum_val(a), y = lp_fixnum_val(b);
+        return (x > y) - (x < y);
+    }
+    if (lp_typeof(a) != lp_typeof(b)) { return lp_typeof(a)-lp_typeof(b); }
+    switch(lp_typeof(a)) {
         case LP_NONE: return 0;
 		case LP_INT:
         case LP_DOUBLE: return _lp_sign(lp_type_number(lp, a)- lp_type_number(lp, b));
         case LP_STRING: {
             int l = _lp_min(a->string.len,b->string.len);
+            if (a == b) { return 0; }
             int v = memcmp(a->string.val,b->string.val,l);
             if (v == 0) {
                 v = a->string.len-b->string.len;
@@ -403,20 +485,25 @@ int lp_cmp(LP,lp_obj* a, lp_obj* b) {
         case LP_LIST: {
             int n,v; for(n=0;n<_lp_min(a->list->len,b->list->len);n++) {
         lp_obj* aa = a->list->items[n]; lp_obj* bb = b->list->items[n];
-            if (aa->type == LP_LIST && bb->type == LP_LIST) { v = aa->list-bb->list; } else { v = lp_cmp(lp,aa,bb); }
+            if (lp_typeof(aa) == LP_LIST && lp_typeof(bb) == LP_LIST) { v = aa->list-bb->list; } else { v = lp_cmp(lp,aa,bb); }
             if (v) { return v; } }
             return a->list->len-b->list->len;
         }
         case LP_DICT: return a->dict.val - b->dict.val;
         case LP_FNC: return a->fnc.info - b->fnc.info;
         case LP_DATA: return (char*)a->data.val - (char*)b->data.val;
+        case LP_RANGE:
+            if (a->range.len != b->range.len) { return a->range.len - b->range.len; }
+            if (a->range.len && a->range.start != b->range.start) { return a->range.start < b->range.start ? -1 : 1; }
+            if (a->range.len > 1 && a->range.step != b->range.step) { return a->range.step < b->range.step ? -1 : 1; }
+            return 0;
     }
     lp_raise(0,lp_string(lp, "(lp_cmp) TypeError: ?"));
 }
 
 int lp_cmps(LP, lp_obj* a, const char* b)
 {
-	if (a->type != LP_STRING) { return a->type - LP_STRING; }
+	if (lp_typeof(a) != LP_STRING) { return lp_typeof(a) - LP_STRING; }
 
 	int l = _lp_min(a->string.len, strlen(b));
 	int v = memcmp(a->string.val, b, l);
@@ -428,8 +515,8 @@ int lp_cmps(LP, lp_obj* a, const char* b)
 
 #define LP_INT_OP(name,expr) \
     lp_obj* name(LP,lp_obj* _a,lp_obj* _b) { \
-    if (_a->type == LP_INT && _a->type == _b->type) { \
-        int a = _a->integer; int b = _b->integer; \
+    if (lp_typeof(_a) == LP_INT && lp_typeof(_a) == lp_typeof(_b)) { \
+        int a = lp_integer(_a); int b = lp_integer(_b); \
         return lp_number_from_int(lp, expr); \
     } \
     lp_raise(0,lp_string(lp, "(" #name ") TypeError: unsupported operand type(s)")); \
@@ -437,11 +524,15 @@ int lp_cmps(LP, lp_obj* a, const char* b)
 
 #define LP_OP(name,expr) \
     lp_obj* name(LP,lp_obj* _a,lp_obj* _b) { \
+    if (lp_is_fixnum(_a) && lp_is_fixnum(_b)) { \
+        long long a = lp_fixnum_val(_a); long long b = lp_fixnum_val(_b); \
+        return lp_number_from_llong(lp, expr); \
+    } \
     if (lp_is_number(_a) && lp_is_number(_b)) { \
-		if (_a->type == LP_INT && _a->type == _b->type) \
+		if (lp_typeof(_a) == LP_INT && lp_typeof(_a) == lp_typeof(_b)) \
 		{ \
-			int a = _a->integer; int b = _b->integer; \
-			return lp_number_from_int(lp, expr); \
+			long long a = lp_integer(_a); long long b = lp_integer(_b); \
+			return lp_number_from_llong(lp, expr); \
 		} \
 		else \
 		{ \
@@ -455,7 +546,7 @@ int lp_cmps(LP, lp_obj* a, const char* b)
 LP_INT_OP(lp_bitwise_and,(a)&(b));
 LP_INT_OP(lp_bitwise_or,(a)|(b));
 LP_INT_OP(lp_bitwise_xor,(a)^(b));
-LP_INT_OP(lp_lsh,(a)<<(b));
+LP_INT_OP(lp_lsh,(int)((unsigned int)(a)<<(b)));
 LP_INT_OP(lp_rsh,(a)>>(b));
 LP_INT_OP(lp_mod,(a)%(b));
 LP_OP(lp_sub,a-b);
@@ -463,8 +554,8 @@ LP_OP(lp_div,a/b);
 LP_OP(lp_pow,pow(a,b));
 
 lp_obj* lp_bitwise_not(LP, lp_obj* a) {
-    if (a->type == LP_INT) {
-        return lp_number_from_int(lp, ~a->integer);
+    if (lp_typeof(a) == LP_INT) {
+        return lp_number_from_int(lp, ~lp_integer(a));
     }
     lp_raise(0,lp_string(lp, "(lp_bitwise_not) TypeError: unsupported operand type"));
 }
@@ -9,10 +9,15 @@
  * Create a new empty string of a certain size.
  * Does not put it in for GC tracking, since contents should be
  * filled after returning.
+ * Returns 0 with MemoryError raised if there is no memory for a string
+ * that long, see <lp_malloc>.
  */ 
 lp_obj* lp_string_t(LP, int n) {
-    lp_obj* r = lp_string_n(lp, 0,n);
-    r->string.info = lp_string_new(lp, n);
+    _lp_string *info = lp_string_new(lp, n);
+    lp_obj* r;
+    if (!info) { return 0; }
+    r = lp_string_n(lp, 0,n);
+    r->string.info = info;
 	r->string.info->ref = 1;
     r->string.val = r->string.info->s;
 	r->string.len = n;
@@ -25,6 +30,7 @@ lp_obj* lp_string_t(LP, int n) {
  */
 lp_obj* lp_string_copy(LP, const char *s, int n) {
     lp_obj* r = lp_string_t(lp,n);
+    if (!r) { return 0; }
     memcpy(r->string.info->s,s,n);
     return r;
 }
@@ -37,15 +43,65 @@ lp_obj* lp_string_copy(LP, const char *s, int n) {
 lp_obj* lp_string_sub(LP, lp_obj* s, int a, int b) {
     int l = s->string.len;
     a = _lp_max(0,(a<0?l+a:a)); b = _lp_min(l,(b<0?l+b:b));
+    if (b - a == 1) { return lp_string_char(lp, s->string.val[a]); }
     lp_obj* r = lp_obj_new(lp, LP_STRING);
 	r->string.info = s->string.info;
 	if (r->string.info)
 		r->string.info->ref++;
     r->string.val = s->string.val + a;
     r->string.len = b-a;
+    r->string.hash = 0;
     return r;
 }
 
+/* Function: lp_intern
+ * Returns the interned string with the n bytes at v.
+ *
+ * A VM keeps one string object per interned value for as long as it
+ * lives, in lp->strings. Short names, those of compiled code and those C
+ * code passes to <lp_string>, are interned, so they hash once and dict
+ * lookups match them by identity before comparing bytes. Strings a
+ * program builds at run time are not, so the table only grows with the
+ * names in the code a VM runs. The first string with a value is a copy
+ * of v.
+ */
+lp_obj* lp_intern(LP, char const *v, int n) {
+    _lp_dict *t = lp->strings->dict.val;
+    lp_obj k, *r;
+    int hash, i;
+    k.type = LP_STRING;
+    k.ref = 1;
+    k.string.info = 0;
+    k.string.val = v;
+    k.string.len = n;
+    k.string.hash = 0;
+    hash = lp_hash(lp, &k);
+    i = _lp_dict_hash_find(lp, t, hash, &k);
+    if (i >= 0) {
+        r = t->items[i].key;
+        LP_OBJ_INC(r);
+        return r;
+    }
+    r = lp_string_copy(lp, v, n);
+    r->string.hash = hash;
+    _lp_dict_set(lp, t, r, lp->lp_None);
+    return r;
+}
+
+/* Function: lp_is_name
+ * Whether the n bytes at v are an identifier, see <lp_intern>.
+ */
+int lp_is_name(char const *v, int n) {
+    int i;
+    if (n <= 0 || (v[0] >= '0' && v[0] <= '9')) { return 0; }
+    for (i = 0; i < n; i++) {
+        char c = v[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') || c == '_')) { return 0; }
+    }
+    return 1;
+}
+
 lp_obj* lp_printf(LP, char const *fmt,...) {
     int l;
     lp_obj* r;
@@ -54,8 +110,9 @@ lp_obj* lp_printf(LP, char const *fmt,...) {
     va_start(arg, fmt);
     l = vsnprintf(NULL, 0, fmt,arg);
     r = lp_string_t(lp,l);
-    s = r->string.info->s;
     va_end(arg);
+    if (!r) { return 0; }
+    s = r->string.info->s;
     va_start(arg, fmt);
     vsprintf(s,fmt,arg);
     va_end(arg);
@@ -82,9 +139,9 @@ int _lp_str_index(lp_obj* s, int i, lp_obj* k) {
 }
 
 
-lp_obj* lpf_join(LP) {
-    lp_obj* delim = LP_OBJ(0);
-    lp_obj* val = LP_OBJ(1);
+lp_obj* lpf_join(LP, LP_ARGS) {
+    lp_obj* delim = LP_ARG(0);
+    lp_obj* val = LP_ARG_TYPE(1,LP_LIST);
     int l=0,i;
     lp_obj* r;
     char *s;
@@ -95,6 +152,7 @@ lp_obj* lpf_join(LP) {
 		lp_obj_dec(lp, r);
     }
     r = lp_string_t(lp,l);
+    if (!r) { return 0; }
     s = r->string.info->s;
     l = 0;
     for (i=0; i<val->list->len; i++) {
@@ -109,14 +167,15 @@ lp_obj* lpf_join(LP) {
     return r;
 }
 
-lp_obj* lpf_split(LP) {
-    lp_obj* v = LP_OBJ(0);
-    lp_obj* d = LP_OBJ(1);
+lp_obj* lpf_split(LP, LP_ARGS) {
+    lp_obj* v = LP_ARG(0);
+    lp_obj* d = LP_ARG_STR(1);
     lp_obj* r = lp_list(lp);
 
     int i = 0;
     while ((i=_lp_str_index(v,i,d))!=-1) {
         _lp_list_append(lp,r->list,lp_string_sub(lp,v,0,i));
+        if (lp->ex) { LP_OBJ_DEC(r); return 0; }
         i += d->string.len;
     }
     _lp_list_append(lp,r->list,lp_string_sub(lp,v,0,v->string.len));
@@ -124,15 +183,15 @@ lp_obj* lpf_split(LP) {
 }
 
 
-lp_obj* lpf_find(LP) {
-    lp_obj* s = LP_OBJ(0);
-    lp_obj* v = LP_OBJ(1);
+lp_obj* lpf_find(LP, LP_ARGS) {
+    lp_obj* s = LP_ARG(0);
+    lp_obj* v = LP_ARG_STR(1);
     return lp_number_from_int(lp, _lp_str_index(s,0,v));
 }
 
-lp_obj* lpf_str_index(LP) {
-    lp_obj* s = LP_OBJ(0);
-    lp_obj* v = LP_OBJ(1);
+lp_obj* lpf_str_index(LP, LP_ARGS) {
+    lp_obj* s = LP_ARG(0);
+    lp_obj* v = LP_ARG_STR(1);
     int n = _lp_str_index(s,0,v);
     if (n >= 0) { return lp_number_from_int(lp, n); }
     lp_raise(0,lp_string(lp, "(lp_str_index) ValueError: substring not found"));
@@ -145,7 +204,7 @@ lp_obj* lpf_str2(LP) {
 
 lp_obj* lpf_chr(LP) {
 	int v = LP_INTEGER(0);
-    return lp_string_n(lp, lp->chars[(unsigned char)v],1);
+    return lp_string_char(lp, v);
 }
 lp_obj* lpf_ord(LP) {
     lp_obj* s = LP_STR(0);
@@ -155,8 +214,8 @@ lp_obj* lpf_ord(LP) {
     return lp_number_from_int(lp, (unsigned char)s->string.val[0]);
 }
 
-lp_obj* lpf_strip(LP) {
-    lp_obj* o = LP_TYPE(0, LP_STRING);
+lp_obj* lpf_strip(LP, LP_ARGS) {
+    lp_obj* o = LP_ARG_STR(0);
     char const *v = o->string.val; int l = o->string.len;
     int i; int a = l, b = 0;
     lp_obj* r;
@@ -168,15 +227,16 @@ lp_obj* lpf_strip(LP) {
     }
     if ((b-a) < 0) { return lp_string(lp, ""); }
     r = lp_string_t(lp,b-a);
+    if (!r) { return 0; }
     s = r->string.info->s;
     memcpy(s,v+a,b-a);
     return r;
 }
 
-lp_obj* lpf_replace(LP) {
-    lp_obj* s = LP_OBJ(0);
-    lp_obj* k = LP_OBJ(1);
-    lp_obj* v = LP_OBJ(2);
+lp_obj* lpf_replace(LP, LP_ARGS) {
+    lp_obj* s = LP_ARG(0);
+    lp_obj* k = LP_ARG_STR(1);
+    lp_obj* v = LP_ARG_STR(2);
     int i = 0,n = 0;
     int c;
     int l;
@@ -190,6 +250,7 @@ lp_obj* lpf_replace(LP) {
 /*     fprintf(stderr,"ns: %d\n",n); */
     l = s->string.len + n * (v->string.len-k->string.len);
     rr = lp_string_t(lp,l);
+    if (!rr) { return 0; }
     r = rr->string.info->s;
     d = r;
 	i = 0;  //
@@ -258,46 +258,46 @@ def t_unrender(s):
     assert(ok == True)
 
 def test_range():
-    t_render("""print(str(range(4))[:5])""","<list")
+    t_render("""print(str(range(4))[:5])""","range")
     t_render("""print(len(range(4)))""","4")
     t_render("""print(range(4)[0])""","0")
     t_render("""print(range(4)[1])""","1")
     t_render("""print(range(4)[-1])""","3")
 
-    t_render("""print(str(range(-4))[:5])""","<list")
+    t_render("""print(str(range(-4))[:5])""","range")
     t_render("""print(len(range(-4)))""","0")
 
-    t_render("""print(str(range(0,5,3))[:5])""","<list")
+    t_render("""print(str(range(0,5,3))[:5])""","range")
     t_render("""print(len(range(0,5,3)))""","2")
     t_render("""print(range(0,5,3)[0])""","0")
     t_render("""print(range(0,5,3)[1])""","3")
     t_render("""print(range(0,5,3)[-1])""","3")
 
-    t_render("""print(str(range(5,0,-3))[:5])""","<list")
+    t_render("""print(str(range(5,0,-3))[:5])""","range")
     t_render("""print(len(range(5,0,-3)))""","2")
     t_render("""print(range(5,0,-3)[0])""","5")
     t_render("""print(range(5,0,-3)[1])""","2")
     t_render("""print(range(5,0,-3)[-1])""","2")
 
-    t_render("""print(str(range(-8,-4))[:5])""","<list")
+    t_render("""print(str(range(-8,-4))[:5])""","range")
     t_render("""print(len(range(-8,-4)))""","4")
     t_render("""print(range(-8,-4)[0])""","-8")
     t_render("""print(range(-8,-4)[1])""","-7")
     t_render("""print(range(-8,-4)[-1])""","-5")
 
-    t_render("""print(str(range(-4,-8,-1))[:5])""","<list")
+    t_render("""print(str(range(-4,-8,-1))[:5])""","range")
     t_render("""print(len(range(-4,-8,-1)))""","4")
     t_render("""print(range(-4,-8,-1)[0])""","-4")
     t_render("""print(range(-4,-8,-1)[1])""","-5")
     t_render("""print(range(-4,-8,-1)[-1])""","-7")
 
-    t_render("""print(str(range(-4,-8))[:5])""","<list")
+    t_render("""print(str(range(-4,-8))[:5])""","range")
     t_render("""print(len(range(-4,-8)))""","0")
 
-    t_render("""print(str(range(-8,-4,-1))[:5])""","<list")
+    t_render("""print(str(range(-8,-4,-1))[:5])""","range")
     t_render("""print(len(range(-8,-4,-1)))""","0")
 
-    t_render("""print(str(range(0,4,0))[:5])""","<list")
+    t_render("""print(str(range(0,4,0))[:5])""","range")
     t_render("""print(len(range(0,4,0)))""","0")
 
     
@@ -61,7 +61,8 @@ enum ItemType
 	I_JUMP,
 	I_SETJMP,
 	I_FNC,
-	I_REGS
+	I_REGS,
+	I_POS
 };
 
 struct Item
@@ -202,14 +203,14 @@ struct DState
 {
 	const char* fname;
 	const char* code;
-	const char** lines;
-	int linenum;
 	struct ItemList out;
 	char* so;
 	int nso;
 	int _tagi;
 	struct IntListItem* tstack;
 	struct Scope* scope;
+	struct StrList consts;
+	struct IntList pclines;
 };
 
 struct CompileState
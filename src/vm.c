@@ -3,34 +3,76 @@
 #include "lp.h"
 #include "lp_internal.h"
 #include "tokenize.h"
+#include "opcode.h"
 
 extern void math_init(LP);
 extern void random_init(LP);
 extern void re_init(LP);
 extern void time_init(LP);
 extern void init_lp_mem(LP);
+extern void deinit_lp_data(LP);
+extern void deinit_lp_mem(LP);
 int lp_run(LP, int cur);
 
+/* reads a double stored inline in the code; code words are only 4-byte
+ * aligned, so it is copied out rather than loaded in place */
+lp_inline double lp_code_double(lp_code *c) {
+    double d;
+    memcpy(&d, c, sizeof(d));
+    return d;
+}
+
 /* File: VM
  * Functionality pertaining to the virtual machine.
  */
 
-lp_vm *_lp_init(void) {
+/* the seed of the string hash: LP_HASHSEED from the environment, else
+ * bytes of /dev/urandom, else what differs between runs anyway (the time,
+ * and with address space randomization where the VM and the stack are) */
+static uint64_t lp_hash_seed(LP) {
+    const char *s = getenv("LP_HASHSEED");
+    uint64_t a, b;
+    FILE *f;
+    if (s && *s) { return (uint64_t)strtoull(s, 0, 10); }
+    f = fopen("/dev/urandom", "rb");
+    if (f) {
+        size_t n = fread(&a, sizeof(a), 1, f);
+        fclose(f);
+        if (n == 1) { return a; }
+    }
+    a = (uint64_t)time(0) ^ ((uint64_t)clock() << 32);
+    b = (uint64_t)(uintptr_t)lp ^ ((uint64_t)(uintptr_t)&s << 16);
+    return _lp_wyhash(&a, sizeof(a), b);
+}
+
+lp_vm *_lp_init(const lp_allocator* mem) {
     int i;
-    lp_vm *lp = (lp_vm*)calloc(sizeof(lp_vm),1);
+    lp_vm *lp = (lp_vm*)mem->alloc(mem->ud, sizeof(lp_vm));
+    if (!lp) { return 0; }
+    memset(lp, 0, sizeof(lp_vm));
+    lp->mem = *mem;
+    lp->mem_used = lp->mem_peak = sizeof(lp_vm);
+    lp->hash_seed = lp_hash_seed(lp);
+    lp_mem_limit(lp, LP_NO_LIMIT);
 	init_lp_mem(lp);
     lp->time_limit = LP_NO_LIMIT;
     lp->clocks = clock();
     lp->time_elapsed = 0.0;
-    lp->mem_limit = LP_NO_LIMIT;
-    lp->mem_exceeded = 0;
-    lp->mem_used = sizeof(lp_vm);
 	memset(lp->frames, 0, sizeof(lp->frames));
     lp->cur = 0;
     lp->ex = 0;
 	lp->oldex = 0;
     lp->root = lp_list_nt(lp);
-    for (i=0; i<256; i++) { lp->chars[i][0]=i; }
+    lp->strings = lp_dict(lp);
+    _lp_shape_init(lp);
+    for (i=0; i<256; i++) {
+        lp->chars[i][0]=i;
+        lp->char_strings[i] = lp_string_n(lp, lp->chars[i], 1);
+        lp->char_strings[i]->ref = LP_IMMORTAL;
+    }
+    /* made now, raising it must not need memory */
+    lp->mem_error = lp_string(lp, "(lp_malloc) MemoryError: out of memory");
+    lp->mem_error->ref = LP_IMMORTAL;
     lp->_regs = lp_list(lp);
     for (i=0; i<LP_REGS; i++) { lp_set(lp,lp->_regs,lp->lp_None, lp->lp_None); }
     lp->builtins = lp_dict(lp);
@@ -42,6 +84,7 @@ lp_vm *_lp_init(void) {
     lp_set(lp,lp->root, lp->lp_None,lp->modules);
     lp_set(lp,lp->root, lp->lp_None,lp->_regs);
     lp_set(lp,lp->root, lp->lp_None,lp->_params);
+    lp_set(lp,lp->root, lp->lp_None,lp->strings);
     lp_setk(lp,lp->builtins,lp_string(lp, "MODULES"),lp->modules);
     lp_setk(lp,lp->modules,lp_string(lp, "BUILTINS"),lp->builtins);
     lp_setk(lp,lp->builtins,lp_string(lp, "BUILTINS"),lp->builtins);
@@ -49,6 +92,7 @@ lp_vm *_lp_init(void) {
     lp_setkv(lp, sys, lp_string(lp, "version"), lp_string(lp, "tinypy 1.2+SVN"));
     lp_setk(lp,lp->modules, lp_string(lp, "sys"), sys);
 	lp_setk(lp, sys, lp_string(lp, "path"), lp->path);
+	lp_gc_init(lp);
 	_lp_list_appendx(lp, lp->path->list, lp_string(lp, "."));
     lp->regs = lp->_regs->list->items;
     return lp;
@@ -63,11 +107,14 @@ lp_vm *_lp_init(void) {
  * may be good practice to call this function on shutdown.
  */
 void lp_deinit(LP) {
-    while (lp->root->list->len) {
-        _lp_list_pop(lp,lp->root->list,0,"lp_deinit");
-    }
-    lp->mem_used -= sizeof(lp_vm); 
-    free(lp);
+    lp_allocator mem = lp->mem;
+    /* every object lives in a pool, so dropping the pools frees them all,
+     * cycles and leaked references included. Data objects get their
+     * free_fun called first. */
+    deinit_lp_data(lp);
+    _lp_shape_deinit(lp);
+    deinit_lp_mem(lp);
+    mem.release(mem.ud, lp, sizeof(lp_vm));
 }
 
 /* lp_frame_*/
@@ -87,6 +134,8 @@ void lp_frame(LP,lp_obj* globals,lp_obj* code,lp_obj **ret_dest) {
 	LP_OBJ_INC(code);
     f->cur = (lp_code*)f->code->string.val;
     f->jmp = 0;
+	LP_OBJ_DEC(f->consts);
+	f->consts = 0;
 /*     fprintf(stderr,"lp->cur: %d\n",lp->cur);*/
 	f->regs = regs;
     
@@ -99,9 +148,6 @@ void lp_frame(LP,lp_obj* globals,lp_obj* code,lp_obj **ret_dest) {
     f->regs += LP_REGS_EXTRA;
     
     f->ret_dest = ret_dest;
-    f->lineno = 0;
-	LP_OBJ_DEC(f->line);
-    f->line = lp_string(lp, "");
 	LP_OBJ_DEC(f->name);
     f->name = lp_string(lp, "?");
 	LP_OBJ_DEC(f->fname);
@@ -113,25 +159,83 @@ void lp_frame(LP,lp_obj* globals,lp_obj* code,lp_obj **ret_dest) {
 
 }
 
+/* Function: lp_lineno
+ * Returns the source line a frame is executing, or 0 when unknown.
+ *
+ * The line is looked up in the line table, the last entry of the constant
+ * table of the code, using the offset of the frame's current instruction
+ * from the start of the module body.
+ */
+int lp_lineno(LP, lp_frame_ *f) {
+    lp_obj* lines;
+    const unsigned char *p, *e;
+    lp_code *body;
+    int at, pc = 0, line = 0;
+    if (!f->consts || !f->consts->list->len) { return 0; }
+    lines = f->consts->list->items[f->consts->list->len-1];
+    body = (lp_code*)(lines->string.val + ((lines->string.len+3)&~3));
+    at = (int)(f->cur - body) - 1;
+    p = (const unsigned char*)lines->string.val;
+    e = p + lines->string.len;
+    for (; p < e; p += 2) {
+        if (pc + p[0] > at) { break; }
+        pc += p[0];
+        line += (signed char)p[1];
+    }
+    return line;
+}
+
+/* prints line number row of the file fname, as read from disk */
+static void lp_print_line(LP, lp_obj* fname, int row) {
+    char path[256];
+    FILE *file;
+    int c, n = 1;
+    if (lp_typeof(fname) != LP_STRING || fname->string.len >= 256) { return; }
+    memcpy(path, fname->string.val, fname->string.len);
+    path[fname->string.len] = '\0';
+    file = fopen(path, "rb");
+    if (!file) { return; }
+    while (n < row && (c = getc(file)) != EOF) {
+        if (c == '\n') { n++; }
+    }
+    while ((c = getc(file)) != EOF && c != '\n') {
+        if (c != '\r') { putchar(c); }
+    }
+    fclose(file);
+}
+
 void lp_print_stack(LP) {
-    int i;
+    int i, lineno;
     printf("\n");
     for (i=0; i<=lp->cur; i++) {
-        if (!lp->frames[i].lineno) { continue; }
+        lineno = lp_lineno(lp, &lp->frames[i]);
+        if (!lineno) { continue; }
         printf("File \""); lp_echo(lp,lp->frames[i].fname); printf("\", ");
-        printf("line %d, in ",lp->frames[i].lineno);
+        printf("line %d, in ",lineno);
         lp_echo(lp,lp->frames[i].name); printf("\n ");
-        lp_echo(lp,lp->frames[i].line); printf("\n");
+        lp_print_line(lp,lp->frames[i].fname,lineno); printf("\n");
     }
     printf("\nException:\n"); lp_echo(lp,lp->ex); printf("\n");
 }
 
+/* drops what the registers of frame f hold */
+static void lp_frame_clear(LP, lp_frame_ *f) {
+	for (int i = -LP_REGS_EXTRA; i < f->cregs; i++)
+	{
+		LP_OBJ_DEC(f->regs[i]);
+	}
+    memset(f->regs-LP_REGS_EXTRA,0,(LP_REGS_EXTRA+f->cregs)*sizeof(lp_obj*));
+}
+
 int lp_handle(LP) {
-    int i;
+    int i, j;
     for (i=lp->cur; i>=0; i--) {
         if (lp->frames[i].jmp) { break; }
     }
     if (i >= 0) {
+        /* the frames unwound never return, let go of what they hold, a
+         * MemoryError is often caught to get that memory back */
+        for (j=lp->cur; j>i; j--) { lp_frame_clear(lp, &lp->frames[j]); }
 		LP_OBJ_DEC(lp->oldex);
 		lp->oldex = lp->ex;
 		lp->ex = 0;
@@ -167,7 +271,7 @@ lp_obj* lp_call(LP,lp_obj* self) {
 	lp_obj* params = lp->params;
 	lp_obj* r;
 
-    if (self->type == LP_DICT) {
+    if (lp_typeof(self) == LP_DICT) {
         if (self->dict.dtype == 1) {
             lp_obj *meta;
 			if (lp_lookupx(lp,self,"__new__",&meta)) {
@@ -184,13 +288,14 @@ lp_obj* lp_call(LP,lp_obj* self) {
             LP_META_END;
         }
     }
-    if (self->type == LP_FNC && !(self->fnc.ftype&1)) {
+    if (lp_typeof(self) == LP_FNC && !(self->fnc.ftype&1)) {
         lp_obj* r = lp_tcall(lp,self);
         return r;
     }
-    if (self->type == LP_FNC) {
+    if (lp_typeof(self) == LP_FNC) {
         lp_obj* dest = lp->lp_None;
         lp_frame(lp,self->fnc.info->globals,self->fnc.info->code,&dest);
+        lp->frames[lp->cur].consts = self->fnc.info->consts; LP_OBJ_INC(self->fnc.info->consts);
         if ((self->fnc.ftype&2)) {
             lp->frames[lp->cur].regs[0] = params; LP_OBJ_INC(params);
             _lp_list_insert(lp,params->list,0,self->fnc.info->self);
@@ -198,10 +303,10 @@ lp_obj* lp_call(LP,lp_obj* self) {
             lp->frames[lp->cur].regs[0] = params; LP_OBJ_INC(params);
         }
 		if (!lp_run(lp, lp->cur)) return 0;
-		if (!dest) return 0;
-        RETURN_LP_OBJ(dest);
+		/* lp_return gave dest its reference */
+		return dest;
     }
-    lp_params_v(lp,1,self); lpf_print(lp);
+    lpf_print(lp,1,&self);
     lp_raise(0,lp_string(lp, "(lp_call) TypeError: object is not callable"));
 }
 
@@ -209,30 +314,31 @@ lp_obj* lp_call(LP,lp_obj* self) {
 void lp_return(LP, lp_obj* v) {
     lp_obj **dest = lp->frames[lp->cur].ret_dest;
     if (dest) { *dest = v; LP_OBJ_INC(v); }
-	for (int i = -LP_REGS_EXTRA; i < lp->frames[lp->cur].cregs; i++)
-	{
-		LP_OBJ_DEC(lp->frames[lp->cur].regs[i]);
-	}
-    memset(lp->frames[lp->cur].regs-LP_REGS_EXTRA,0,(LP_REGS_EXTRA+lp->frames[lp->cur].cregs)*sizeof(lp_obj*));
+    lp_frame_clear(lp, &lp->frames[lp->cur]);
     lp->cur -= 1;
 }
 
 enum {
     LP_IEOF,LP_IADD,LP_ISUB,LP_IMUL,LP_IDIV,LP_IPOW,LP_IBITAND,LP_IBITOR,LP_ICMP,LP_IGET,LP_ISET,
-    LP_INUMBER,LP_ISTRING,LP_IGGET,LP_IGSET,LP_IMOVE,LP_IDEF,LP_IPASS,LP_IJUMP,LP_ICALL,
+    LP_IGGET,LP_IGSET,LP_IMOVE,LP_IDEF,LP_IPASS,LP_IJUMP,LP_ICALL,
     LP_IRETURN,LP_IIF,LP_IDEBUG,LP_IEQ,LP_ILE,LP_ILT,LP_IDICT,LP_ILIST,LP_INONE,LP_ILEN,
-    LP_ILINE,LP_IPARAMS,LP_IIGET,LP_IFILE,LP_INAME,LP_INE,LP_IHAS,LP_IRAISE,LP_ISETJMP,
+    LP_IPARAMS,LP_IIGET,LP_IFILE,LP_INAME,LP_INE,LP_IHAS,LP_IRAISE,LP_ISETJMP,
     LP_IMOD,LP_ILSH,LP_IRSH,LP_IITER,LP_IDEL,LP_IREGS,LP_IBITXOR, LP_IIFN, 
-    LP_INOT, LP_IBITNOT,
+    LP_INOT, LP_IBITNOT, LP_ICONST, LP_ICONSTS,
+    LP_IIFLT, LP_IIFLE, LP_IIFEQ, LP_IIFNE, LP_ILOADMETHOD, LP_ICALLMETHOD,
+    LP_IGETATTR, LP_ISETATTR,
+    /* quickened variants, never emitted by the encoder */
+    LP_IADD_II, LP_ISUB_II, LP_ILT_II, LP_ILE_II, LP_IEQ_II, LP_INE_II,
+    LP_IGET_LI, LP_IGET_DS, LP_IGET_DI, LP_IITER_RANGE, LP_IITER_DICT,
     LP_ITOTAL
 };
 
 /* char *lp_strings[LP_ITOTAL] = {
-       "EOF","ADD","SUB","MUL","DIV","POW","BITAND","BITOR","CMP","GET","SET","NUM",
-       "STR","GGET","GSET","MOVE","DEF","PASS","JUMP","CALL","RETURN","IF","DEBUG",
-       "EQ","LE","LT","DICT","LIST","NONE","LEN","LINE","PARAMS","IGET","FILE",
+       "EOF","ADD","SUB","MUL","DIV","POW","BITAND","BITOR","CMP","GET","SET",
+       "GGET","GSET","MOVE","DEF","PASS","JUMP","CALL","RETURN","IF","DEBUG",
+       "EQ","LE","LT","DICT","LIST","NONE","LEN","PARAMS","IGET","FILE",
        "NAME","NE","HAS","RAISE","SETJMP","MOD","LSH","RSH","ITER","DEL","REGS",
-       "BITXOR", "IFN", "NOT", "BITNOT",
+       "BITXOR", "IFN", "NOT", "BITNOT", "CONST", "CONSTS",
    };*/
 
 #define VA ((int)e->regs.a)
@@ -245,152 +351,469 @@ enum {
 #define SVBC (short)(((VB<<8)+VC))
 #define SR(v) f->cur = cur; return(v);
 
+/* Dispatch for lp_step. With LP_THREADED each handler jumps straight to the
+ * next one through a label table (GCC computed goto), otherwise a plain
+ * switch is used. lp->ex is only tested after handlers that can raise.
+ */
+#if defined(LP_THREADED_DISPATCH) && defined(__GNUC__)
+#define LP_THREADED
+#endif
+
+#ifdef LP_THREADED
+#define LP_CASE(op) L_##op
+#define LP_DISPATCH() { e = cur; goto *labels[e->i]; }
+#else
+#define LP_CASE(op) case op
+#define LP_DISPATCH() { e = cur; goto dispatch; }
+#endif
+#define LP_NEXT() { cur += 1; LP_DISPATCH(); }
+
+/* Quickening: a generic handler that sees operand types one of its
+ * specialized variants handles rewrites the instruction in the code to that
+ * variant. The variant checks the same guard and rewrites it back to the
+ * generic opcode when it fails.
+ */
+#define LP_II (lp_is_fixnum(RB) && lp_is_fixnum(RC))
+
+/* Fused compare and branch: falls through past the OP_JUMP that follows
+ * when the comparison holds and takes that jump otherwise.
+ */
+#define LP_IF_CMP(fix,cmp) { \
+	int t_ = LP_II ? (fix) : (cmp); \
+	cur += 1; if (lp->ex) { SR(1); } \
+	if (t_) { cur += 1; } else { e = cur; cur += SVBC; } \
+	LP_DISPATCH(); }
+#define LP_QUICKEN(cond,op) if (cond) { e->i = op; }
+#define LP_GUARD(cond,op) if (!(cond)) { e->i = op; LP_DISPATCH(); }
+#define LP_NEXT_CHECK() { cur += 1; if (lp->ex) { SR(1); } LP_DISPATCH(); }
+
+/* Attribute caches: an object whose shape and meta are those the struct
+ * ACache after the instruction was filled for, with no meta changed since,
+ * has the key where the cache says. The cache is only 4-byte aligned in
+ * the code, so the handlers work on a copy of it.
+ */
+#define LP_ATTR_HIT(o,c) (lp_typeof(o) == LP_DICT && (o)->dict.dtype == 2 && \
+	(c)->shape && (o)->dict.val->shape == (c)->shape && \
+	(o)->dict.val->meta == (c)->meta && (c)->mver == lp->meta_version)
+
+/* looks k up on the object self the way lp_get (or lp_set, with set) would
+ * and fills in c, and the cache at in the code, with the result; 0 when
+ * self is no object with a shape, a hook like __get__ handles the key, or
+ * the lookup makes a new value */
+static int lp_attr_fill(LP, struct ACache *c, lp_code *at, lp_obj* self, lp_obj* k, int set) {
+	_lp_dict *d;
+	lp_obj *meta, *v = 0;
+	int n;
+	if (lp_typeof(self) != LP_DICT || self->dict.dtype != 2 || !self->dict.val->shape) { return 0; }
+	d = self->dict.val;
+	meta = d->meta;
+	if (meta && lp_typeof(meta) == LP_DICT && !meta->dict.val->is_meta) { return 0; }
+	if (lp_lookupx(lp, self, set ? "__set__" : "__get__", &v)) {
+		LP_OBJ_DEC(v);
+		return 0;
+	}
+	if (lp->ex) { return 0; }
+	n = _lp_dict_find(lp, d, k);
+	v = 0;
+	if (n < 0 && !set) {
+		/* same depth as the lookup through self in lp_get */
+		if (!meta || lp_typeof(meta) != LP_DICT || !lp_lookup_(lp, meta, k, &v, 7)) { return 0; }
+		if (lp_typeof(v) == LP_FNC && (v->fnc.ftype&2)) {
+			LP_OBJ_DEC(v);
+			return 0;
+		}
+		n = lp_typeof(v) == LP_FNC ? -2 : -1;
+		/* the class keeps it, and changing that moves the meta_version */
+		LP_OBJ_DEC(v);
+	}
+	c->shape = d->shape;
+	c->meta = meta;
+	c->mver = lp->meta_version;
+	c->val = v;
+	c->n = n;
+	memcpy(at, c, sizeof(*c));
+	return 1;
+}
+
 
 int lp_step(LP) {
     lp_frame_ *f = &lp->frames[lp->cur];
     lp_obj **regs = f->regs;
     lp_code *cur = f->cur;
+	lp_code *e;
 	lp_obj *r;
-    while(1) {
+#ifdef LP_THREADED
+	static void *labels[256] = {
+		[0 ... 255] = &&L_DEFAULT,
+		[LP_IEOF] = &&L_LP_IEOF, [LP_IADD] = &&L_LP_IADD, [LP_ISUB] = &&L_LP_ISUB,
+		[LP_IMUL] = &&L_LP_IMUL, [LP_IDIV] = &&L_LP_IDIV, [LP_IPOW] = &&L_LP_IPOW,
+		[LP_IBITAND] = &&L_LP_IBITAND, [LP_IBITOR] = &&L_LP_IBITOR, [LP_ICMP] = &&L_LP_ICMP,
+		[LP_IGET] = &&L_LP_IGET, [LP_ISET] = &&L_LP_ISET,
+		[LP_IGGET] = &&L_LP_IGGET, [LP_IGSET] = &&L_LP_IGSET,
+		[LP_IMOVE] = &&L_LP_IMOVE, [LP_IDEF] = &&L_LP_IDEF, [LP_IPASS] = &&L_LP_IPASS,
+		[LP_IJUMP] = &&L_LP_IJUMP, [LP_ICALL] = &&L_LP_ICALL, [LP_IRETURN] = &&L_LP_IRETURN,
+		[LP_IIF] = &&L_LP_IIF, [LP_IDEBUG] = &&L_LP_IDEBUG, [LP_IEQ] = &&L_LP_IEQ,
+		[LP_ILE] = &&L_LP_ILE, [LP_ILT] = &&L_LP_ILT, [LP_IDICT] = &&L_LP_IDICT,
+		[LP_ILIST] = &&L_LP_ILIST, [LP_INONE] = &&L_LP_INONE, [LP_ILEN] = &&L_LP_ILEN,
+		[LP_IPARAMS] = &&L_LP_IPARAMS, [LP_IIGET] = &&L_LP_IIGET,
+		[LP_IFILE] = &&L_LP_IFILE, [LP_INAME] = &&L_LP_INAME, [LP_INE] = &&L_LP_INE,
+		[LP_IHAS] = &&L_LP_IHAS, [LP_IRAISE] = &&L_LP_IRAISE, [LP_ISETJMP] = &&L_LP_ISETJMP,
+		[LP_IMOD] = &&L_LP_IMOD, [LP_ILSH] = &&L_LP_ILSH, [LP_IRSH] = &&L_LP_IRSH,
+		[LP_IITER] = &&L_LP_IITER, [LP_IDEL] = &&L_LP_IDEL, [LP_IREGS] = &&L_LP_IREGS,
+		[LP_IBITXOR] = &&L_LP_IBITXOR, [LP_IIFN] = &&L_LP_IIFN, [LP_INOT] = &&L_LP_INOT,
+		[LP_IBITNOT] = &&L_LP_IBITNOT, [LP_ICONST] = &&L_LP_ICONST, [LP_ICONSTS] = &&L_LP_ICONSTS,
+		[LP_IIFLT] = &&L_LP_IIFLT, [LP_IIFLE] = &&L_LP_IIFLE, [LP_IIFEQ] = &&L_LP_IIFEQ, [LP_IIFNE] = &&L_LP_IIFNE,
+		[LP_ILOADMETHOD] = &&L_LP_ILOADMETHOD, [LP_ICALLMETHOD] = &&L_LP_ICALLMETHOD,
+		[LP_IGETATTR] = &&L_LP_IGETATTR, [LP_ISETATTR] = &&L_LP_ISETATTR,
+		[LP_IADD_II] = &&L_LP_IADD_II, [LP_ISUB_II] = &&L_LP_ISUB_II, [LP_ILT_II] = &&L_LP_ILT_II,
+		[LP_ILE_II] = &&L_LP_ILE_II, [LP_IEQ_II] = &&L_LP_IEQ_II, [LP_INE_II] = &&L_LP_INE_II,
+		[LP_IGET_LI] = &&L_LP_IGET_LI, [LP_IGET_DS] = &&L_LP_IGET_DS, [LP_IITER_RANGE] = &&L_LP_IITER_RANGE,
+		[LP_IITER_DICT] = &&L_LP_IITER_DICT, [LP_IGET_DI] = &&L_LP_IGET_DI,
+	};
+#endif
 
-    lp_code *e = cur;
 	if (lp->ex) { SR(1); }
+    LP_DISPATCH();
+#ifndef LP_THREADED
+dispatch:
     switch (e->i) {
-		case LP_IEOF: lp_return(lp, lp->lp_None); SR(0); break;
-		case LP_IADD: r = lp_add(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_ISUB: r = lp_sub(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IMUL: r = lp_mul(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IDIV: r = lp_div(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IPOW: r = lp_pow(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IBITAND: r = lp_bitwise_and(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IBITOR:  r = lp_bitwise_or(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IBITXOR:  r = lp_bitwise_xor(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IMOD:  r = lp_mod(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_ILSH:  r = lp_lsh(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IRSH:  r = lp_rsh(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_ICMP: r = lp_number_from_int(lp, lp_cmp(lp, RB, RC)); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_INE: r = lp_number_from_int(lp, lp_cmp(lp, RB, RC) != 0); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IEQ: r = lp_number_from_int(lp, lp_cmp(lp, RB, RC) == 0); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_ILE: r = lp_number_from_int(lp, lp_cmp(lp, RB, RC) <= 0); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_ILT: r = lp_number_from_int(lp, lp_cmp(lp, RB, RC) < 0); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IBITNOT:  r = lp_bitwise_not(lp, RB); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_INOT: r = lp_number_from_int(lp, !lp_bool(lp, RB)); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IPASS: break;
-        case LP_IIF: if (lp_bool(lp,RA)) { cur += 1; } break;
-        case LP_IIFN: if (!lp_bool(lp,RA)) { cur += 1; } break;
-		case LP_IGET: r = lp_get(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-        case LP_IITER:
+#endif
+		LP_CASE(LP_IEOF): lp_return(lp, lp->lp_None); SR(0);
+		LP_CASE(LP_IADD): LP_QUICKEN(LP_II, LP_IADD_II); r = lp_add(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_ISUB): LP_QUICKEN(LP_II, LP_ISUB_II); r = lp_sub(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IMUL): r = lp_mul(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IDIV): r = lp_div(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IPOW): r = lp_pow(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IBITAND): r = lp_bitwise_and(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IBITOR):  r = lp_bitwise_or(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IBITXOR):  r = lp_bitwise_xor(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IMOD):  r = lp_mod(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_ILSH):  r = lp_lsh(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IRSH):  r = lp_rsh(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_ICMP): r = lp_number_from_int(lp, lp_cmp(lp, RB, RC)); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_INE): LP_QUICKEN(LP_II, LP_INE_II); r = lp_number_from_int(lp, lp_cmp(lp, RB, RC) != 0); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IEQ): LP_QUICKEN(LP_II, LP_IEQ_II); r = lp_number_from_int(lp, lp_cmp(lp, RB, RC) == 0); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_ILE): LP_QUICKEN(LP_II, LP_ILE_II); r = lp_number_from_int(lp, lp_cmp(lp, RB, RC) <= 0); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_ILT): LP_QUICKEN(LP_II, LP_ILT_II); r = lp_number_from_int(lp, lp_cmp(lp, RB, RC) < 0); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IADD_II): LP_GUARD(LP_II, LP_IADD); r = lp_number_from_llong(lp, (long long)lp_fixnum_val(RB) + lp_fixnum_val(RC)); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_ISUB_II): LP_GUARD(LP_II, LP_ISUB); r = lp_number_from_llong(lp, (long long)lp_fixnum_val(RB) - lp_fixnum_val(RC)); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_INE_II): LP_GUARD(LP_II, LP_INE); r = lp_number_from_int(lp, RB != RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT();
+		LP_CASE(LP_IEQ_II): LP_GUARD(LP_II, LP_IEQ); r = lp_number_from_int(lp, RB == RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT();
+		LP_CASE(LP_ILE_II): LP_GUARD(LP_II, LP_ILE); r = lp_number_from_int(lp, lp_fixnum_val(RB) <= lp_fixnum_val(RC)); LP_OBJ_DEC(RA); RA = r; LP_NEXT();
+		LP_CASE(LP_ILT_II): LP_GUARD(LP_II, LP_ILT); r = lp_number_from_int(lp, lp_fixnum_val(RB) < lp_fixnum_val(RC)); LP_OBJ_DEC(RA); RA = r; LP_NEXT();
+		LP_CASE(LP_IBITNOT):  r = lp_bitwise_not(lp, RB); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_INOT): r = lp_number_from_int(lp, !lp_bool(lp, RB)); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IPASS): LP_NEXT();
+        LP_CASE(LP_IIF): if (lp_bool(lp,RA)) { cur += 1; } LP_NEXT_CHECK();
+        LP_CASE(LP_IIFN): if (!lp_bool(lp,RA)) { cur += 1; } LP_NEXT_CHECK();
+		LP_CASE(LP_IIFLT): LP_IF_CMP(lp_fixnum_val(RB) < lp_fixnum_val(RC), lp_cmp(lp, RB, RC) < 0);
+		LP_CASE(LP_IIFLE): LP_IF_CMP(lp_fixnum_val(RB) <= lp_fixnum_val(RC), lp_cmp(lp, RB, RC) <= 0);
+		LP_CASE(LP_IIFEQ): LP_IF_CMP(RB == RC, lp_cmp(lp, RB, RC) == 0);
+		LP_CASE(LP_IIFNE): LP_IF_CMP(RB != RC, lp_cmp(lp, RB, RC) != 0);
+		LP_CASE(LP_IGET):
+			LP_QUICKEN(lp_typeof(RB) == LP_LIST && lp_is_fixnum(RC), LP_IGET_LI);
+			LP_QUICKEN(lp_typeof(RB) == LP_DICT && RB->dict.dtype != 2 && lp_typeof(RC) == LP_STRING, LP_IGET_DS);
+			LP_QUICKEN(lp_typeof(RB) == LP_DICT && RB->dict.dtype != 2 && lp_is_fixnum(RC), LP_IGET_DI);
+		get_generic:
+			r = lp_get(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IGET_LI): {
+			_lp_list *l;
+			int n;
+			LP_GUARD(lp_typeof(RB) == LP_LIST && lp_is_fixnum(RC), LP_IGET);
+			l = RB->list;
+			n = lp_fixnum_val(RC);
+			n = (n<0?l->len+n:n);
+			if (n < 0 || n >= l->len) { goto get_generic; }
+			r = l->items[n]; LP_OBJ_INC(r); LP_OBJ_DEC(RA); RA = r;
+			}
+			LP_NEXT_CHECK();
+		LP_CASE(LP_IGET_DS): {
+			int n;
+			LP_GUARD(lp_typeof(RB) == LP_DICT && RB->dict.dtype != 2 && lp_typeof(RC) == LP_STRING, LP_IGET);
+			n = _lp_dict_find(lp, RB->dict.val, RC);
+			if (n < 0) { goto get_generic; }
+			r = RB->dict.val->items[n].val; LP_OBJ_INC(r); LP_OBJ_DEC(RA); RA = r;
+			}
+			LP_NEXT_CHECK();
+		LP_CASE(LP_IGET_DI): {
+			int n;
+			LP_GUARD(lp_typeof(RB) == LP_DICT && RB->dict.dtype != 2 && lp_is_fixnum(RC), LP_IGET);
+			n = _lp_dict_find(lp, RB->dict.val, RC);
+			if (n < 0) { goto get_generic; }
+			r = RB->dict.val->items[n].val; LP_OBJ_INC(r); LP_OBJ_DEC(RA); RA = r;
+			}
+			LP_NEXT_CHECK();
+        LP_CASE(LP_IITER):
+			LP_QUICKEN(lp_typeof(RB) == LP_RANGE && lp_is_fixnum(RC), LP_IITER_RANGE);
+			/* RC counts the items for the generic loop and is the position
+			 * in the entries for dicts, so those go to their variant now */
+			LP_GUARD(!((lp_typeof(RB) == LP_DICT || _lp_dict_view(RB)) && lp_is_fixnum(RC)), LP_IITER_DICT);
             if (lp_type_number(lp, RC) < lp_lenx(lp,RB)) {
 				r = lp_iter(lp,RB,RC);
 				LP_OBJ_DEC(RA);
 				RA = r;
-				switch (RC->type)
+				switch (lp_typeof(RC))
 				{
 				case LP_INT:
-					RC->integer ++;
+					r = lp_number_from_int(lp, lp_integer(RC) + 1);
+					LP_OBJ_DEC(RC);
+					RC = r;
 					break;
 				case LP_DOUBLE:
-					RC->doublen += 1;
+					r = lp_number_from_double(lp, lp_doublen(RC) + 1);
+					LP_OBJ_DEC(RC);
+					RC = r;
 					break;
 				}
 
                 cur += 1;
             }
-            break;
-		case LP_IHAS: r = lp_has(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_IIGET: lp_iget(lp, &RA, RB, RC); break;
-        case LP_ISET: lp_set(lp,RA,RB,RC); break;
-        case LP_IDEL: lp_del(lp,RA,RB); break;
-		case LP_IMOVE:  r = RB; LP_OBJ_INC(r); LP_OBJ_DEC(RA); RA = r; break;
-        case LP_INUMBER:
-
-			LP_OBJ_DEC(RA);
-			if (VB)
-			{
-				RA = lp_number_from_double(lp, *(double*)(*++cur).string.val);
-				cur += sizeof(double) / 4;
+            LP_NEXT_CHECK();
+		LP_CASE(LP_IITER_RANGE): {
+			/* counted loop: RC is the index, the item is computed in place */
+			int n;
+			LP_GUARD(lp_typeof(RB) == LP_RANGE && lp_is_fixnum(RC), LP_IITER);
+			n = lp_fixnum_val(RC);
+			if (n < RB->range.len) {
+				r = lp_number_from_llong(lp, RB->range.start + (long long)n*RB->range.step);
+				LP_OBJ_DEC(RA);
+				RA = r;
+				RC = lp_number_from_int(lp, n + 1);
+				cur += 1;
 			}
-			else
-			{
-				RA = lp_number_from_int(lp, *(int*)(*++cur).string.val);
-				cur += sizeof(int) / 4;
 			}
-            continue;
-        case LP_ISTRING: {
-
-			LP_OBJ_DEC(RA);
-            int a = (*(cur+1)).string.val-f->code->string.val;
-			int l = UVBC;
-            RA = lp_string_sub(lp,f->code,a,a+l),
-            cur += (l/4)+1;
+			LP_NEXT_CHECK();
+		LP_CASE(LP_IITER_DICT): {
+			/* RC is where the next entry is looked for, so nothing in the
+			 * dict changes and loops over it do not disturb each other */
+			int n, kind;
+			_lp_dict *d;
+			LP_GUARD((lp_typeof(RB) == LP_DICT || _lp_dict_view(RB)) && lp_is_fixnum(RC), LP_IITER);
+			if (lp_typeof(RB) == LP_DICT) {
+				kind = LP_VIEW_KEYS;
+				d = RB->dict.val;
+			} else {
+				kind = RB->data.magic;
+				d = ((lp_obj*)RB->data.val)->dict.val;
+			}
+			n = _lp_dict_next(d, lp_fixnum_val(RC));
+			if (n >= 0) {
+				r = _lp_dict_view_item(lp, kind, &d->items[n], RA);
+				if (r != RA) { LP_OBJ_DEC(RA); RA = r; }
+				else { LP_OBJ_DEC(r); }
+				RC = lp_number_from_int(lp, n + 1);
+				cur += 1;
+			}
+			}
+			LP_NEXT_CHECK();
+		LP_CASE(LP_IHAS): r = lp_has(lp, RB, RC); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_IIGET): lp_iget(lp, &RA, RB, RC); LP_NEXT_CHECK();
+        LP_CASE(LP_ISET): lp_set(lp,RA,RB,RC); LP_NEXT_CHECK();
+        LP_CASE(LP_IDEL): lp_del(lp,RA,RB); LP_NEXT_CHECK();
+		LP_CASE(LP_IMOVE):  r = RB; LP_OBJ_INC(r); LP_OBJ_DEC(RA); RA = r; LP_NEXT();
+		LP_CASE(LP_ICONST): r = f->consts->list->items[UVBC]; LP_OBJ_INC(r); LP_OBJ_DEC(RA); RA = r; LP_NEXT();
+        LP_CASE(LP_ICONSTS): {
+			int n = UVBC, i;
+			lp_obj* consts = lp_list(lp);
+			for (i = 0; i < n; i++) {
+				int l;
+				e = ++cur;
+				l = UVBC;
+				switch (e->i) {
+				case CONST_INT: r = lp_number_from_int(lp, *(int*)(cur+1)->string.val); break;
+				case CONST_DOUBLE: r = lp_number_from_double(lp, lp_code_double(cur+1)); break;
+				case CONST_STRING:
+					if (l - 1 <= LP_INTERN_MAX && lp_is_name((cur+1)->string.val, l - 1)) {
+						r = lp_intern(lp, (cur+1)->string.val, l - 1);
+						break;
+					}
+					/* fall through */
+				default: {
+					int a = (cur+1)->string.val-f->code->string.val;
+					r = lp_string_sub(lp,f->code,a,a+l-(e->i == CONST_STRING));
+					}
+					break;
+				}
+				_lp_list_appendx(lp, consts->list, r);
+				cur += (l+3)/4;
+			}
+			LP_OBJ_DEC(f->consts);
+			f->consts = consts;
+			}
+            LP_NEXT_CHECK();
+		LP_CASE(LP_IDICT): r = lp_dict_n(lp, VC / 2, &RB); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+		LP_CASE(LP_ILIST): r = lp_list_n(lp, VC, &RB); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+        LP_CASE(LP_IPARAMS):
+			/* a vector call C function is called straight from the argument
+			 * registers, lp->params is left alone */
+			if ((cur+1)->i == LP_ICALL) {
+				lp_obj* fn = regs[(cur+1)->regs.b];
+				if (lp_typeof(fn) == LP_FNC && fn->fnc.ftype == 4) {
+					r = ((lp_obj *(*)(lp_vm *,int,lp_obj **))fn->fnc.cfnc)(lp, VC, &RB);
+					e = ++cur;
+					LP_OBJ_DEC(RA); RA = r;
+					LP_NEXT_CHECK();
+				}
+			}
+			lp_params_n(lp,VC,&RB); LP_NEXT_CHECK();
+		LP_CASE(LP_ILEN): r = lp_len(lp, RB); LP_OBJ_DEC(RA); RA = r; LP_NEXT_CHECK();
+        LP_CASE(LP_IJUMP):
+            /* loop back edges are safepoints for the cycle collector */
+            if (SVBC < 0) {
+                LP_GC_CHECK(lp);
+                /* the collector may run out of memory */
+                if (lp->ex) { SR(1); }
             }
-            break;
-		case LP_IDICT: r = lp_dict_n(lp, VC / 2, &RB); LP_OBJ_DEC(RA); RA = r; break;
-		case LP_ILIST: r = lp_list_n(lp, VC, &RB); LP_OBJ_DEC(RA); RA = r; break;
-        case LP_IPARAMS: lp_params_n(lp,VC,&RB); break;
-		case LP_ILEN: r = lp_len(lp, RB); LP_OBJ_DEC(RA); RA = r; break;
-        case LP_IJUMP: cur += SVBC; continue; break;
-        case LP_ISETJMP: f->jmp = SVBC?cur+SVBC:0; break;
-        case LP_ICALL:
+            cur += SVBC; LP_DISPATCH();
+        LP_CASE(LP_ISETJMP): f->jmp = SVBC?cur+SVBC:0; LP_NEXT();
+        LP_CASE(LP_ICALL):
 
 			f->cur = cur + 1;  r = lp_call(lp, RB); LP_OBJ_DEC(RA); RA = r;
-            return 0; break;
-        case LP_IGGET:
-            if (!lp_iget(lp,&r,f->globals,RB)) {
-                r = lp_get(lp,lp->builtins,RB);
-            }
+            return 0;
+		LP_CASE(LP_ILOADMETHOD): {
+			/* RA = method, RA+1 = self, or None when RA needs no self */
+			struct ACache c;
+			lp_obj* s = lp->lp_None;
+			memcpy(&c, cur+1, sizeof(c));
+			cur += ACACHE_WORDS;
+			if (LP_ATTR_HIT(RB, &c) || lp_attr_fill(lp, &c, e+1, RB, RC, 0)) {
+				if (c.n >= 0) { r = RB->dict.val->items[c.n].val; }
+				else { r = (lp_obj*)c.val; if (c.n == -2) { s = RB; } }
+				LP_OBJ_INC(r);
+				LP_OBJ_INC(s);
+			} else {
+				r = lp_get_method(lp, RB, RC, &s);
+			}
+			LP_OBJ_DEC(RA); RA = r;
+			LP_OBJ_DEC(regs[VA+1]); regs[VA+1] = s;
+			LP_NEXT_CHECK();
+			}
+		LP_CASE(LP_ICALLMETHOD): {
+			/* the VC arguments follow the method and self set up by LOADMETHOD */
+			lp_obj* fn = RB;
+			lp_obj** argv = &regs[VB+1];
+			int argc = VC+1;
+			if (*argv == lp->lp_None) { argv++; argc--; }
+			if (lp_typeof(fn) == LP_FNC && fn->fnc.ftype == 4) {
+				r = ((lp_obj *(*)(lp_vm *,int,lp_obj **))fn->fnc.cfnc)(lp, argc, argv);
+				LP_OBJ_DEC(RA); RA = r;
+				LP_NEXT_CHECK();
+			}
+			lp_params_n(lp, argc, argv);
+			f->cur = cur + 1; r = lp_call(lp, fn); LP_OBJ_DEC(RA); RA = r;
+			return 0;
+			}
+		LP_CASE(LP_IGETATTR): {
+			/* RB.RC, RC a constant string */
+			struct ACache c;
+			memcpy(&c, cur+1, sizeof(c));
+			cur += ACACHE_WORDS;
+			if (lp_typeof(RB) == LP_DICT && RB->dict.dtype != 2) {
+				int n = _lp_dict_find(lp, RB->dict.val, RC);
+				if (n < 0) { goto getattr_generic; }
+				r = RB->dict.val->items[n].val; LP_OBJ_INC(r);
+			} else if (LP_ATTR_HIT(RB, &c) || lp_attr_fill(lp, &c, e+1, RB, RC, 0)) {
+				if (c.n >= 0) { r = RB->dict.val->items[c.n].val; LP_OBJ_INC(r); }
+				else if (c.n == -1) { r = (lp_obj*)c.val; LP_OBJ_INC(r); }
+				else { lp_obj* a[2]; a[0] = (lp_obj*)c.val; a[1] = RB; r = lpf_bind(lp, 2, a); }
+			} else {
+			getattr_generic:
+				r = lp_get(lp, RB, RC);
+			}
+			LP_OBJ_DEC(RA); RA = r;
+			}
+			LP_NEXT_CHECK();
+		LP_CASE(LP_ISETATTR): {
+			/* RA.RB = RC, RB a constant string */
+			struct ACache c;
+			memcpy(&c, cur+1, sizeof(c));
+			cur += ACACHE_WORDS;
+			if (lp_typeof(RA) == LP_DICT && RA->dict.dtype != 2) {
+				_lp_dict_set(lp, RA->dict.val, RB, RC);
+			} else if (LP_ATTR_HIT(RA, &c) || lp_attr_fill(lp, &c, e+1, RA, RB, 1)) {
+				_lp_dict *d = RA->dict.val;
+				if (c.n >= 0) {
+					lp_obj* v = d->items[c.n].val;
+					d->items[c.n].val = RC; LP_OBJ_INC(RC);
+					LP_DICT_CHANGED(lp, d);
+					LP_OBJ_DEC(v);
+				} else {
+					_lp_dict_set(lp, d, RB, RC);
+				}
+			} else {
+				lp_set(lp, RA, RB, RC);
+			}
+			}
+			LP_NEXT_CHECK();
+        LP_CASE(LP_IGGET): {
+			struct GCache c;
+			uint64_t gver = f->globals->dict.val->version, bver = lp->builtins->dict.val->version;
+			memcpy(&c, cur+1, sizeof(c));
+			if (c.gver == gver && c.bver == bver) {
+				r = (lp_obj*)c.val;
+				LP_OBJ_INC(r);
+			} else {
+				lp_obj* k = f->consts->list->items[UVBC];
+				if (!lp_iget(lp,&r,f->globals,k)) {
+					r = lp_get(lp,lp->builtins,k);
+				}
+				if (!lp->ex) {
+					c.gver = gver;
+					c.bver = bver;
+					c.val = r;
+					memcpy(cur+1, &c, sizeof(c));
+				}
+			}
 			LP_OBJ_DEC(RA);
 			RA = r;
-            break;
-        case LP_IGSET: lp_set(lp,f->globals,RA,RB); break;
-        case LP_IDEF: {
+			cur += GCACHE_WORDS;
+			}
+            LP_NEXT_CHECK();
+        LP_CASE(LP_IGSET): lp_set(lp,f->globals,RA,RB); LP_NEXT_CHECK();
+        LP_CASE(LP_IDEF): {
 
             int a = (*(cur+1)).string.val-f->code->string.val;
 			lp_obj* c = lp_string_sub(lp, f->code, a, a + (SVBC - 1) * 4);
 			r = lp_def(lp,c,f->globals);
+			r->fnc.info->consts = f->consts;
+			LP_OBJ_INC(f->consts);
 			LP_OBJ_DEC(RA);
 			RA = r;
 			LP_OBJ_DEC(c);
-            cur += SVBC; continue;
+            cur += SVBC; if (lp->ex) { SR(1); } LP_DISPATCH();
             }
-            break;
             
-        case LP_IRETURN: lp_return(lp,RA); SR(0); break;
-		case LP_IRAISE: LP_OBJ_DEC(lp->ex); lp->ex = RA; LP_OBJ_INC(lp->ex); break;
-        case LP_IDEBUG:
+        LP_CASE(LP_IRETURN): lp_return(lp,RA); SR(0);
+		LP_CASE(LP_IRAISE): LP_OBJ_DEC(lp->ex); lp->ex = RA; LP_OBJ_INC(lp->ex); LP_NEXT_CHECK();
+        LP_CASE(LP_IDEBUG):
 			{
-				lp_obj* a = lp_string(lp, "DEBUG:");
-				lp_obj* b = lp_number_from_int(lp, VA);
-				lp_params_v(lp, 3, a, b, RA);
-				LP_OBJ_DEC(a);
-				LP_OBJ_DEC(b);
-				lpf_print(lp);
+				lp_obj* a[3];
+				a[0] = lp_string(lp, "DEBUG:");
+				a[1] = lp_number_from_int(lp, VA);
+				a[2] = RA;
+				r = lpf_print(lp, 3, a);
+				LP_OBJ_DEC(a[0]);
+				LP_OBJ_DEC(a[1]);
+				LP_OBJ_DEC(r);
 			}
-            break;
-		case LP_INONE: LP_OBJ_DEC(RA); RA = lp->lp_None; LP_OBJ_INC(lp->lp_None); break;
-        case LP_ILINE:
-
-            ;
-            int a = (*(cur+1)).string.val-f->code->string.val;
-			LP_OBJ_DEC(f->line);
-            f->line = lp_string_sub(lp,f->code,a,a+VA*4-1);
-/*             fprintf(stderr,"%7d: %s\n",UVBC,f->line.string.val);*/
-            cur += VA; f->lineno = UVBC;
-            break;
-		case LP_IFILE: LP_OBJ_DEC(f->fname); f->fname = RA; LP_OBJ_INC(RA); break;
-		case LP_INAME: LP_OBJ_DEC(f->name); f->name = RA; LP_OBJ_INC(RA); break;
-        case LP_IREGS: f->cregs = VA; break;
+            LP_NEXT_CHECK();
+		LP_CASE(LP_INONE): LP_OBJ_DEC(RA); RA = lp->lp_None; LP_OBJ_INC(lp->lp_None); LP_NEXT();
+		LP_CASE(LP_IFILE): LP_OBJ_DEC(f->fname); f->fname = RA; LP_OBJ_INC(RA); LP_NEXT();
+		LP_CASE(LP_INAME): LP_OBJ_DEC(f->name); f->name = RA; LP_OBJ_INC(RA); LP_NEXT();
+        LP_CASE(LP_IREGS): f->cregs = VA; LP_NEXT();
+#ifdef LP_THREADED
+        L_DEFAULT:
+#else
         default:
+#endif
             lp_raise(1,lp_string(lp, "(lp_step) RuntimeError: invalid instruction"));
-            break;
-    }
-
-    cur += 1;
+#ifndef LP_THREADED
     }
+#endif
     SR(0);
 }
 
-#define debug(fmt, ...) { lp_obj* t = lp_printf(lp, "%d : "fmt, (int)(cur-begin), __VA_ARGS__); _lp_list_appendx(lp, out->list, t); }
+#define debug(fmt, ...) { lp_obj* t = lp_printf(lp, "%d : "fmt, (int)(cur-begin), ##__VA_ARGS__); _lp_list_appendx(lp, out->list, t); }
 
 lp_obj* lp_disasm(LP, lp_obj* code)
 {
@@ -429,36 +852,59 @@ lp_obj* lp_disasm(LP, lp_obj* code)
 		case LP_IPASS: debug("pass"); break;
 		case LP_IIF: debug("if not [%d]", VA); break;
 		case LP_IIFN: debug("if [%d]", VA); break;
+		case LP_IIFLT: debug("if not [%d] < [%d]", VB, VC); break;
+		case LP_IIFLE: debug("if not [%d] <= [%d]", VB, VC); break;
+		case LP_IIFEQ: debug("if not [%d] == [%d]", VB, VC); break;
+		case LP_IIFNE: debug("if not [%d] != [%d]", VB, VC); break;
+		case LP_ILOADMETHOD:
+			debug("[%d] = [%d] method [%d]", VA, VB, VC);
+			cur += ACACHE_WORDS;
+			break;
+		case LP_IGETATTR:
+			debug("[%d] = [%d] getattr [%d]", VA, VB, VC);
+			cur += ACACHE_WORDS;
+			break;
+		case LP_ISETATTR:
+			debug("[%d].[%d] = [%d] setattr", VA, VB, VC);
+			cur += ACACHE_WORDS;
+			break;
+		case LP_ICALLMETHOD: debug("[%d] = [%d] callmethod [%d]", VA, VB, VC); break;
 		case LP_IGET: debug("[%d] = [%d] get [%d]", VA, VB, VC); break;
+		case LP_IGET_LI: debug("[%d] = [%d] get(list,int) [%d]", VA, VB, VC); break;
+		case LP_IGET_DS: debug("[%d] = [%d] get(dict,str) [%d]", VA, VB, VC); break;
+		case LP_IGET_DI: debug("[%d] = [%d] get(dict,int) [%d]", VA, VB, VC); break;
+		case LP_IADD_II: debug("[%d] = [%d] +(int) [%d]", VA, VB, VC); break;
+		case LP_ISUB_II: debug("[%d] = [%d] -(int) [%d]", VA, VB, VC); break;
+		case LP_INE_II: debug("[%d] = [%d] !=(int) [%d]", VA, VB, VC); break;
+		case LP_IEQ_II: debug("[%d] = [%d] ==(int) [%d]", VA, VB, VC); break;
+		case LP_ILE_II: debug("[%d] = [%d] <=(int) [%d]", VA, VB, VC); break;
+		case LP_ILT_II: debug("[%d] = [%d] <(int) [%d]", VA, VB, VC); break;
 		case LP_IITER:
 			debug("[%d] = iter [%d] [%d]++", VA, VB, VC, VC);
 			break;
+		case LP_IITER_RANGE: debug("[%d] = iter(range) [%d] [%d]++", VA, VB, VC); break;
+		case LP_IITER_DICT: debug("[%d] = iter(dict) [%d] [%d]", VA, VB, VC); break;
 		case LP_IHAS: debug("[%d] = [%d] has [%d]", VA, VB, VC); break;
 		case LP_IIGET: debug("[%d] = [%d] iget [%d]", VA, VB, VC); break;
 		case LP_ISET: debug("[%d].[%d] = [%d]", VA, VB, VC); break;
 		case LP_IDEL: debug("[%d] del [%d]", VA, VB); break;
 		case LP_IMOVE: debug("[%d] = [%d]", VA, VB); break;
-		case LP_INUMBER:
-			if (VB)
-			{
-				debug("[%d] = %f", VA, *(double*)(*++cur).string.val);
-				cur += sizeof(double) / 4;
-			}
-			else
+		case LP_ICONST: debug("[%d] = const %d", VA, UVBC); break;
+		case LP_ICONSTS:
+		{
+			int n = UVBC, i;
+			debug("consts %d", n);
+			for (i = 0; i < n; i++)
 			{
-				debug("[%d] = %d", VA, *(int*)(*++cur).string.val);
-				cur += sizeof(int) / 4;
+				int l;
+				e = ++cur;
+				l = UVBC;
+				if (e->i == CONST_INT) { debug("  %d: %d", i, *(int*)(cur + 1)->string.val); }
+				else if (e->i == CONST_DOUBLE) { debug("  %d: %f", i, lp_code_double(cur + 1)); }
+				else if (e->i == CONST_STRING) { debug("  %d: \"%s\"", i, (cur + 1)->string.val); }
+				else { debug("  %d: lines %d", i, l / 2); }
+				cur += (l + 3) / 4;
 			}
-			continue;
-		case LP_ISTRING:
-		{
-			/* RA = lp_string_n((*(cur+1)).string.val,UVBC); */
-			int a = (*(cur + 1)).string.val - code->string.val;
-			int l = UVBC;
-			lp_obj* s = lp_string_sub(lp, code, a, a + l);
-			debug("[%d] = \"%s\"", VA, s->string.val);
-			LP_OBJ_DEC(s);
-			cur += (l / 4) + 1;
 		}
 		break;
 		case LP_IDICT: debug("[%d] = dict %d/2 [%d]", VA, VC, VB); break;
@@ -471,7 +917,8 @@ lp_obj* lp_disasm(LP, lp_obj* code)
 			debug("[%d] = [%d] (  )", VA, VB);
 			break;
 		case LP_IGGET:
-			debug("[%d] = _G.[%d]", VA, VB);
+			debug("[%d] = _G.const %d", VA, UVBC);
+			cur += GCACHE_WORDS;
 			break;
 		case LP_IGSET: debug("_G.[%d] = [%d]", VA, VB); break;
 		case LP_IDEF:
@@ -487,17 +934,6 @@ lp_obj* lp_disasm(LP, lp_obj* code)
 			debug("DEBUG %d [%d]", VA, VA);
 			break;
 		case LP_INONE: debug("[%d] = None", VA); break;
-		case LP_ILINE:
-		{
-			int a = (*(cur + 1)).string.val - code->string.val;
-			/*            f->line = lp_string_n((*(cur+1)).string.val,VA*4-1);*/
-			lp_obj* s = lp_string_sub(lp, code, a, a + VA * 4 - 1);
-			/*             fprintf(stderr,"%7d: %s\n",UVBC,f->line.string.val);*/
-			debug("line = \"%s\"", s->string.val);
-			LP_OBJ_DEC(s);
-			cur += VA;
-		}
-			break;
 		case LP_IFILE: debug("fname = [%d]", VA); break;
 		case LP_INAME: debug("name = [%d]", VA); break;
 		case LP_IREGS: debug("cregs = %d", VA); break;
@@ -509,9 +945,13 @@ lp_obj* lp_disasm(LP, lp_obj* code)
 		if (cur == end)
 			break;
 	}
-	lp_params_v(lp, 2, lp_string(lp, "\n"), out);
-	
-	return lpf_join(lp);
+	{
+		lp_obj* a[2] = {lp_string(lp, "\n"), out};
+		lp_obj* r = lpf_join(lp, 2, a);
+		LP_OBJ_DEC(a[0]);
+		LP_OBJ_DEC(out);
+		return r;
+	}
 }
 
 lp_obj* lpf_disasm(LP)
@@ -524,6 +964,7 @@ lp_obj* lpf_disasm(LP)
 int lp_run(LP,int cur) {
 	while (lp->cur >= cur)
 	{
+		LP_GC_CHECK(lp);
 		if (lp_step(lp))
 		{
 			if (!lp_handle(lp))
@@ -551,14 +992,14 @@ lp_obj* lp_import(LP, lp_obj* fname, lp_obj* name, lp_obj* code)
 	char filename[256], *content = 0;
     lp_obj *g, *file;
 
-    if ((fname->type != LP_NONE && _lp_str_index(fname,0,lp_string(lp, ".py"))!=-1 && code->type == LP_NONE)) {
+    if ((lp_typeof(fname) != LP_NONE && _lp_str_index(fname,0,lp_string(lp, ".py"))!=-1 && lp_typeof(code) == LP_NONE)) {
 		int size;
 		lp_obj* path = lp->path;
 		for (int i = 0; i < path->list->len; i++)
 		{
 			int j = 0;
 			lp_obj* p = path->list->items[i];
-			if (p->type == LP_STRING)
+			if (lp_typeof(p) == LP_STRING)
 			{
 				struct stat stbuf;
 				if (!strcmp(p->string.val, "."))
@@ -593,12 +1034,18 @@ lp_obj* lp_import(LP, lp_obj* fname, lp_obj* name, lp_obj* code)
 					int l = stbuf.st_size, result;
 					const char* rc;
 					FILE* f = fopen(filename, "rb");
-					content = (char*)malloc(l + 1);
+					content = (char*)lp_malloc(lp, l + 1);
+					if (!content)
+					{
+						fclose(f);
+						return 0;
+					}
 					fread(content, 1, l, f);
 					content[l] = '\0';
 					/*    if (rr !=l) { printf("hmmn: %d %d\n",rr,(int)l); }*/
 					fclose(f);
 					rc = compile(filename, content, &size, &result);
+					lp_free(lp, content, l + 1);
 					if (!result)
 					{
 						lp_obj *e = lp_string_copy(lp, rc, strlen(rc) + 1);
@@ -607,15 +1054,16 @@ lp_obj* lp_import(LP, lp_obj* fname, lp_obj* name, lp_obj* code)
 					}
 					code = lp_string_copy(lp, rc, size);
 					free(rc);
+					if (!code) return 0;
 					break;
 				}
 			}
-			else if (p->type == LP_FNC)
+			else if (lp_typeof(p) == LP_FNC)
 			{
 				lp_obj* f;
 				lp_params_v(lp, 1, fname);
 				file = lp_call(lp, p);
-				if (file->type != LP_NONE)
+				if (lp_typeof(file) != LP_NONE)
 				{
 					f = lp_getk(lp, file, lp_number_from_int(lp, 0));
 					code = lp_getk(lp, file, lp_number_from_int(lp, 1));
@@ -628,7 +1076,7 @@ lp_obj* lp_import(LP, lp_obj* fname, lp_obj* name, lp_obj* code)
 		}
     }
 
-    if (code->type == LP_NONE) {
+    if (lp_typeof(code) == LP_NONE) {
 		lp_raise(0, lp_string(lp, "lp_import TypeError: ? "));
     }
 
@@ -656,7 +1104,8 @@ lp_obj* lp_import(LP, lp_obj* fname, lp_obj* name, lp_obj* code)
  * Parameters:
  * fname - The filename of a file containing the module's code.
  * name - The name of the module.
- * codes - The module's code.  If this is given, fname is ignored.
+ * codes - The module's code.  If this is given, fname is ignored. The code is copied, as
+ *         the VM patches it in place while running.
  * len - The length of the bytecode.
  *
  * Returns:
@@ -665,9 +1114,11 @@ lp_obj* lp_import(LP, lp_obj* fname, lp_obj* name, lp_obj* code)
 lp_obj* lp_import_(LP, const char * fname, const char * name, void *codes, int len)
 {
     lp_obj* f = lp_string(lp, fname);
-    lp_obj* bc = lp_string_n(lp, (const char*)codes,len);
-	lp_obj* n = lp_string(lp, name);
-    lp_obj* module = lp_import(lp,f,n,bc);
+    lp_obj* bc = lp_string_copy(lp, (const char*)codes,len);
+	lp_obj* n, *module;
+	if (!bc) { LP_OBJ_DEC(f); return 0; }
+	n = lp_string(lp, name);
+    module = lp_import(lp,f,n,bc);
 	LP_OBJ_DEC(f);
 	LP_OBJ_DEC(bc);
 	LP_OBJ_DEC(n);
@@ -684,7 +1135,7 @@ lp_obj* lp_compile(LP, lp_obj* text, lp_obj* fname)
 	int size, result;
 	lp_obj* code;
 
-	if (text->type != LP_STRING || fname->type != LP_STRING)
+	if (lp_typeof(text) != LP_STRING || lp_typeof(fname) != LP_STRING)
 	{
 		lp_raise(0, lp_string(lp, "(lp_compile) expected string"));
 	}
@@ -706,9 +1157,15 @@ lp_obj* lp_compile(LP, lp_obj* text, lp_obj* fname)
 lp_obj* lp_exec(LP, lp_obj* code, lp_obj* globals)
 {
     lp_obj* r = lp->lp_None;
+    int base = lp->cur + 1, i;
     lp_frame(lp,globals,code,&r);
-	if (!lp_run(lp, lp->cur)) return 0;
-	RETURN_LP_OBJ(r);
+	if (!lp_run(lp, lp->cur)) {
+		/* the frames are left for lp_print_stack, but nothing returns to
+		 * them, so what their registers hold can go */
+		for (i = lp->cur; i >= base; i--) { lp_frame_clear(lp, &lp->frames[i]); }
+		return 0;
+	}
+	return r;
 }
 
 lp_obj* lpf_exec(LP)
@@ -718,7 +1175,7 @@ lp_obj* lpf_exec(LP)
     lp_obj* r = lp->lp_None;
     lp_frame(lp,globals,code,&r);
 	if (!lp_run(lp, lp->cur)) return 0;
-	RETURN_LP_OBJ(r);
+	return r;
 }
 
 
@@ -727,7 +1184,7 @@ lp_obj* lpf_import(LP)
     lp_obj* mod = LP_OBJ(0);
 	lp_obj* suffix, *fn, *r;
 
-    if (lp_has(lp,lp->modules,mod)->integer) {
+    if (lp_integer(lp_has(lp,lp->modules,mod))) {
         return lp_get(lp,lp->modules,mod);
     }
     
@@ -761,27 +1218,58 @@ lp_obj* lpf_eval(LP)
 void lp_builtins(LP) {
     lp_obj* o;
     struct {const char *s;void *f;} b[] = {
+    {"import",lpf_import},
+    {"str",lpf_str2}, {"chr",lpf_chr},
+    {"exec",lpf_exec},
+    {"ord",lpf_ord}, {"merge",lpf_merge},
+    {"compile",lpf_compile},  {"eval",lpf_eval}, {"disasm",lpf_disasm},
+    #ifdef LP_SANDBOX
+    {"sandbox",lp_sandbox_},
+    #endif
+    {0,0},
+    };
+    /* vector call builtins, see LP_ARGS */
+    struct {const char *s;void *f;} vb[] = {
     {"print",lpf_print}, {"range",lpf_range}, {"min",lpf_min},
     {"max",lpf_max}, {"bind",lpf_bind}, {"copy",lpf_copy},
-    {"import",lpf_import}, {"len",lpf_len}, {"assert",lpf_assert},
-    {"str",lpf_str2}, {"float",lpf_float}, {"system",lpf_system},
-    {"istype",lpf_istype}, {"chr",lpf_chr}, {"save",lpf_save},
+    {"len",lpf_len}, {"assert",lpf_assert},
+    {"float",lpf_float}, {"system",lpf_system},
+    {"istype",lpf_istype}, {"save",lpf_save},
     {"load",lpf_load}, {"fpack",lpf_fpack}, {"abs",lpf_abs},
-    {"int",lpf_int}, {"exec",lpf_exec}, {"exists",lpf_exists},
+    {"int",lpf_int}, {"exists",lpf_exists},
     {"mtime",lpf_mtime}, {"number",lpf_float}, {"round",lpf_round},
-    {"ord",lpf_ord}, {"merge",lpf_merge}, {"getraw",lpf_getraw},
+    {"getraw",lpf_getraw}, {"keys",lpf_keys},
+    {"values",lpf_values}, {"items",lpf_items},
     {"setmeta",lpf_setmeta}, {"getmeta",lpf_getmeta},
     {"bool", lpf_builtins_bool},
-    {"compile",lpf_compile},  {"eval",lpf_eval}, {"disasm",lpf_disasm},
-    #ifdef LP_SANDBOX
-    {"sandbox",lp_sandbox_},
-    #endif
     {0,0},
     };
     int i; for(i=0; b[i].s; i++) {
         lp_set(lp,lp->builtins,lp_string(lp, b[i].s),lp_fnc(lp,(lp_obj *(*)(lp_vm *))b[i].f));
     }
+    for(i=0; vb[i].s; i++) {
+        lp_set(lp,lp->builtins,lp_string(lp, vb[i].s),lp_vfnc(lp,(lp_obj *(*)(lp_vm *,LP_ARGS))vb[i].f));
+    }
     
+    /* methods of lists and strings, see lp_get_method */
+    struct {int t;const char *s;void *f;} m[] = {
+    {LP_LIST,"append",lpf_append}, {LP_LIST,"pop",lpf_pop},
+    {LP_LIST,"index",lpf_index}, {LP_LIST,"sort",lpf_sort},
+    {LP_LIST,"extend",lpf_extend},
+    {LP_STRING,"join",lpf_join}, {LP_STRING,"split",lpf_split},
+    {LP_STRING,"index",lpf_str_index}, {LP_STRING,"strip",lpf_strip},
+    {LP_STRING,"replace",lpf_replace},
+    {0,0,0},
+    };
+    lp->list_methods = lp_dict(lp);
+    lp->string_methods = lp_dict(lp);
+    lp_set(lp,lp->root,lp->lp_None,lp->list_methods);
+    lp_set(lp,lp->root,lp->lp_None,lp->string_methods);
+    for(i=0; m[i].s; i++) {
+        lp_setkv(lp,m[i].t == LP_LIST ? lp->list_methods : lp->string_methods,
+            lp_string(lp, m[i].s),lp_vfnc(lp,(lp_obj *(*)(lp_vm *,LP_ARGS))m[i].f));
+    }
+
     o = lp_object(lp);
     lp_setkv(lp,o,lp_string(lp, "__call__"),lp_fnc(lp,lpf_object_call));
     lp_setkv(lp,o,lp_string(lp, "__new__"),lp_fnc(lp,lpf_object_new));
@@ -829,7 +1317,19 @@ lp_obj* lp_eval(LP, const char *text, lp_obj* globals) {
  * The newly created tinypy instance.
  */
 lp_vm *lp_init(int argc, char *argv[]) {
-    lp_vm *lp = _lp_init();
+    return lp_init_alloc(argc, argv, &lp_std_allocator);
+}
+
+/* Function: lp_init_alloc
+ * Like <lp_init>, but the VM takes all its memory from mem, see
+ * <lp_allocator>. mem is copied.
+ *
+ * Returns:
+ * The new instance, or 0 if mem has no memory for it.
+ */
+lp_vm *lp_init_alloc(int argc, char *argv[], const lp_allocator* mem) {
+    lp_vm *lp = _lp_init(mem);
+    if (!lp) { return 0; }
     lp_builtins(lp);
     math_init(lp);
     random_init(lp);
@@ -0,0 +1,140 @@
+/* Lunapy test set -- custom allocators and the memory limit
+ *
+ * Runs a VM on a counting allocator: every byte it takes has to come back
+ * by lp_deinit, and a script that grows past lp_mem_limit, or past what
+ * the allocator has, gets a MemoryError it can catch. A block that would
+ * go past either is refused before it is taken.
+ */
+#include "test.h"
+
+static size_t live, pools, cap;
+static int finalized;
+
+/* with cap set the allocator fails past it, the way the system would */
+static int over(size_t size) { return cap && live + pools * LP_POOL_BYTES + size > cap; }
+
+static void *count_alloc(void *ud, size_t size) {
+	if (over(size)) return 0;
+	live += size;
+	return lp_std_allocator.alloc(ud, size);
+}
+static void count_release(void *ud, void *p, size_t size) { live -= size; lp_std_allocator.release(ud, p, size); }
+static void *count_pool_alloc(void *ud) {
+	if (over(LP_POOL_BYTES)) return 0;
+	pools++;
+	return lp_std_allocator.pool_alloc(ud);
+}
+static void count_pool_release(void *ud, void *p) { pools--; lp_std_allocator.pool_release(ud, p); }
+
+static void data_free(LP, lp_obj self) { finalized++; lp_free(lp, self.data.val, 64); }
+
+/* runs text, returns 1 if it raised and leaves the text of the exception
+ * in ex */
+static int run_ex(LP, const char *text, lp_obj *g, char *ex, int len) {
+	lp_obj *r = lp_eval(lp, text, g);
+	if (r) { LP_OBJ_DEC(r); return 0; }
+	lp_cstr(lp, lp->ex, ex, len);
+	LP_OBJ_DEC(lp->ex);
+	lp->ex = 0;
+	lp->cur = 0;
+	return 1;
+}
+
+int main(int argc, char *argv[]) {
+	lp_allocator mem = { count_alloc, count_release, count_pool_alloc, count_pool_release, 0 };
+	char ex[LP_CSTR_LEN];
+	lp_vm *lp = lp_init_alloc(argc, argv, &mem);
+	lp_obj *g, *d;
+
+	testit("mem_used after init", (long)lp->mem_used, (long)(live + pools * LP_POOL_BYTES));
+
+	lp_mem_limit(lp, 8 << 20);
+	g = lp_dict(lp);
+	run(lp,
+		"def grow():\n"
+		"    a = []\n"
+		"    while True:\n"
+		"        a.append(str(len(a)) + 'xxxxxxxxxxxxxxxx')\n"
+		"caught = 0\n"
+		"try:\n"
+		"    grow()\n"
+		"except:\n"
+		"    caught = 1\n"
+		"after = 1\n", g);
+	testit("MemoryError caught", global_int(lp, g, "caught"), 1);
+	testit("runs on after it", global_int(lp, g, "after"), 1);
+	testit("under the limit", lp->mem_used <= 8 << 20, 1);
+
+	/* large strings, lists and dicts past the limit are never taken */
+	run(lp,
+		"caught = 0\n"
+		"try:\n"
+		"    s = 'x' * 300000000\n"
+		"except:\n"
+		"    caught += 1\n"
+		"a = []\n"
+		"try:\n"
+		"    while True:\n"
+		"        a.append(0)\n"
+		"except:\n"
+		"    caught += 1\n"
+		"a = None\n"
+		"d = {}\n"
+		"try:\n"
+		"    i = 0\n"
+		"    while True:\n"
+		"        d[i] = i\n"
+		"        i += 1\n"
+		"except:\n"
+		"    caught += 1\n"
+		"d = None\n", g);
+	testit("large blocks refused", global_int(lp, g, "caught"), 3);
+	testit("peak under the limit", lp->mem_peak <= 8 << 20, 1);
+
+	testit("uncaught raises", run_ex(lp, "s = 'x'\nwhile True:\n    s = s + s\n", g, ex, sizeof(ex)), 1);
+	testit("raises MemoryError", strstr(ex, "MemoryError") != 0, 1);
+	testit("mem_used matches the allocator", (long)lp->mem_used, (long)(live + pools * LP_POOL_BYTES));
+	testit("peak still under the limit", lp->mem_peak <= 8 << 20, 1);
+
+	/* the allocator running out is a MemoryError too, the reserve gets the
+	 * VM through raising it */
+	lp_mem_limit(lp, LP_NO_LIMIT);
+	cap = lp->mem_used + (4 << 20);
+	run(lp,
+		"caught = 0\n"
+		"try:\n"
+		"    s = 'x' * 200000000\n"
+		"except:\n"
+		"    caught = 1\n", g);
+	testit("large block the allocator lacks caught", global_int(lp, g, "caught"), 1);
+	testit("reserve kept for small blocks", lp->mem_reserve != 0, 1);
+	run(lp,
+		"caught = 0\n"
+		"after = 0\n"
+		"try:\n"
+		"    grow()\n"
+		"except:\n"
+		"    caught = 1\n"
+		"after = 1\n", g);
+	testit("allocator out of memory caught", global_int(lp, g, "caught"), 1);
+	testit("runs on after that", global_int(lp, g, "after"), 1);
+	testit("reserve used", lp->mem_reserve == 0, 1);
+	cap = 0;
+	run(lp, "i = 0\nwhile i < 10000:\n    x = [i]\n    i += 1\n", g);
+	testit("reserve taken again", lp->mem_reserve != 0, 1);
+	testit("mem_used still matches", (long)lp->mem_used, (long)(live + pools * LP_POOL_BYTES));
+	LP_OBJ_DEC(g);
+
+	/* data objects still alive at lp_deinit, one of them leaked */
+	d = lp_data(lp, 0, lp_malloc(lp, 64));
+	d->data.free_fun = data_free;
+	lp_setkv(lp, lp->modules, lp_string(lp, "held"), d);
+	d = lp_data(lp, 0, lp_malloc(lp, 64));
+	d->data.free_fun = data_free;
+
+	lp_deinit(lp);
+	testit("data objects finalized by deinit", finalized, 2);
+	testit("live bytes after deinit", (long)live, 0);
+	testit("pools after deinit", (long)pools, 0);
+	return failed;
+}
@@ -0,0 +1,125 @@
+/* Lunapy test set -- arenas
+ *
+ * Runs scripts between lp_arena_begin and lp_arena_end the way an embedder
+ * serving one request after another would, and checks what is freed and
+ * what is kept.
+ */
+#include "test.h"
+
+/* runs text in an arena with globals of its own */
+static void request(LP, const char *text) {
+	lp_obj *g;
+	lp_arena_begin(lp);
+	g = lp_dict(lp);
+	run(lp, text, g);
+	LP_OBJ_DEC(g);
+	lp_arena_end(lp);
+}
+
+static int finalized;
+
+static void data_free(LP, lp_obj self) { finalized++; lp_free(lp, self.data.val, 64); }
+
+static long live_objects(LP) {
+	struct LpObjPool *p;
+	long n = 0;
+	int i;
+	lp_collect(lp);
+	while (lp_free_pending(lp, LP_FREE_SLICE));
+	for (p = lp->obj_pool; p; p = p->next) {
+		for (i = 0; i < (int)OBJ_SIZE; i++) {
+			if (p->obj[i].ref > 0) n++;
+		}
+	}
+	return n;
+}
+
+/* the value of the expression text in the globals g */
+static long value(LP, lp_obj *g, const char *text) {
+	char buf[LP_CSTR_LEN];
+	snprintf(buf, sizeof(buf), "r = %s\n", text);
+	run(lp, buf, g);
+	return global_int(lp, g, "r");
+}
+
+int main(int argc, char *argv[]) {
+	lp_vm *lp = lp_init(argc, argv);
+	lp_obj *g = lp_dict(lp);
+	lp_obj *c;
+	long before, n;
+	unsigned long used;
+	int i;
+
+	run(lp,
+		"import sys\n"
+		"sys.keep = [1, 2]\n"
+		"sys.kd = {'x': 1}\n"
+		"sys.shared = [[i] for i in range(1000)]\n"
+		"sys.doomed = [[i] for i in range(1000)]\n", g);
+
+	/* references the arena leaves in long-lived objects are dropped */
+	request(lp,
+		"import sys\n"
+		"sys.keep.append([3])\n"
+		"sys.keep.append(4)\n"
+		"sys.kd['y'] = [5]\n"
+		"sys.kd['x'] = [6]\n");
+	testit("arena value in a list", value(lp, g, "sys.keep[2] == None"), 1);
+	testit("int in a list", value(lp, g, "sys.keep[3]"), 4);
+	testit("arena value in a dict", value(lp, g, "sys.kd['x'] == None"), 1);
+	testit("arena key forgotten", value(lp, g, "len(sys.kd)"), 1);
+
+	/* a long-lived object that dies in the arena is freed with it */
+	before = live_objects(lp);
+	request(lp, "import sys\nsys.doomed = None\n");
+	testit("died in the arena", before - live_objects(lp) > 900, 1);
+
+	/* the arena takes and drops references to long-lived objects without
+	 * keeping them alive, the real counts are kept */
+	request(lp,
+		"import sys\n"
+		"a = sys.shared\n"
+		"b = [sys.shared, sys.shared, sys.keep]\n"
+		"c = {'s': sys.shared}\n");
+	before = live_objects(lp);
+	run(lp, "sys.shared = None\n", g);
+	testit("freed after the arena", before - live_objects(lp) > 900, 1);
+
+	/* data objects of the arena are finalized when it ends, once */
+	lp_arena_begin(lp);
+	c = lp_list(lp);
+	for (i = 0; i < 3; i++) {
+		lp_obj *d = lp_data(lp, 0, lp_malloc(lp, 64));
+		d->data.free_fun = data_free;
+		if (i) lp_set(lp, c, lp->lp_None, d);
+		LP_OBJ_DEC(d);
+	}
+	testit("data dropped in the arena", finalized, 1);
+	lp_arena_end(lp);
+	testit("data finalized by the arena", finalized, 3);
+
+	/* shapes of the keys of a request go with it */
+	request(lp, "class A:\n    pass\no = A()\no.warm = 1\n");
+	n = lp->shape_count;
+	for (i = 0; i < 100; i++) {
+		char buf[LP_CSTR_LEN];
+		snprintf(buf, sizeof(buf),
+			"class A:\n    pass\no = A()\no.k%d = 1\no.j%d = 2\no.k%d += o.j%d\n", i, i, i, i);
+		request(lp, buf);
+	}
+	testit("shapes after 100 requests", lp->shape_count, n);
+
+	/* the same request over and over does not grow the heap */
+	request(lp, "l = [str(i) for i in range(2000)]\nd = {}\nd['l'] = l\n");
+	n = live_objects(lp);
+	used = lp->mem_used;
+	for (i = 0; i < 100; i++) {
+		request(lp, "l = [str(i) for i in range(2000)]\nd = {}\nd['l'] = l\n");
+	}
+	testit("objects after 100 requests", live_objects(lp), n);
+	testit("memory after 100 requests", lp->mem_used <= used, 1);
+
+	LP_OBJ_DEC(g);
+	lp_deinit(lp);
+	return failed;
+}
@@ -0,0 +1,70 @@
+# Lunapy test set -- attributes
+
+import check
+testit = check.testit
+
+class A:
+    def __init__(self, x):
+        self.x = x
+    def f(self):
+        return self.x + self.k
+
+class B:
+    def f(self):
+        return 100 + self.x
+
+def run(o):
+    return o.f() + o.x + o.k
+
+A.k = 1
+B.k = 10
+a = A(1)
+b = A(2)
+testit('instance and class', run(a) + run(b), 10)
+A.k = 5
+testit('class attribute changed', run(a) + run(b), 26)
+b.k = 7
+testit('instance shadows class', run(b), 18)
+setmeta(a, B)
+testit('class of object changed', run(a), 112)
+def g(self):
+    return 42
+A.f = g
+testit('method replaced', run(b), 51)
+del b.k
+testit('shadow deleted', run(b), 49)
+
+c = A(3)
+i = 0
+s = 0
+while i < 5:
+    c.x = i
+    s += c.x
+    i += 1
+testit('set in place', s, 10)
+m = c.f
+testit('bound method', m(), 42)
+
+class H:
+    def __init__(self):
+        self.v = 1
+    def __get__(self, k):
+        return "hooked " + k
+testit('__get__ hook', H().zz, "hooked zz")
+
+class S:
+    def __init__(self):
+        pass
+    def __set__(self, k, v):
+        S.calls = S.calls + v
+S.calls = 0
+o = S()
+i = 0
+while i < 3:
+    o.w = i
+    i += 1
+testit('__set__ hook', S.calls, 3)
+
+d = {"x": 1}
+d.x = d.x + 1
+testit('dict attribute', d["x"], 2)
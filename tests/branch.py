@@ -0,0 +1,125 @@
+# Lunapy test set -- compare and branch in if, elif and while
+
+import check
+testit = check.testit
+
+# each comparison in an if, taken and not taken
+def cmp(a, b):
+    r = ''
+    if a < b:
+        r = r + 'lt '
+    if a <= b:
+        r = r + 'le '
+    if a > b:
+        r = r + 'gt '
+    if a >= b:
+        r = r + 'ge '
+    if a == b:
+        r = r + 'eq '
+    if a != b:
+        r = r + 'ne '
+    return r
+
+testit('1 2', cmp(1, 2), 'lt le ne ')
+testit('2 1', cmp(2, 1), 'gt ge ne ')
+testit('2 2', cmp(2, 2), 'le ge eq ')
+testit('-3 -2', cmp(-3, -2), 'lt le ne ')
+testit('-1 0', cmp(-1, 0), 'lt le ne ')
+testit('int max', cmp(2147483647, -2147483647 - 1), 'gt ge ne ')
+testit('1.5 2.5', cmp(1.5, 2.5), 'lt le ne ')
+testit('2.5 2.5', cmp(2.5, 2.5), 'le ge eq ')
+testit('-0.5 -1.5', cmp(-0.5, -1.5), 'gt ge ne ')
+testit('"a" "b"', cmp("a", "b"), 'lt le ne ')
+testit('"b" "ab"', cmp("b", "ab"), 'gt ge ne ')
+testit('"ab" "ab"', cmp("ab", "a" + "b"), 'le ge eq ')
+testit('None None', cmp(None, None), 'le ge eq ')
+
+# the same branch first sees ints and then other types
+r = ''
+for v in [1, 2, 3, 2.0, 3.0, "x", None, [1]]:
+    if v == 2:
+        r = r + 'i'
+    if v == 2.0:
+        r = r + 'f'
+    if v != None:
+        r = r + '.'
+testit('mixed types', r, '.i..f....')
+
+# constants on either side
+x = 5
+r = ''
+if 4 < x:
+    r = r + 'a'
+if x < 4:
+    r = r + 'b'
+if 5 == x:
+    r = r + 'c'
+if x != 5:
+    r = r + 'd'
+testit('constants', r, 'ac')
+
+# elif chains
+def sign(n):
+    if n < 0:
+        return -1
+    elif n == 0:
+        return 0
+    elif n > 0:
+        return 1
+    return None
+
+testit('sign -7', sign(-7), -1)
+testit('sign 0', sign(0), 0)
+testit('sign 7', sign(7), 1)
+
+# while loops
+n = 0
+i = 0
+while i < 10:
+    n += i
+    i += 1
+testit('while <', n, 45)
+i = 10
+while i >= 0:
+    i -= 3
+testit('while >=', i, -2)
+i = 0.0
+while i <= 2.0:
+    i = i + 0.5
+testit('while <= float', i, 2.5)
+s = ''
+while s != 'xxx':
+    s = s + 'x'
+testit('while != str', s, 'xxx')
+
+# and, or and not around comparisons
+def both(a, b):
+    if a < b and b < 10:
+        return 1
+    return 0
+
+def either(a, b):
+    if a < b or b < 0:
+        return 1
+    return 0
+
+testit('and true', both(1, 5), 1)
+testit('and first false', both(5, 1), 0)
+testit('and second false', both(1, 20), 0)
+testit('or first', either(1, 5), 1)
+testit('or second', either(5, -1), 1)
+testit('or neither', either(5, 1), 0)
+r = 0
+if not 1 < 2:
+    r = 1
+testit('not', r, 0)
+i = 0
+n = 0
+while i < 10 and n < 20:
+    n += i
+    i += 1
+testit('while and', i, 7)
+
+# comparisons still give values outside conditions
+testit('value <', 1 < 2, 1)
+testit('value ==', "a" == "b", 0)
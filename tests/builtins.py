@@ -0,0 +1,84 @@
+# Lunapy test set -- builtins and their calling paths
+#
+# C builtins take their arguments as an array. They are called straight
+# from the caller's registers when a call site allows it, and through the
+# params list from everywhere else; both have to give the same results.
+
+import check
+testit = check.testit
+
+def raises(f, a):
+    try:
+        f(a)
+    except:
+        return 1
+    return 0
+
+# direct calls
+testit('len', len([1, 2, 3]), 3)
+testit('min', min(3, 1, 2), 1)
+testit('max', max(3, 1, 2), 3)
+testit('abs', abs(-2.5), 2.5)
+testit('int', int(7.9), 7)
+testit('float', float(2), 2.0)
+testit('round', round(2.6), 3.0)
+testit('bool', bool(0), 0)
+testit('istype', istype('s', 'string'), 1)
+testit('range default step', len(range(1, 7)), 6)
+testit('range with step', len(range(1, 7, 2)), 3)
+
+# arguments that are calls themselves, and a result that is reused
+testit('nested calls', max(len('ab'), min(5, len([1, 2, 3, 4]))), 4)
+n = len('abc')
+n = len('abcde') + n
+testit('result reused', n, 8)
+
+# builtins held in variables, lists and dicts
+f = len
+testit('through a variable', f('abcd'), 4)
+fs = [min, max]
+testit('through a list', fs[1](1, 5, 3), 5)
+fd = {'abs': abs}
+testit('through a dict', fd['abs'](-4.0), 4.0)
+
+# bound, and called from a function passed them
+def apply(g, a, b):
+    return g(a, b)
+testit('passed to a function', apply(min, 4, 3), 3)
+b = bind(max, 50)
+testit('bound', b(7), 50)
+
+# wrong arguments still raise
+testit('len of an int', raises(len, 5), 1)
+testit('len of None', raises(len, None), 1)
+testit('int of a list', raises(int, [1]), 1)
+testit('len of a list', raises(len, [1]), 0)
+caught = 0
+try:
+    len()
+except:
+    caught = 1
+testit('len without arguments', caught, 1)
+
+# list and string methods are builtins too
+l = [3, 1, 2]
+l.append(4)
+l.sort()
+testit('list methods', l[0] + l[3] * 10, 41)
+testit('list pop', l.pop(), 4)
+testit('list index', l.index(2), 1)
+testit('str split', len('a b c'.split(' ')), 3)
+testit('str join', '-'.join(['a', 'b']), 'a-b')
+testit('str strip', '  x '.strip(), 'x')
+testit('str replace', 'aXbX'.replace('X', '.'), 'a.b.')
+m = l.append
+m(9)
+testit('method held in a variable', l[3], 9)
+
+# a loop of many calls does not leave arguments behind
+i = 0
+t = 0
+while i < 10000:
+    t += len('abc') + abs(-1.0) + max(i, 0) - i
+    i += 1
+testit('many calls', t, 40000.0)
@@ -0,0 +1,55 @@
+# Lunapy test set -- one-character strings
+
+import check
+testit = check.testit
+
+s = "hello"
+testit('s[0]', s[0], "h")
+testit('s[-1]', s[-1], "o")
+testit('s[1:2]', s[1:2], "e")
+testit('len(s[1])', len(s[1]), 1)
+testit('s[1] == s[1:2]', s[1] == s[1:2], 1)
+testit('s[2] == s[3]', s[2] == s[3], 1)
+testit('s[0] + s[4]', s[0] + s[4], "ho")
+
+r = ''
+for c in s:
+    r = c + r
+testit('iterate', r, "olleh")
+
+# every byte value, through chr, ord, indexing and dict keys
+ok = 0
+d = {}
+i = 0
+while i < 256:
+    c = chr(i)
+    if len(c) == 1 and ord(c) == i and ord((c + "x")[0]) == i:
+        ok += 1
+    d[c] = i
+    i += 1
+testit('chr and ord', ok, 256)
+testit('distinct keys', len(d), 256)
+testit('key a', d["a"], 97)
+testit('key from a string', d["xyz"[1]], 121)
+testit('key 0', d[chr(0)], 0)
+testit('key 255', d[chr(255)], 255)
+
+# characters keep working after many are taken and dropped
+n = 0
+j = 0
+while j < 1000:
+    t = "abc"[j % 3]
+    if t == "abc"[j % 3]:
+        n += 1
+    j += 1
+testit('taken and dropped', n, 1000)
+
+# strings built from characters are strings of their own
+w = chr(97)
+w = w + "b"
+testit('grown from a char', w, "ab")
+testit('char unchanged', chr(97), "a")
+l = "a,b"
+testit('sliced into chars', l[0:1] + l[2:3], "ab")
+testit('join of chars', "-".join(["x", "y"]), "x-y")
+testit('replace a char', "aXa".replace("X", "b"), "aba")
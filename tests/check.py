@@ -0,0 +1,10 @@
+# Lunapy test set -- helpers shared by the scripts of the set
+#
+# The scripts run from the tests directory and import this module.
+
+def testit(name, value, expected):
+    if value != expected:
+        msg = name + " returned " + str(value) + " expected " + str(expected)
+        raise msg
+    else:
+        print(name + " " + str(value) + " passed")
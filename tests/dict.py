@@ -0,0 +1,85 @@
+# Lunapy test set -- dict
+
+import check
+testit = check.testit
+
+def order(d):
+    r = []
+    for k in d:
+        r.append(str(k))
+    return " ".join(r)
+
+d = {"z": 1, "a": 2, "m": 3}
+d["b"] = 4
+testit('insertion order', order(d), "z a m b")
+del d["a"]
+d["a"] = 5
+testit('order after del', order(d), "z m b a")
+d["z"] = 6
+testit('order after set', order(d), "z m b a")
+testit('get after del', d["a"] + d["z"], 11)
+
+e = {}
+merge(e, d)
+testit('merge keeps order', order(e), "z m b a")
+
+big = {}
+i = 0
+while i < 1000:
+    big[i] = i
+    i += 1
+i = 0
+while i < 1000:
+    if i % 10:
+        del big[i]
+    i += 1
+testit('len after dels', len(big), 100)
+testit('first keys', order(big)[0:10], "0 10 20 30")
+testit('has deleted', 11 in big, 0)
+testit('has kept', 990 in big, 1)
+
+q = {}
+i = 0
+while i < 10000:
+    q[i] = i
+    del q[i]
+    i += 1
+testit('churn', len(q), 0)
+q["x"] = 1
+testit('churn then set', order(q), "x")
+
+n = {"a": 1, "b": 2}
+r = []
+for k in n:
+    for j in n:
+        r.append(k + j)
+testit('nested loops', " ".join(r), "aa ab ba bb")
+testit('keys view', order(keys(n)), "a b")
+s = 0
+for v in values(n):
+    s += v
+testit('values view', s, 3)
+r = []
+for p in items(n):
+    r.append(p)
+testit('items view', r[0][0] + str(r[0][1]) + r[1][0] + str(r[1][1]), "a1b2")
+testit('len of view', len(items(n)), 2)
+merge(n, {"c": 3, "a": 4})
+testit('merge sets', order(n) + str(n["a"]), "a b c4")
+
+a = {}
+i = 0
+while i < 100:
+    a[i] = i * i
+    i += 1
+testit('int keys', a[7] + a[99], 9850)
+del a[50]
+testit('int keys after del', str(50 in a) + " " + str(a[51]) + " " + str(len(a)), "0 2601 99")
+a[50] = 1
+testit('int keys order', order(a)[-8:], "98 99 50")
+a[0] = 5
+testit('int key reset', a[0] + a[50], 6)
+s = {-5: 1, 1000000: 2, 3: 3}
+s[2147483647] = 4
+testit('sparse int keys', s[-5] + s[1000000] + s[3] + s[2147483647], 10)
+testit('int and float keys', str(1.5 in s) + " " + str(3 in s), "0 1")
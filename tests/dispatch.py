@@ -0,0 +1,113 @@
+# Lunapy test set -- exceptions raised by instructions
+#
+# Each instruction that can raise has to stop its frame right there, and
+# the handler has to see the exception.
+
+import check
+testit = check.testit
+
+trail = []
+
+def get_dict():
+    trail.append(1)
+    x = {'a': 1}['x']
+    trail.append(2)
+
+def get_list():
+    trail.append(1)
+    x = [1][5]
+    trail.append(2)
+
+def add():
+    trail.append(1)
+    x = 'a' + 1
+    trail.append(2)
+
+def sub():
+    trail.append(1)
+    x = 1 - 'a'
+    trail.append(2)
+
+def mul():
+    trail.append(1)
+    x = 'a' * 'b'
+    trail.append(2)
+
+def has():
+    trail.append(1)
+    x = 3 in 5
+    trail.append(2)
+
+def iterate():
+    trail.append(1)
+    for i in 5:
+        trail.append(3)
+    trail.append(2)
+
+def call_builtin():
+    trail.append(1)
+    x = len(5)
+    trail.append(2)
+
+def name():
+    trail.append(1)
+    x = undefined_name
+    trail.append(2)
+
+def delete():
+    trail.append(1)
+    x = {}
+    del x['k']
+    trail.append(2)
+
+def setattr():
+    trail.append(1)
+    x = 5
+    x.y = 1
+    trail.append(2)
+
+def method():
+    trail.append(1)
+    x = 'abc'.nomethod()
+    trail.append(2)
+
+def nested():
+    trail.append(1)
+    get_dict()
+    trail.append(2)
+
+def check(f):
+    caught = 0
+    while len(trail):
+        trail.pop()
+    try:
+        f()
+    except:
+        caught = 1
+    return str(caught) + ' ' + str(len(trail))
+
+testit('get dict', check(get_dict), '1 1')
+testit('get list', check(get_list), '1 1')
+testit('add', check(add), '1 1')
+testit('sub', check(sub), '1 1')
+testit('mul', check(mul), '1 1')
+testit('in', check(has), '1 1')
+testit('iter', check(iterate), '1 1')
+testit('call builtin', check(call_builtin), '1 1')
+testit('global name', check(name), '1 1')
+testit('delete', check(delete), '1 1')
+testit('setattr', check(setattr), '1 1')
+testit('method', check(method), '1 1')
+testit('nested', check(nested), '1 2')
+
+# a raise inside a loop leaves the loop, and the next try works again
+n = 0
+i = 0
+while i < 5:
+    try:
+        x = [1, 2, 3][i]
+        n += x
+    except:
+        n += 100
+    i += 1
+testit('loop', n, 206)
@@ -0,0 +1,46 @@
+# Lunapy test set -- gc module
+import gc
+
+import check
+testit = check.testit
+
+class Node:
+    def __init__(self):
+        self.me = self
+        self.items = [self]
+
+def cycles(n):
+    i = 0
+    while i < n:
+        a = []
+        a.append(a)
+        d = {}
+        d["self"] = d
+        i += 1
+
+old = gc.threshold(0)
+testit('threshold()', old, 4096)
+gc.collect()
+cycles(10)
+testit('collect() lists and dicts', gc.collect(), 20)
+testit('collect() again', gc.collect(), 0)
+n = Node()
+n = None
+testit('collect() object', gc.collect(), 2)
+keep = Node()
+testit('collect() live object', gc.collect(), 0)
+testit('live object', keep.me.items[0] == keep, 1)
+testit('threshold(old)', gc.threshold(old), 0)
+cycles(100000)
+testit('threshold()', gc.threshold(), 4096)
+
+def nest(n):
+    a = []
+    i = 0
+    while i < n:
+        a = [a]
+        i += 1
+    return a
+deep = nest(1000000)
+deep = None
+testit('drop deep list', gc.collect(), 0)
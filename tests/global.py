@@ -0,0 +1,55 @@
+# Lunapy test set -- global names
+#
+# A global load keeps what it found next to the instruction, for as long
+# as neither the globals nor the builtins change. Each case fills the
+# cache of a site first and then changes what the name means.
+
+import check
+testit = check.testit
+
+x = [1]
+def get_x():
+    return x[0]
+
+testit('filled', get_x() + get_x(), 2)
+# the list the site found is freed here
+x = ['two']
+testit('global rebound', get_x(), 'two')
+y = 0
+testit('other global set', get_x(), 'two')
+x = [3.5]
+testit('rebound again', get_x(), 3.5)
+
+def shadow(v):
+    return 42
+
+# code of its own globals dict, which the test changes directly
+g = {}
+exec(compile("def length(v):\n    return len(v)\n", "length.py"), g)
+length = g['length']
+testit('builtin', length('abc') + length('abc'), 6)
+g['len'] = shadow
+testit('shadowed by a global', length('abc'), 42)
+del g['len']
+testit('shadow removed', length('abc'), 3)
+
+real_len = len
+BUILTINS['len'] = shadow
+testit('builtin rebound', length('abc'), 42)
+BUILTINS['len'] = real_len
+testit('builtin restored', length('abc'), 3)
+
+# one piece of code run under two globals dicts shares its caches
+code = compile("def who():\n    return name\n", "who.py")
+g1 = {'name': 'one'}
+g2 = {'name': 'two'}
+exec(code, g1)
+exec(code, g2)
+who1 = g1['who']
+who2 = g2['who']
+testit('first globals', who1(), 'one')
+testit('second globals', who2(), 'two')
+testit('first globals again', who1(), 'one')
+g2['name'] = 'three'
+testit('second globals changed', who2(), 'three')
+testit('first globals kept', who1(), 'one')
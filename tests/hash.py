@@ -0,0 +1,27 @@
+# Lunapy test set -- hashing
+
+import check
+testit = check.testit
+
+# long keys that only differ in a few bytes near the start
+pad = "y" * 1000
+d = {}
+i = 0
+while i < 2000:
+    d["xxxx" + str(10000 + i) + pad] = i
+    i += 1
+testit('long keys found', d["xxxx10777" + pad], 777)
+
+w = {}
+i = 0
+while i < 2000:
+    w["w" + str(i)] = i
+    i += 1
+testit('short keys found', w['w1234'], 1234)
+
+n = {}
+i = 0
+while i < 2000:
+    n[i * 4096] = i
+    i += 1
+testit('strided int keys found', n[777 * 4096], 777)
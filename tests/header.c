@@ -0,0 +1,68 @@
+/* Lunapy test set -- object headers and pool slots
+ *
+ * An object is only its type and reference count in front of the payload,
+ * and its pool is found from its address. Freed slots are linked through
+ * the payload, which must not touch the objects still alive.
+ */
+#include <stddef.h>
+#include "test.h"
+
+/* 1 if p is one of the object slots of the pool lp_pool_of(p) gives */
+static int in_obj_pool(LP, lp_obj *p) {
+	struct LpObjPool *pool;
+	for (pool = lp->obj_pool; pool; pool = pool->next) {
+		if ((void*)pool == lp_pool_of(p)) {
+			return p >= pool->obj && p < pool->obj + OBJ_SIZE;
+		}
+	}
+	return 0;
+}
+
+static lp_obj *nothing(LP) { RETURN_LP_NONE; }
+
+#define N 20000
+
+int main(int argc, char *argv[]) {
+	lp_vm *lp = lp_init(argc, argv);
+	static lp_obj *o[N];
+	char buf[32];
+	int i, bad;
+
+	testit("header is type and ref", (long)offsetof(lp_obj, string), (long)(2 * sizeof(int)));
+	testit("fits in 32 bytes", sizeof(lp_obj) <= 32, 1);
+
+	/* every kind of pooled object, over many pools */
+	bad = 0;
+	for (i = 0; i < N; i++) {
+		switch (i % 4) {
+			case 0: snprintf(buf, sizeof(buf), "s%d", i); o[i] = lp_string_copy(lp, buf, strlen(buf)); break;
+			case 1: o[i] = lp_list(lp); lp_set(lp, o[i], lp->lp_None, lp_number_from_int(lp, i)); break;
+			case 2: o[i] = lp_dict(lp); lp_setkv(lp, o[i], lp_number_from_int(lp, i), lp_number_from_int(lp, i)); break;
+			case 3: o[i] = lp_fnc(lp, nothing); break;
+		}
+		if (!in_obj_pool(lp, o[i])) { bad++; }
+	}
+	testit("slots found from their address", bad, 0);
+
+	/* free every other object, make new ones in the freed slots, and
+	 * check the ones that stayed */
+	for (i = 0; i < N; i += 2) { LP_OBJ_DEC(o[i]); }
+	for (i = 0; i < N; i += 2) { o[i] = lp_string_copy(lp, "new", 3); }
+	bad = 0;
+	for (i = 0; i < N; i++) {
+		int type = lp_typeof(o[i]);
+		if (i % 2 == 0) {
+			if (type != LP_STRING || o[i]->string.len != 3) { bad++; }
+		} else if (i % 4 == 1) {
+			if (type != LP_LIST || o[i]->list->len != 1 || lp_integer(o[i]->list->items[0]) != i) { bad++; }
+		} else {
+			if (type != LP_FNC || o[i]->fnc.cfnc != (void*)nothing) { bad++; }
+		}
+		if (o[i]->ref != 1) { bad++; }
+	}
+	testit("live objects untouched", bad, 0);
+
+	for (i = 0; i < N; i++) { LP_OBJ_DEC(o[i]); }
+	lp_deinit(lp);
+	return failed;
+}
@@ -0,0 +1,76 @@
+/* Lunapy test set -- immortal objects
+ *
+ * The one character strings are made once per VM and shared. Taking them
+ * must not allocate, and no count of references dropped or collection can
+ * free them.
+ */
+#include "test.h"
+
+static long live_objects(LP) {
+	struct LpObjPool *p;
+	long n = 0;
+	int i;
+	for (p = lp->obj_pool; p; p = p->next) {
+		for (i = 0; i < (int)OBJ_SIZE; i++) {
+			if (p->obj[i].ref > 0) n++;
+		}
+	}
+	return n;
+}
+
+#define N 1000
+
+int main(int argc, char *argv[]) {
+	lp_vm *lp = lp_init(argc, argv);
+	lp_obj *s = lp_string(lp, "hello");
+	lp_obj *c[N];
+	lp_obj *k, *v;
+	long before;
+	int i, bad;
+
+	/* indexing, slicing and chr give the shared strings */
+	k = lp_number_from_int(lp, 1);
+	v = lp_get(lp, s, k);
+	testit("s[1] is shared", v == lp->char_strings['e'], 1);
+	LP_OBJ_DEC(v);
+	LP_OBJ_DEC(k);
+	v = lp_string_sub(lp, s, 4, 5);
+	testit("s[4:5] is shared", v == lp->char_strings['o'], 1);
+	LP_OBJ_DEC(v);
+	bad = 0;
+	for (i = 0; i < 256; i++) {
+		v = lp_string_char(lp, (unsigned char)i);
+		if (lp_typeof(v) != LP_STRING || v->string.len != 1 || (unsigned char)v->string.val[0] != i) bad++;
+		LP_OBJ_DEC(v);
+	}
+	testit("every byte", bad, 0);
+
+	/* taking characters allocates nothing */
+	before = live_objects(lp);
+	for (i = 0; i < N; i++) {
+		c[i] = lp_string_sub(lp, s, i % 5, i % 5 + 1);
+	}
+	testit("objects after taking chars", live_objects(lp) - before, 0);
+	for (i = 0; i < N; i++) { LP_OBJ_DEC(c[i]); }
+
+	/* references taken and dropped leave the count where it was */
+	testit("ref after taking chars", lp->char_strings['l']->ref, LP_IMMORTAL);
+	for (i = 0; i < 100000; i++) {
+		LP_OBJ_DEC(lp->char_strings['x']);
+	}
+	testit("dropped past zero", lp->char_strings['x']->ref > 0, 1);
+	testit("still the same string", lp->char_strings['x']->string.val[0], 'x');
+
+	/* the collector does not free them */
+	lp_collect(lp);
+	while (lp_free_pending(lp, LP_FREE_SLICE));
+	bad = 0;
+	for (i = 0; i < 256; i++) {
+		if (lp->char_strings[i]->ref <= 0 || lp_typeof(lp->char_strings[i]) != LP_STRING) bad++;
+	}
+	testit("chars after a collection", bad, 0);
+
+	LP_OBJ_DEC(s);
+	lp_deinit(lp);
+	return failed;
+}
@@ -0,0 +1,104 @@
+/* Lunapy test set -- interned names
+ *
+ * Names in compiled code and names C code passes to lp_string are one
+ * object per VM. Keys built at run time are other objects and must still
+ * find them by hash and bytes. The hash a string caches must not outlive
+ * the string, when its slot is reused the new string hashes afresh.
+ */
+#include "test.h"
+#include "lp_internal.h"
+
+/* the hash of the n bytes at v, as a string that never cached one */
+static int fresh_hash(LP, const char *v, int n) {
+	lp_obj k;
+	k.type = LP_STRING;
+	k.ref = 1;
+	k.string.info = 0;
+	k.string.val = v;
+	k.string.len = n;
+	k.string.hash = 0;
+	return lp_hash(lp, &k);
+}
+
+/* the key object of g that equals k, 0 if there is none */
+static lp_obj *key_of(LP, lp_obj *g, lp_obj *k) {
+	int i = _lp_dict_find(lp, g->dict.val, k);
+	return i < 0 ? 0 : g->dict.val->items[i].key;
+}
+
+/* frees a string with a cached hash, then makes a string with make and
+ * checks that it takes the slot with no hash and hashes as its value */
+static void reuse(LP, const char *name, lp_obj *(*make)(LP)) {
+	char buf[64];
+	lp_obj *old = lp_string_copy(lp, "hashed before", 13);
+	lp_obj *v;
+	lp_hash(lp, old);
+	LP_OBJ_DEC(old);
+	v = make(lp);
+	snprintf(buf, sizeof(buf), "%s reuses the slot", name);
+	testit(buf, v == old, 1);
+	snprintf(buf, sizeof(buf), "%s hash not cached", name);
+	testit(buf, v->string.hash, 0);
+	snprintf(buf, sizeof(buf), "%s hash", name);
+	testit(buf, lp_hash(lp, v) == fresh_hash(lp, v->string.val, v->string.len), 1);
+	LP_OBJ_DEC(v);
+}
+
+static lp_obj *make_copy(LP) { return lp_string_copy(lp, "a copy", 6); }
+static lp_obj *make_n(LP) { return lp_string_n(lp, "with a length", 13); }
+static lp_obj *make_c(LP) { return lp_string(lp, "not a name"); }
+static lp_obj *longer;
+static lp_obj *make_sub(LP) { return lp_string_sub(lp, longer, 8, 16); }
+
+int main(int argc, char *argv[]) {
+	lp_vm *lp = lp_init(argc, argv);
+	lp_obj *g = lp_dict(lp);
+	lp_obj *s, *t, *k, *v, *d;
+
+	run(lp, "d = {'spam_name': 1}\nk = 'spam_name'\n", g);
+
+	/* lp_string and the constants of compiled code give one object */
+	s = lp_string(lp, "spam_name");
+	t = lp_string(lp, "spam_name");
+	testit("lp_string twice", s == t, 1);
+	LP_OBJ_DEC(t);
+	k = lp_string(lp, "k");
+	v = lp_get(lp, g, k);
+	testit("constant is lp_string", v == s, 1);
+	LP_OBJ_DEC(v);
+	testit("global name is lp_string", key_of(lp, g, k) == k, 1);
+	LP_OBJ_DEC(k);
+	k = lp_string(lp, "d");
+	d = lp_get(lp, g, k);
+	LP_OBJ_DEC(k);
+	testit("dict key is lp_string", key_of(lp, d, s) == s, 1);
+
+	/* names built at run time are other objects and still find the key */
+	t = lp_string_copy(lp, "spam_name", 9);
+	testit("copy is not interned", t != s, 1);
+	v = lp_get(lp, d, t);
+	testit("d[copy]", lp_integer(v), 1);
+	LP_OBJ_DEC(v);
+	LP_OBJ_DEC(t);
+	run(lp,
+		"a = d['spam_' + 'name']\n"
+		"b = d['xspam_namex'[1:10]]\n"
+		"c = 'spam_' + 'name' in d\n", g);
+	testit("d['spam_' + 'name']", global_int(lp, g, "a"), 1);
+	testit("d['xspam_namex'[1:10]]", global_int(lp, g, "b"), 1);
+	testit("'spam_' + 'name' in d", global_int(lp, g, "c"), 1);
+	LP_OBJ_DEC(d);
+	LP_OBJ_DEC(s);
+
+	/* a reused slot does not keep the hash of the string it held */
+	reuse(lp, "lp_string_copy", make_copy);
+	reuse(lp, "lp_string_n", make_n);
+	reuse(lp, "lp_string", make_c);
+	longer = lp_string(lp, "part of a longer string");
+	reuse(lp, "lp_string_sub", make_sub);
+	LP_OBJ_DEC(longer);
+
+	LP_OBJ_DEC(g);
+	lp_deinit(lp);
+	return failed;
+}
@@ -0,0 +1,75 @@
+/* Lunapy test set -- line numbers
+ *
+ * Raises at known lines and reads back the line of every frame on the
+ * stack from the line table.
+ */
+#include "test.h"
+
+/* runs text, which has to raise, and leaves the lines of the frames it
+ * raised in, outermost first, in lines; returns how many there were */
+static int raise_lines(LP, const char *text, int *lines, int n) {
+	lp_obj *g = lp_dict(lp);
+	lp_obj *r = lp_eval(lp, text, g);
+	int i, k = 0;
+	LP_OBJ_DEC(g);
+	if (r) { LP_OBJ_DEC(r); return 0; }
+	for (i = 0; i <= lp->cur && k < n; i++) {
+		int line = lp_lineno(lp, &lp->frames[i]);
+		if (line) { lines[k++] = line; }
+	}
+	LP_OBJ_DEC(lp->ex);
+	lp->ex = 0;
+	lp->cur = 0;
+	return k;
+}
+
+int main(int argc, char *argv[]) {
+	lp_vm *lp = lp_init(argc, argv);
+	char text[8192];
+	int lines[8], n, i;
+
+	n = raise_lines(lp, "x = 1\ny = 2\nraise 'top'\n", lines, 8);
+	testit("module frames", n, 1);
+	testit("module line", lines[0], 3);
+
+	n = raise_lines(lp,
+		"def f(a):\n"
+		"    b = a + 1\n"
+		"    raise 'in f'\n"
+		"\n"
+		"def g():\n"
+		"    # a comment\n"
+		"    return f(1)\n"
+		"g()\n", lines, 8);
+	testit("call frames", n, 3);
+	testit("call line in module", lines[0], 8);
+	testit("call line in g", lines[1], 7);
+	testit("call line in f", lines[2], 3);
+
+	/* a loop goes back to earlier lines before it raises */
+	n = raise_lines(lp,
+		"i = 0\n"
+		"while i < 10:\n"
+		"    i += 1\n"
+		"    if i == 5:\n"
+		"        raise 'five'\n"
+		"    i += 0\n", lines, 8);
+	testit("loop line", lines[0], 5);
+
+	/* lines further apart than one table entry reaches */
+	strcpy(text, "x = 1\n");
+	for (i = 0; i < 300; i++) { strcat(text, "\n"); }
+	strcat(text, "raise 'far'\n");
+	n = raise_lines(lp, text, lines, 8);
+	testit("far line", lines[0], 302);
+
+	/* many instructions on one line */
+	strcpy(text, "x = 1");
+	for (i = 0; i < 300; i++) { strcat(text, " + 1"); }
+	strcat(text, "\ny = x + []\n");
+	n = raise_lines(lp, text, lines, 8);
+	testit("after a long line", lines[0], 2);
+
+	lp_deinit(lp);
+	return failed;
+}
@@ -0,0 +1,93 @@
+# Lunapy test set -- method calls
+#
+# obj.m(args) loads the function and self into registers and calls it
+# without making a bound method. Every kind of object has to come out the
+# same as a plain attribute get followed by a call.
+
+import math
+
+import check
+testit = check.testit
+
+class Counter:
+    def __init__(self, n):
+        self.n = n
+    def add(self, a, b):
+        self.n = self.n + a + b
+        return self
+    def get(self):
+        return self.n
+    def twice(self):
+        return self.get() + self.get()
+
+class Sub(Counter):
+    def get(self):
+        return -self.n
+
+c = Counter(1)
+testit('with arguments', c.add(2, 3).get(), 6)
+testit('chained', c.add(1, 0).add(1, 0).get(), 8)
+testit('calls another method', c.twice(), 16)
+testit('method in arguments', c.add(c.get(), c.get()).get(), 24)
+testit('unbound through the class', Counter.get(c), 24)
+testit('inherited method', Sub(5).add(1, 1).get(), -7)
+testit('overridden method called by base', Sub(5).twice(), -10)
+
+m = c.get
+testit('bound method', m(), 24)
+
+# functions stored on an instance or in a dict get no self
+def plain(a):
+    return a * 2
+
+c.f = plain
+testit('function on an instance', c.f(4), 8)
+d = {'f': plain}
+testit('function in a dict', d.f(5), 10)
+testit('module function', math.sqrt(16.0), 4.0)
+
+# the same call site on objects of different kinds
+def first(o):
+    return o.index('b')
+
+testit('list index', first(['a', 'b', 'c']), 1)
+testit('string index', first('aab'), 2)
+
+class Finder:
+    def __init__(self):
+        self.x = 1
+    def index(self, v):
+        return v + '!'
+
+testit('object index', first(Finder()), 'b!')
+testit('list index again', first(['b']), 0)
+
+# errors inside and around methods
+def fails(o):
+    try:
+        o.nosuch()
+    except:
+        return 1
+    return 0
+
+testit('missing method', fails(c), 1)
+testit('missing list method', fails([]), 1)
+testit('method of None', fails(None), 1)
+
+class Raiser:
+    def __init__(self):
+        self.x = 1
+    def go(self):
+        raise 'inside'
+    def nosuch(self):
+        self.go()
+
+testit('raise inside a method', fails(Raiser()), 1)
+
+# many calls
+c = Counter(0)
+i = 0
+while i < 10000:
+    c.add(i, 1)
+    i += 1
+testit('many calls', c.get(), 10000 + 9999 * 10000 / 2)
@@ -0,0 +1,85 @@
+# Lunapy test set -- numbers and None
+
+import check
+testit = check.testit
+
+def ident(v):
+    return v
+
+# fixnums: the 31-bit boundary of a 32-bit host and the int limits
+testit('2**30-1 + 1', 1073741823 + 1, 1073741824)
+testit('-2**30 - 1', -1073741824 - 1, -1073741825)
+testit('-2**30 - 1 < 0', -1073741824 - 1 < 0, 1)
+testit('int max', 2147483647, 2147483647)
+testit('int min', -2147483647 - 1, -2147483648)
+testit('int min < 0', -2147483647 - 1 < 0, 1)
+testit('int min - int max', (-2147483647 - 1) + 2147483647, -1)
+testit('pass through call', ident(-1073741825), -1073741825)
+
+# int results past the int range become doubles instead of wrapping
+big = 2147483647
+small = -2147483647 - 1
+i = 0
+while i < 2:
+    testit('int max + 1', big + 1, 2147483648.0)
+    testit('int min - 1', small - 1, -2147483649.0)
+    testit('int min + int min', small + small, -4294967296.0)
+    testit('int max - int min', big - small, 4294967295.0)
+    testit('int max + 0', big + 0, 2147483647)
+    i += 1
+
+# negative numbers
+testit('-7 % 2', -7 % 2, -1)
+testit('-7 / 2', -7 / 2, -3)
+testit('-8 >> 1', -8 >> 1, -4)
+testit('-1 << 3', -1 << 3, -8)
+testit('-3 * -3', -3 * -3, 9)
+testit('-1 < 0', -1 < 0, 1)
+testit('abs(-3.5)', abs(-3.5), 3.5)
+
+# None is an immediate and must not alias any number
+x = None
+testit('None == None', x == None, 1)
+testit('None == 0', x == 0, 0)
+testit('None == 2.0', x == 2.0, 0)
+testit('2.0 == None', 2.0 == None, 0)
+testit('None through call', ident(None) == None, 1)
+testit('None in list', [None, 2.0][0] == None, 1)
+
+# 2.0 stays boxed so it cannot be confused with None
+testit('2.0 * 1.0', 2.0 * 1.0, 2.0)
+testit('2.0 + 0.0', 2.0 + 0.0, 2.0)
+testit('str(2.0)', str(2.0), "2.000000")
+testit('2.0 through call', ident(2.0) + 0.5, 2.5)
+testit('2.0 in list', [None, 2.0][1] + 1.0, 3.0)
+
+d = {}
+d[None] = 'n'
+d[2.0] = 'two'
+d[2] = 'i'
+testit('d[None]', d[None], 'n')
+testit('d[2.0]', d[2.0], 'two')
+testit('d[2]', d[2], 'i')
+testit('len(d)', len(d), 3)
+
+# doubles: inline flonums, zero and values outside the flonum range
+testit('0.1 + 0.2', str(0.1 + 0.2), "0.300000")
+testit('-0.5', str(-0.5), "-0.500000")
+testit('0.0 - 0.0', 0.0 - 0.0, 0.0)
+testit('2.0 - 2.0', 2.0 - 2.0, 0.0)
+testit('float(3)', float(3), 3.0)
+testit('int(2.5)', int(2.5), 2)
+
+big = 10.0
+i = 0
+while i < 300:
+    big = big * 10.0
+    i += 1
+small = 1.0 / big
+testit('big > 1.0', big > 1.0, 1)
+testit('big / big', big / big, 1.0)
+testit('big * 0.0', big * 0.0, 0.0)
+testit('-big < 0.0', -big < 0.0, 1)
+testit('small > 0.0', small > 0.0, 1)
+testit('small * big', str(small * big), "1.000000")
+testit('big in list', [big][0] == big, 1)
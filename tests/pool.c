@@ -0,0 +1,86 @@
+/* Lunapy test set -- object pools
+ *
+ * Slots of the object, dict, list and function pools are reused as soon
+ * as they are freed, so loops that allocate and drop objects, with many
+ * others alive around them, take no new pools.
+ */
+#include "test.h"
+
+/* the object, dict, list and function pools the VM has */
+static long pools(LP) {
+	struct LpObjPool *o;
+	struct LpDictPool *d;
+	struct LpListPool *l;
+	struct LpFunPool *f;
+	long n = 0;
+	for (o = lp->obj_pool; o; o = o->next) n++;
+	for (d = lp->dict_pool; d; d = d->next) n++;
+	for (l = lp->list_pool; l; l = l->next) n++;
+	for (f = lp->func_pool; f; f = f->next) n++;
+	return n;
+}
+
+int main(int argc, char *argv[]) {
+	lp_vm *lp = lp_init(argc, argv);
+	lp_obj *g = lp_dict(lp);
+	lp_obj *a, *b;
+	long before;
+
+	/* a freed slot is the next one handed out; the list and dict get an
+	 * item each, so their items are freed with them too */
+	a = lp_list(lp);
+	lp_set(lp, a, lp->lp_None, lp->lp_None);
+	LP_OBJ_DEC(a);
+	b = lp_list(lp);
+	testit("list slot reused", a == b, 1);
+	LP_OBJ_DEC(b);
+	a = lp_dict(lp);
+	lp_set(lp, a, lp_number_from_int(lp, 1), lp->lp_None);
+	LP_OBJ_DEC(a);
+	b = lp_dict(lp);
+	testit("dict slot reused", a == b, 1);
+	LP_OBJ_DEC(b);
+
+	/* many live objects, then churn next to them */
+	run(lp,
+		"keep = []\n"
+		"i = 0\n"
+		"while i < 50000:\n"
+		"    keep.append([i, {'i': i}])\n"
+		"    i += 1\n", g);
+	before = pools(lp);
+	run(lp,
+		"def churn(n):\n"
+		"    i = 0\n"
+		"    while i < n:\n"
+		"        x = [i]\n"
+		"        d = {'i': i}\n"
+		"        def f():\n"
+		"            return 1\n"
+		"        s = str(i)\n"
+		"        i += 1\n"
+		"churn(200000)\n", g);
+	testit("churn takes no pools", pools(lp) - before, 0);
+
+	/* holes left by every other object are filled before new pools */
+	run(lp,
+		"i = 0\n"
+		"while i < 50000:\n"
+		"    keep[i] = None\n"
+		"    i += 2\n", g);
+	before = pools(lp);
+	run(lp,
+		"i = 0\n"
+		"while i < 50000:\n"
+		"    keep[i] = [i, {'i': i}]\n"
+		"    i += 2\n", g);
+	testit("holes refilled", pools(lp) - before, 0);
+	run(lp, "n = 0\nfor k in keep:\n    n += k[1]['i']\n", g);
+	testit("contents kept", global_int(lp, g, "n"), 49999L * 50000 / 2);
+	run(lp, "keep[-1] = 7\nn = keep[49999]\n", g);
+	testit("set from the end", global_int(lp, g, "n"), 7);
+
+	LP_OBJ_DEC(g);
+	lp_deinit(lp);
+	return failed;
+}
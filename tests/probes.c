@@ -0,0 +1,49 @@
+/* Lunapy test set -- dict probes
+ *
+ * Fills dicts with keys that are easy to hash badly and counts the index
+ * slots their lookups visit, which stays close to one per key when the
+ * hashes spread.
+ */
+#include "test.h"
+#include "lp_internal.h"
+
+/* the probes per key of the dict global k, times 100 */
+static long probes(LP, lp_obj *g, const char *k) {
+	lp_obj *s = lp_string(lp, k);
+	lp_obj *d = lp_get(lp, g, s);
+	long n = d->dict.val->len;
+	long p = _lp_dict_probes(d->dict.val);
+	LP_OBJ_DEC(d);
+	LP_OBJ_DEC(s);
+	printf("%s, probes per key: %.2f\n", k, (double)p / n);
+	return p * 100 / n;
+}
+
+int main(int argc, char *argv[]) {
+	lp_vm *lp = lp_init(argc, argv);
+	lp_obj *g = lp_dict(lp);
+	lp_obj *e = lp_dict(lp);
+	lp_obj *r = lp_eval(lp,
+		"pad = 'y' * 1000\n"
+		"long = {}\n"
+		"short = {}\n"
+		"strided = {}\n"
+		"i = 0\n"
+		"while i < 2000:\n"
+		"    long['xxxx' + str(10000 + i) + pad] = i\n"
+		"    short['w' + str(i)] = i\n"
+		"    strided[i * 4096] = i\n"
+		"    i += 1\n", g);
+	if (!r) { lp_print_stack(lp); return 1; }
+	LP_OBJ_DEC(r);
+
+	testit("long keys spread", probes(lp, g, "long") < 200, 1);
+	testit("short keys spread", probes(lp, g, "short") < 200, 1);
+	testit("strided int keys spread", probes(lp, g, "strided") < 200, 1);
+	testit("empty dict", _lp_dict_probes(e->dict.val), 0);
+
+	LP_OBJ_DEC(e);
+	LP_OBJ_DEC(g);
+	lp_deinit(lp);
+	return failed;
+}
@@ -0,0 +1,90 @@
+# Lunapy test set -- quickened instructions
+#
+# Every site below first runs on the types it gets specialized for and
+# then sees other types, which have to take the generic path again.
+
+import check
+testit = check.testit
+
+def add(a, b):
+    return a + b
+
+def sub(a, b):
+    return a - b
+
+def cmp(a, b):
+    return str(a < b) + str(a <= b) + str(a == b) + str(a != b)
+
+def get(a, k):
+    return a[k]
+
+i = 0
+while i < 20:
+    add(i, 1)
+    sub(i, 1)
+    cmp(i, 1)
+    get([1, 2, 3], 1)
+    i += 1
+
+testit('add ints', add(2, 3), 5)
+testit('add floats', add(2.5, 0.25), 2.75)
+testit('add strings', add('ab', 'cd'), 'abcd')
+testit('add lists', len(add([1], [2, 3])), 3)
+testit('add past 2**30', add(1073741823, 1), 1073741824)
+testit('add below -2**30', add(-1073741824, -1), -1073741825)
+testit('add ints again', add(-7, 3), -4)
+
+testit('sub ints', sub(2, 3), -1)
+testit('sub floats', sub(2.5, 0.25), 2.25)
+testit('sub below -2**30', sub(-1073741824, 1), -1073741825)
+testit('sub ints again', sub(10, 3), 7)
+
+testit('cmp ints', cmp(1, 2), '1101')
+testit('cmp equal ints', cmp(2, 2), '0110')
+testit('cmp floats', cmp(2.5, 1.5), '0001')
+testit('cmp strings', cmp('a', 'b'), '1101')
+testit('cmp None', cmp(None, None), '0110')
+testit('cmp ints again', cmp(3, 2), '0001')
+
+testit('get list', get([1, 2, 3], 2), 3)
+testit('get list negative', get([1, 2, 3], -1), 3)
+testit('get dict str', get({'a': 1, 'b': 2}, 'b'), 2)
+testit('get dict int', get({1: 'one', 2: 'two'}, 2), 'two')
+testit('get string', get('abc', 1), 'b')
+testit('get list again', get([4, 5, 6], 0), 4)
+testit('get dict again', get({'k': 'v'}, 'k'), 'v')
+
+# misses go through the generic path and raise as before
+def miss(a, k):
+    try:
+        return a[k]
+    except:
+        return 'missed'
+
+testit('list in range', miss([1, 2], 1), 2)
+testit('list out of range', miss([1, 2], 5), 'missed')
+testit('dict hit', miss({'a': 1}, 'a'), 1)
+testit('dict miss', miss({'a': 1}, 'b'), 'missed')
+testit('dict int miss', miss({1: 1}, 2), 'missed')
+
+# objects with a class get their items through the class
+class Box:
+    def __init__(self, v):
+        self.v = v
+
+class Hook:
+    def __init__(self):
+        pass
+    def __get__(self, k):
+        return "hooked " + k
+
+testit('get dict before class', get({'x': 1}, 'x'), 1)
+testit('get object field', get(Box(10), 'v'), 10)
+testit('get through class', get(Hook(), 'zz'), 'hooked zz')
+testit('get dict after class', get({'x': 2}, 'x'), 2)
+
+# a site that keeps changing types
+r = 0
+for v in [1, 2.0, 3, 4.0, 5]:
+    r = add(r, v)
+testit('mixed sums', r, 15.0)
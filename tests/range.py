@@ -0,0 +1,116 @@
+# Lunapy test set -- range objects
+
+import check
+testit = check.testit
+
+def items(r):
+    s = ''
+    for i in r:
+        s = s + str(i) + ' '
+    return s
+
+testit('range(5)', items(range(5)), '0 1 2 3 4 ')
+testit('range(2, 5)', items(range(2, 5)), '2 3 4 ')
+testit('range(0, 10, 3)', items(range(0, 10, 3)), '0 3 6 9 ')
+testit('range(5, 0, -2)', items(range(5, 0, -2)), '5 3 1 ')
+testit('range(-3, 0)', items(range(-3, 0)), '-3 -2 -1 ')
+testit('range(0)', items(range(0)), '')
+testit('range(-4)', items(range(-4)), '')
+testit('range(5, 0)', items(range(5, 0)), '')
+testit('range(0, 5, -1)', items(range(0, 5, -1)), '')
+
+testit('len(range(10))', len(range(10)), 10)
+testit('len(range(0, 10, 3))', len(range(0, 10, 3)), 4)
+testit('len(range(10, 0, -3))', len(range(10, 0, -3)), 4)
+testit('len(range(0))', len(range(0)), 0)
+testit('len of a big range', len(range(1000000000)), 1000000000)
+
+r = range(10, 0, -3)
+testit('r[0]', r[0], 10)
+testit('r[3]', r[3], 1)
+testit('r[-1]', r[-1], 1)
+testit('r[-4]', r[-4], 10)
+caught = 0
+try:
+    x = r[4]
+except:
+    caught = 1
+testit('r[4] raises', caught, 1)
+caught = 0
+try:
+    x = r[-5]
+except:
+    caught = 1
+testit('r[-5] raises', caught, 1)
+
+testit('7 in r', 7 in r, 1)
+testit('8 in r', 8 in r, 0)
+testit('-2 in r', -2 in r, 0)
+testit('13 in r', 13 in r, 0)
+testit('"x" in range(5)', 'x' in range(5), 0)
+
+testit('bool(range(1))', bool(range(1)), 1)
+testit('bool(range(0))', bool(range(0)), 0)
+testit('range == range', range(0, 6, 2) == range(0, 5, 2), 1)
+testit('range != range', range(0, 6, 2) != range(0, 6, 3), 1)
+testit('empty ranges equal', range(3, 3) == range(5, 1), 1)
+testit('str', str(range(1, 9, 2)), 'range(1, 9, 2)')
+testit('istype', istype(range(3), 'range'), 1)
+
+l = copy(range(3))
+l.append(3)
+testit('copy to list', items(l), '0 1 2 3 ')
+d = {}
+d[range(3)] = 'r'
+testit('range as key', d[range(0, 3)], 'r')
+
+# the same loop walks ranges and then other iterables
+def total(seq):
+    n = 0
+    for i in seq:
+        n += i
+    return n
+
+testit('total range', total(range(100)), 4950)
+testit('total list', total([1, 2, 3]), 6)
+testit('total range again', total(range(1, 4)), 6)
+testit('total floats', total([0.5, 1.5]), 2.0)
+
+# ranges kept in lists and nested loops
+rs = [range(2), range(3)]
+n = 0
+for q in rs:
+    for i in q:
+        for j in range(i + 1):
+            n += 1
+testit('nested', n, 1 + 2 + 1 + 2 + 3)
+
+# a long loop does not build its items
+n = 0
+for i in range(1000000):
+    n += 1
+testit('long loop', n, 1000000)
+
+# ranges near the int limits, the items are computed without overflow
+r = range(-2147483647, 2147483647, 1073741824)
+testit('wide len', len(r), 4)
+testit('wide get', r[3], 1073741825)
+testit('wide get negative', r[-4], -2147483647)
+testit('wide in', 1073741825 in r, 1)
+testit('wide not in', 2147483646 in r, 0)
+testit('wide copy', copy(r)[2], 1)
+items = []
+for i in r:
+    items.append(i)
+testit('wide loop', len(items), 4)
+testit('wide loop last', items[3], 1073741825)
+testit('wide compare', range(2147483647, 2147483646, -1) == range(-2147483647, -2147483646), 0)
+testit('longest', len(range(0, 2147483647)), 2147483647)
+
+# more items than an int counts
+caught = 0
+try:
+    r = range(-2000000000, 2000000000)
+except:
+    caught = 1
+testit('too long raises', caught, 1)
@@ -0,0 +1,16 @@
+# Runs one script of the test set with the interpreter, for ctest:
+#   cmake -DLP=<lp binary> -DSCRIPT=<name.py> -P run.cmake
+# The script runs from the tests directory so that it can import the
+# others. lp waits for a key before it quits, the script itself is fed to
+# it as stdin so that it never blocks.
+
+get_filename_component(DIR ${CMAKE_CURRENT_LIST_FILE} PATH)
+
+execute_process(COMMAND ${LP} ${SCRIPT}
+	WORKING_DIRECTORY ${DIR}
+	INPUT_FILE ${DIR}/${SCRIPT}
+	RESULT_VARIABLE result)
+
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "${SCRIPT} failed: ${result}")
+endif()
@@ -0,0 +1,100 @@
+/* Lunapy test set -- size-class slabs
+ *
+ * String data and list and dict items of every size class, and past the
+ * largest one, are written, read back and freed in mixed order, and their
+ * blocks are used again.
+ */
+#include "test.h"
+
+/* the blocks in use in the size-class slabs */
+static long blocks(LP) {
+	struct LpSlab *s;
+	long n = 0;
+	int cls;
+	for (cls = 0; cls < LP_SLAB_CLASSES; cls++) {
+		for (s = lp->slab[cls]; s; s = s->next) n += s->used;
+	}
+	return n;
+}
+
+/* the size-class slabs there are */
+static long slabs(LP) {
+	struct LpSlab *s;
+	long n = 0;
+	int cls;
+	for (cls = 0; cls < LP_SLAB_CLASSES; cls++) {
+		for (s = lp->slab[cls]; s; s = s->next) n++;
+	}
+	return n;
+}
+
+int main(int argc, char *argv[]) {
+	lp_vm *lp = lp_init(argc, argv);
+	lp_obj *g = lp_dict(lp);
+	lp_obj *s[64];
+	long before;
+	int i, j, bad;
+
+	/* strings of sizes around every class boundary, freed every other one
+	 * and made again */
+	bad = 0;
+	for (j = 0; j < 2; j++) {
+		for (i = 0; i < 64; i++) {
+			int n = (i * 97) % 5000;
+			if (j && i % 2) { continue; }
+			s[i] = lp_string_t(lp, n);
+			memset(s[i]->string.info->s, 'a' + i % 26, n);
+		}
+		for (i = 0; i < 64 && !j; i += 2) { LP_OBJ_DEC(s[i]); }
+	}
+	for (i = 0; i < 64; i++) {
+		int n = (i * 97) % 5000, k;
+		if (s[i]->string.len != n) { bad++; }
+		for (k = 0; k < n; k++) {
+			if (s[i]->string.val[k] != 'a' + i % 26) { bad++; break; }
+		}
+		LP_OBJ_DEC(s[i]);
+	}
+	testit("strings intact", bad, 0);
+
+	run(lp,
+		"def grow(n):\n"
+		"    l = []\n"
+		"    d = {}\n"
+		"    s = ''\n"
+		"    i = 0\n"
+		"    while i < n:\n"
+		"        l.append(i)\n"
+		"        d[i] = i\n"
+		"        s = s + 'x'\n"
+		"        i += 1\n"
+		"    return [l, d, s]\n", g);
+	/* the first rounds add the globals and grow the dict they are in, the
+	 * last one only takes what it gives back */
+	for (j = 0; j < 3; j++) {
+		before = blocks(lp);
+		run(lp,
+			"r = grow(10000)\n"
+			"ok = 0\n"
+			"i = 0\n"
+			"while i < 10000:\n"
+			"    if r[0][i] == i and r[1][i] == i:\n"
+			"        ok += 1\n"
+			"    i += 1\n"
+			"size = len(r[2])\n"
+			"r = None\n", g);
+	}
+	testit("list and dict items intact", global_int(lp, g, "ok"), 10000);
+	testit("long string", global_int(lp, g, "size"), 10000);
+	testit("blocks back after growing", blocks(lp) - before, 0);
+
+	/* the same sizes over and over take no more slabs */
+	run(lp, "i = 0\nwhile i < 200:\n    grow(i * 50)\n    i += 1\n", g);
+	before = slabs(lp);
+	run(lp, "i = 0\nwhile i < 200:\n    grow(i * 50)\n    i += 1\n", g);
+	testit("slabs after repeating", slabs(lp) - before, 0);
+
+	LP_OBJ_DEC(g);
+	lp_deinit(lp);
+	return failed;
+}
@@ -0,0 +1,48 @@
+/* Lunapy test set -- helpers shared by the C tests
+ *
+ * Each C program in tests/ embeds a VM, checks what it finds with testit and
+ * returns failed from main, which is what ctest looks at.
+ */
+#ifndef LP_TEST_H
+#define LP_TEST_H
+
+#include "lp.h"
+
+static int failed;
+
+/* prints the outcome of one check, a wrong value fails the program */
+lp_inline void testit(const char *name, long value, long expected) {
+	if (value != expected) {
+		printf("%s returned %ld expected %ld\n", name, value, expected);
+		failed = 1;
+	} else {
+		printf("%s %ld passed\n", name, value);
+	}
+}
+
+/* runs text in the globals g; if it raises, the stack is printed, the
+ * program fails and the VM is left ready for the next run */
+lp_inline void run(LP, const char *text, lp_obj *g) {
+	lp_obj *r = lp_eval(lp, text, g);
+	if (!r) {
+		lp_print_stack(lp);
+		failed = 1;
+		LP_OBJ_DEC(lp->ex);
+		lp->ex = 0;
+		lp->cur = 0;
+		return;
+	}
+	LP_OBJ_DEC(r);
+}
+
+/* the value of the int global k of g */
+lp_inline long global_int(LP, lp_obj *g, const char *k) {
+	lp_obj *s = lp_string(lp, k);
+	lp_obj *v = lp_get(lp, g, s);
+	long n = lp_integer(v);
+	LP_OBJ_DEC(v);
+	LP_OBJ_DEC(s);
+	return n;
+}
+
+#endif
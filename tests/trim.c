@@ -0,0 +1,62 @@
+/* Lunapy test set -- giving pools back
+ *
+ * Once a burst of objects is gone, all but LP_POOL_SPARE of the pools and
+ * slabs it took are unmapped again, and a program that keeps filling and
+ * emptying the same pools does not map and unmap them every time.
+ */
+#include "test.h"
+
+static long pools, maps;
+
+static void *count_pool_alloc(void *ud) { pools++; maps++; return lp_std_allocator.pool_alloc(ud); }
+static void count_pool_release(void *ud, void *p) { pools--; lp_std_allocator.pool_release(ud, p); }
+
+int main(int argc, char *argv[]) {
+	lp_allocator mem = lp_std_allocator;
+	lp_vm *lp;
+	lp_obj *g;
+	long before, peak;
+
+	mem.pool_alloc = count_pool_alloc;
+	mem.pool_release = count_pool_release;
+	lp = lp_init_alloc(argc, argv, &mem);
+	g = lp_dict(lp);
+	run(lp,
+		"def burst(n):\n"
+		"    l = []\n"
+		"    i = 0\n"
+		"    while i < n:\n"
+		"        l.append([i, {'i': str(i)}])\n"
+		"        i += 1\n"
+		"    return len(l)\n"
+		"def work(n):\n"
+		"    i = 0\n"
+		"    while i < n:\n"
+		"        i += 1\n", g);
+	lp_collect(lp);
+	before = pools;
+
+	/* the safepoints of the code that runs next give the pools back */
+	run(lp, "burst(300000)\n", g);
+	peak = pools;
+	testit("burst took pools", peak - before > 100, 1);
+	/* up to twice LP_POOL_SPARE empty ones wait for the next safepoint,
+	 * and LP_POOL_SPARE more stay mapped in the cache */
+	run(lp, "work(100000)\n", g);
+	testit("given back at a safepoint", pools - before <= 3 * LP_POOL_SPARE, 1);
+	lp_collect(lp);
+	testit("given back by lp_collect", pools - before <= LP_POOL_SPARE, 1);
+
+	/* filling and emptying a few pools over and over maps none */
+	lp_collect(lp);
+	maps = 0;
+	run(lp, "burst(1000)\n", g);
+	maps = 0;
+	run(lp, "i = 0\nwhile i < 200:\n    burst(1000)\n    i += 1\n", g);
+	testit("no maps while oscillating", maps, 0);
+
+	LP_OBJ_DEC(g);
+	lp_deinit(lp);
+	testit("pools after deinit", pools, 0);
+	return failed;
+}